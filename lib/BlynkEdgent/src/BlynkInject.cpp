@@ -65,49 +65,21 @@ void BlynkInject::run() {
 void BlynkInject::parse_message() {
     if (!_ble.available()) return;
     std::string cmd = _ble.read();
-    JSONValue outerObj = JSONValue::parse((char*)cmd.c_str(), cmd.length());
-    if (outerObj.type() != JSON_TYPE_OBJECT) {
-      sendMsg(R"json({"t":"error","msg":"wrong format"})json");
-      return;
-    }
 
-    // Process our received message. Get type first.
-    JSONString t;
-    {
-        JSONObjectIterator iter(outerObj);
-        while (iter.next()) {
-            if (iter.name() == "t") {
-                t = iter.value().toString();
-            }
-        }
-    }
-
-    if (t == "set") {
-        bool foundInvalid = false;
-        JSONObjectIterator item(outerObj);
-        while (item.next()) {
-          const JSONString& key = item.name();
-          if      (key == "t")      { /* skip */ }
-          else if (key == "if")     { _config.intf  = item.value().toString().data(); }
-          else if (key == "ssid")   { _config.ssid  = item.value().toString().data(); }
-          else if (key == "pass")   { _config.pass  = item.value().toString().data(); }
-          else if (key == "blynk")  { _config.auth  = item.value().toString().data(); }
-          else if (key == "host")   { _config.host  = item.value().toString().data(); }
-          else if (key == "port")   { /* ignored */ }
-          else if (key == "ip")     { _config.ip    = item.value().toString().data(); }
-          else if (key == "mask")   { _config.mask  = item.value().toString().data(); }
-          else if (key == "gw")     { _config.gw    = item.value().toString().data(); }
-          else if (key == "dns")    { _config.dns   = item.value().toString().data(); }
-          else if (key == "dns2")   { _config.dns2  = item.value().toString().data(); }
-          else if (key == "save")   { _config.forceSave = true; }
-          else                      { foundInvalid = true; }
-        }
+    // Properties of a "set" message are stored to _config once the message is parsed
+    bool foundInvalid = false;
+    switch (injectDecodeMessage(cmd.data(), cmd.length(), _config, foundInvalid)) {
+    case INJECT_CMD_MALFORMED: {
+      sendMsg(R"json({"t":"error","msg":"wrong format"})json");
+    } break;
+    case INJECT_CMD_SET: {
         if (!foundInvalid) {
           sendMsg(R"json({"t":"set_ok"})json");
         } else {
           sendMsg(R"json({"t":"set_fail"})json");
         }
-    } else if (t == "connect") {
+    } break;
+    case INJECT_CMD_CONNECT: {
         if (_config.auth.length() == 32 &&
             ((_config.intf == "wifi" && _config.ssid.length()) ||
              (_config.intf == "cell") ||
@@ -122,25 +94,20 @@ void BlynkInject::parse_message() {
             LOG_W_MOD("Configuration invalid");
             sendMsg(R"json({"t":"connect_fail","msg":"configuration invalid"})json");
         }
-    } else if (t == "info") {
+    } break;
+    case INJECT_CMD_INFO: {
         LOG_I_MOD("Sending board info");
 
         // Configuring starts with board info request
         _user_started_configuring = true;
 
         char buff[256];
-        JsonBufferWriter writer(buff, sizeof(buff));
-        writer.beginObject();
-          writer["t"       ] = "info";
-          writer["vendor"  ] = _vendor;
-          writer["tmpl_id" ] = _tmpl_id;
-          writer["fw_type" ] = _fw_type;
-          writer["fw_ver"  ] = _fw_ver;
-          writer["name"    ] = _name;
-          writer["last_error"] = (int)_last_error;
-        writer.endObject();
+        InlineJsonBufferWriter writer(buff, sizeof(buff));
+        writer.fill(JSON_TEMPLATE(R"json({"t":"info","vendor":?,"tmpl_id":?,"fw_type":?,"fw_ver":?,"name":?,"last_error":?})json"),
+                    _vendor, _tmpl_id, _fw_type, _fw_ver, _name, (int)_last_error);
         sendMsg(writer.buffer(), writer.dataSize());
-    } else if (t == "ifs") {
+    } break;
+    case INJECT_CMD_IFS: {
         LOG_I_MOD("Sending interface info");
 
         sendMsg(R"json({"t":"ifs_start"})json");
@@ -148,48 +115,42 @@ void BlynkInject::parse_message() {
         char buff[256];
 #ifdef NetMgr_WiFi
         if (NetMgrWiFi.isHardwareAvailable()) {
-          JsonBufferWriter writer(buff, sizeof(buff));
-          writer.beginObject();
-            writer["t"     ] = "if";
-            writer["name"  ] = "wifi";
-            writer["mac"   ] = NetMgrWiFi.getMacAddress();
-            writer["scan"  ] = NetMgrWiFi.supportsScan()?1:0;
-            writer["5ghz"  ] = NetMgrWiFi.supports5GHz()?1:0;
-            writer["static_ip"] = NetMgrWiFi.supportsStaticIP()?1:0;
-          writer.endObject();
+          InlineJsonBufferWriter writer(buff, sizeof(buff));
+          writer.fill(JSON_TEMPLATE(R"json({"t":"if","name":"wifi","mac":?,"scan":?,"5ghz":?,"static_ip":?})json"),
+                      NetMgrWiFi.getMacAddress(),
+                      NetMgrWiFi.supportsScan()?1:0,
+                      NetMgrWiFi.supports5GHz()?1:0,
+                      NetMgrWiFi.supportsStaticIP()?1:0);
           sendMsg(writer.buffer(), writer.dataSize());
           delay(10);
         }
 #endif
 #ifdef NetMgr_Cellular
         if (NetMgrCellular.isHardwareAvailable()) {
-          JsonBufferWriter writer(buff, sizeof(buff));
-          writer.beginObject();
-            writer["t"     ] = "if";
-            writer["name"  ] = "cell";
-            writer["imei"  ] = NetMgrCellular.getIMEI();
-            writer["imsi"  ] = NetMgrCellular.getIMSI();
-            writer["iccid" ] = NetMgrCellular.getICCID();
-            writer["scan"  ] = NetMgrCellular.supportsScan()?1:0;
-            writer["pin"   ] = NetMgrCellular.supportsSimPin()?1:0;
-            writer["apn"   ] = NetMgrCellular.supportsAPN()?1:0;
-          writer.endObject();
+          InlineJsonBufferWriter writer(buff, sizeof(buff));
+          writer.fill(JSON_TEMPLATE(R"json({"t":"if","name":"cell","imei":?,"imsi":?,"iccid":?,"scan":?,"pin":?,"apn":?})json"),
+                      NetMgrCellular.getIMEI(),
+                      NetMgrCellular.getIMSI(),
+                      NetMgrCellular.getICCID(),
+                      NetMgrCellular.supportsScan()?1:0,
+                      NetMgrCellular.supportsSimPin()?1:0,
+                      NetMgrCellular.supportsAPN()?1:0);
           sendMsg(writer.buffer(), writer.dataSize());
           delay(10);
         }
 #endif
 #ifdef NetMgr_Ethernet
         if (NetMgrEthernet.isHardwareAvailable()) {
-          JsonBufferWriter writer(buff, sizeof(buff));
+          InlineJsonBufferWriter writer(buff, sizeof(buff));
           writer.beginObject();
-            writer["t"     ] = "if";
-            writer["name"  ] = "eth";
-            writer["mac"   ] = NetMgrEthernet.getMacAddress();
-            writer["status"] = NetMgrEthernet.getStatus();
+            writer[JSON_KEY("t")     ] = "if";
+            writer[JSON_KEY("name")  ] = "eth";
+            writer[JSON_KEY("mac")   ] = NetMgrEthernet.getMacAddress();
+            writer[JSON_KEY("status")] = NetMgrEthernet.getStatus();
             if (NetMgrEthernet.isConnected()) {
-              writer["ip"  ] = NetMgrEthernet.getLocalIP();
+              writer[JSON_KEY("ip")  ] = NetMgrEthernet.getLocalIP();
             }
-            writer["static_ip"] = NetMgrEthernet.supportsStaticIP()?1:0;
+            writer[JSON_KEY("static_ip")] = NetMgrEthernet.supportsStaticIP()?1:0;
           writer.endObject();
           sendMsg(writer.buffer(), writer.dataSize());
           delay(10);
@@ -197,21 +158,19 @@ void BlynkInject::parse_message() {
 #endif
 #ifdef MM_WiFi_HaLow
         if (NetMgrHaLow.isHardwareAvailable()) {
-          JsonBufferWriter writer(buff, sizeof(buff));
-          writer.beginObject();
-            writer["t"     ] = "if";
-            writer["name"  ] = "wifi";
-            writer["mac"   ] = NetMgrHaLow.getMacAddress();
-            writer["scan"  ] = NetMgrHaLow.supportsScan()?1:0;
-            writer["5ghz"  ] = NetMgrHaLow.supports5GHz()?1:0;
-            writer["static_ip"] = NetMgrHaLow.supportsStaticIP()?1:0;
-          writer.endObject();
+          InlineJsonBufferWriter writer(buff, sizeof(buff));
+          writer.fill(JSON_TEMPLATE(R"json({"t":"if","name":"wifi","mac":?,"scan":?,"5ghz":?,"static_ip":?})json"),
+                      NetMgrHaLow.getMacAddress(),
+                      NetMgrHaLow.supportsScan()?1:0,
+                      NetMgrHaLow.supports5GHz()?1:0,
+                      NetMgrHaLow.supportsStaticIP()?1:0);
           sendMsg(writer.buffer(), writer.dataSize());
           delay(10);
         }
 #endif
         sendMsg(R"json({"t":"ifs_end"})json");
-    } else if (t == "scan") {
+    } break;
+    case INJECT_CMD_SCAN: {
 #if defined(NetMgr_WiFi)
         LOG_I_MOD("Scanning WiFi");
         sendMsg(R"json({"t":"scan_start"})json");
@@ -228,15 +187,9 @@ void BlynkInject::parse_message() {
           // skip weak and hidden networks
           if (rssi >= -90 && ssid.length()) {
 
-            JsonBufferWriter writer(buff, sizeof(buff));
-            writer.beginObject();
-              writer["t"     ] = "scan";
-              writer["ssid"  ] = ssid;
-              writer["bssid" ] = bssid;
-              writer["rssi"  ] = rssi;
-              writer["sec"   ] = sec;
-              writer["ch"    ] = chan;
-            writer.endObject();
+            InlineJsonBufferWriter writer(buff, sizeof(buff));
+            writer.fill(JSON_TEMPLATE(R"json({"t":"scan","ssid":?,"bssid":?,"rssi":?,"sec":?,"ch":?})json"),
+                        ssid, bssid, rssi, sec, chan);
             sendMsg(writer.buffer(), writer.dataSize());
             delay(10);
           }
@@ -262,15 +215,9 @@ void BlynkInject::parse_message() {
           // skip weak and hidden networks
           if (rssi >= -90 && ssid.length()) {
 
-            JsonBufferWriter writer(buff, sizeof(buff));
-            writer.beginObject();
-              writer["t"     ] = "scan";
-              writer["ssid"  ] = ssid;
-              writer["bssid" ] = bssid;
-              writer["rssi"  ] = rssi;
-              writer["sec"   ] = sec;
-              writer["ch"    ] = chan;
-            writer.endObject();
+            InlineJsonBufferWriter writer(buff, sizeof(buff));
+            writer.fill(JSON_TEMPLATE(R"json({"t":"scan","ssid":?,"bssid":?,"rssi":?,"sec":?,"ch":?})json"),
+                        ssid, bssid, rssi, sec, chan);
             sendMsg(writer.buffer(), writer.dataSize());
             delay(10);
           }
@@ -280,15 +227,19 @@ void BlynkInject::parse_message() {
 #else
     sendMsg(R"json({"t":"error","msg":"no wifi"})json");
 #endif
-    } else if (t == "reset") {
+    } break;
+    case INJECT_CMD_RESET: {
 #ifdef NetMgr_WiFi
         NetMgrWiFi.clearNetworks();
 #endif
         sendMsg(R"json({"t":"reset_ok"})json");
-    } else if (t == "reboot") {
+    } break;
+    case INJECT_CMD_REBOOT: {
         systemReboot();
-    } else {
+    } break;
+    default: {
         sendMsg(R"json({"t":"error","msg":"invalid command"})json");
+    } break;
     }
 }
 
@@ -19,6 +19,8 @@
   #include "tinyArduino.h"
 #endif
 
+#include "BlynkInjectProto.h"
+
 class BlynkInject {
 
 public:
@@ -54,11 +56,8 @@ public:
     void setProvisionCallback(provisionCb_t* cb);
     void setLastError(InjectError err) { _last_error = err; }
 
-    struct Config {
-        String    intf, ssid, pass, auth, host;
-        String    ip, mask, gw, dns, dns2;
-        bool      forceSave;
-    } _config;
+    typedef BlynkInjectConfig Config;
+    Config _config;
 
     #ifdef MM_WiFi_HaLow
     void bleRx(const uint8_t* data, size_t len) { _ble.onWrite(data, len); }
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024 Blynk Technologies Inc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Blynk.Inject message decoding, kept free of BLE and network
+ * dependencies so it can be built and benchmarked on the host
+ */
+
+#pragma once
+
+#include "json.h"
+#include "JSONSchema.h"
+#include "CborFormat.h"
+#include "CborReader.h"
+
+#include <utility>
+
+struct BlynkInjectConfig {
+    String    intf, ssid, pass, auth, host;
+    String    ip, mask, gw, dns, dns2;
+    bool      forceSave;
+};
+
+// Values of the "t" property, in the order of INJECT_COMMAND_NAMES
+enum InjectCommand {
+    INJECT_CMD_MALFORMED = -2, // Not a JSON object
+    INJECT_CMD_INVALID = -1,
+    INJECT_CMD_SET,
+    INJECT_CMD_CONNECT,
+    INJECT_CMD_INFO,
+    INJECT_CMD_IFS,
+    INJECT_CMD_SCAN,
+    INJECT_CMD_RESET,
+    INJECT_CMD_REBOOT,
+    INJECT_CMD_COUNT
+};
+
+// Message keys, in the order of INJECT_FIELDS
+enum InjectKey {
+    INJECT_KEY_INVALID = -1,
+    INJECT_KEY_T,
+    INJECT_KEY_IF,
+    INJECT_KEY_SSID,
+    INJECT_KEY_PASS,
+    INJECT_KEY_BLYNK,
+    INJECT_KEY_HOST,
+    INJECT_KEY_PORT,
+    INJECT_KEY_IP,
+    INJECT_KEY_MASK,
+    INJECT_KEY_GW,
+    INJECT_KEY_DNS,
+    INJECT_KEY_DNS2,
+    INJECT_KEY_SAVE,
+    INJECT_KEY_COUNT
+};
+
+static constexpr const char* const INJECT_COMMAND_NAMES[] = {
+    "set", "connect", "info", "ifs", "scan", "reset", "reboot"
+};
+
+static_assert(sizeof(INJECT_COMMAND_NAMES) / sizeof(INJECT_COMMAND_NAMES[0]) == INJECT_CMD_COUNT,
+        "INJECT_COMMAND_NAMES doesn't match InjectCommand");
+
+static constexpr auto INJECT_COMMANDS = makePerfectHash(INJECT_COMMAND_NAMES);
+static_assert(INJECT_COMMANDS.isValid(), "No perfect hash for INJECT_COMMAND_NAMES");
+
+// Properties of a message, in the order of InjectKey
+static constexpr JSONField<BlynkInjectConfig> INJECT_FIELDS[] = {
+    jsonIgnore<BlynkInjectConfig>("t"),
+    jsonField("if",     &BlynkInjectConfig::intf),
+    jsonField("ssid",   &BlynkInjectConfig::ssid),
+    jsonField("pass",   &BlynkInjectConfig::pass),
+    jsonField("blynk",  &BlynkInjectConfig::auth),
+    jsonField("host",   &BlynkInjectConfig::host),
+    jsonIgnore<BlynkInjectConfig>("port"),
+    jsonField("ip",     &BlynkInjectConfig::ip),
+    jsonField("mask",   &BlynkInjectConfig::mask),
+    jsonField("gw",     &BlynkInjectConfig::gw),
+    jsonField("dns",    &BlynkInjectConfig::dns),
+    jsonField("dns2",   &BlynkInjectConfig::dns2),
+    jsonPresence("save", &BlynkInjectConfig::forceSave),
+};
+
+static_assert(sizeof(INJECT_FIELDS) / sizeof(INJECT_FIELDS[0]) == INJECT_KEY_COUNT,
+        "INJECT_FIELDS doesn't match InjectKey");
+
+static constexpr auto INJECT_SCHEMA = makeJSONSchema(INJECT_FIELDS);
+static_assert(INJECT_SCHEMA.isValid(), "No perfect hash for INJECT_FIELDS");
+static_assert(INJECT_KEY_COUNT <= 32, "InjectMessageReader::storedFields() doesn't fit all keys");
+
+// Stores properties of a message to the config as they are parsed, but only
+// if the message is a "set" command. The first "t" property determines the command
+class InjectMessageReader: public JSONSchemaReader<BlynkInjectConfig, INJECT_KEY_COUNT> {
+public:
+    // In replay mode, stores all properties that precede "t" regardless of the command
+    explicit InjectMessageReader(BlynkInjectConfig& cfg, bool replay = false)
+        : JSONSchemaReader(INJECT_SCHEMA, cfg)
+        , _cmd(INJECT_CMD_INVALID)
+        , _stored(0)
+        , _hasType(false)
+        , _deferred(false)
+        , _replay(replay)
+    {}
+
+    // Parses a CBOR-encoded message
+    bool parseCbor(const char* data, size_t size) {
+        char buf[BUFFER_SIZE];
+        CborReader parser(*this, buf, sizeof(buf));
+        return parser.parse(data, size);
+    }
+
+    InjectCommand command() const { return _cmd; }
+
+    // True if some properties were skipped because they precede "t"
+    bool isDeferred() const { return _deferred; }
+
+    // Bit mask of the InjectKey fields that were stored
+    uint32_t storedFields() const { return _stored; }
+
+protected:
+    virtual bool accept(int field, spark::JSONType, const char* val, size_t size) override {
+        if (field == INJECT_KEY_T) {
+            if (!_hasType && !_replay) {
+                _cmd = (InjectCommand)INJECT_COMMANDS.find(val, size);
+            }
+            _hasType = true;
+            return false;
+        }
+        bool store = false;
+        if (_replay) {
+            store = !_hasType;
+        } else if (!_hasType) {
+            _deferred = true;
+        } else {
+            store = (_cmd == INJECT_CMD_SET);
+        }
+        if (store) {
+            _stored |= 1u << field;
+        }
+        return store;
+    }
+
+private:
+    InjectCommand _cmd;
+    uint32_t      _stored;
+    bool          _hasType;
+    bool          _deferred;
+    bool          _replay;
+};
+
+// True if the message is a CBOR map. JSON text never starts with such a byte
+static inline
+bool injectIsCborMessage(const char* data, size_t size) {
+    return size > 0 && ((uint8_t)data[0] & CBOR_MAJOR_MASK) == CBOR_MAP;
+}
+
+static inline
+bool injectParseMessage(InjectMessageReader& reader, const char* data, size_t size) {
+    return injectIsCborMessage(data, size) ? reader.parseCbor(data, size) : reader.parse(data, size);
+}
+
+// Decodes a JSON or CBOR message and returns its command. Properties of a "set" message
+// are stored to cfg, and invalidKeys is set if any of them is not supported. cfg is left
+// unchanged if the message can't be parsed
+static inline
+InjectCommand injectDecodeMessage(const char* json, size_t size, BlynkInjectConfig& cfg, bool& invalidKeys) {
+    // The reader stores values as soon as they are parsed, so they are collected separately
+    // and moved to cfg once the whole message is parsed
+    BlynkInjectConfig decoded = {};
+    InjectMessageReader reader(decoded);
+    if (!injectParseMessage(reader, json, size)) {
+        return INJECT_CMD_MALFORMED;
+    }
+    const InjectCommand cmd = reader.command();
+    invalidKeys = (cmd == INJECT_CMD_SET && reader.unknownKeys() > 0);
+    if (cmd != INJECT_CMD_SET) {
+        return cmd;
+    }
+    uint32_t stored = reader.storedFields();
+    if (reader.isDeferred()) {
+        // Some properties precede "t", which the app never does. Go over them again
+        InjectMessageReader replay(decoded, true);
+        injectParseMessage(replay, json, size);
+        stored |= replay.storedFields();
+    }
+    for (int key = 0; stored; ++key, stored >>= 1) {
+        if (stored & 1) {
+            INJECT_SCHEMA.move(cfg, decoded, key);
+        }
+    }
+    return cmd;
+}
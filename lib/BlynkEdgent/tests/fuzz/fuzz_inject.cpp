@@ -0,0 +1,108 @@
+/*
+ * Fuzz target for Blynk.Inject message decoding, i.e. what BlynkInject::parse_message() does
+ * with a message received over BLE.
+ *
+ * Decoding is checked to be deterministic, and for valid messages with a single "t" property,
+ * to match a straightforward decoder built on JSONValue. Messages with \u escapes are not
+ * compared, since JSONValue only decodes escaped ASCII characters. CBOR messages, i.e. inputs
+ * starting with a map, are only checked to decode deterministically.
+ *
+ * libFuzzer (from this directory), using the corpus and the standalone driver of tinyArduino:
+ *   T=../../../tinyArduino J=../../../JsonWriter/src
+ *   clang -g -O1 -fsanitize=fuzzer-no-link,address,undefined -I$T -I$T/tests/include -c \
+ *       $T/jsmn.c $T/itoa.c $T/avr/dtostrf.c
+ *   clang++ -std=gnu++17 -g -O1 -fsanitize=fuzzer,address,undefined -fpermissive -I../../src \
+ *       -I$T -I$T/tests/include -I$J fuzz_inject.cpp $T/wiring_json.cpp $T/JSONNumber.cpp $T/WString.cpp \
+ *       $T/print.cpp $J/CborReader.cpp $J/NumberFormat.cpp jsmn.o itoa.o dtostrf.o -o fuzz_inject
+ *   ./fuzz_inject -dict=$T/tests/fuzz/json.dict $T/tests/fuzz/corpus
+ *
+ * For AFL++ or replaying a corpus, add $T/tests/fuzz/fuzz_main.cpp and drop -fsanitize=fuzzer.
+ */
+
+#include "BlynkInjectProto.h"
+
+#include <string>
+
+namespace {
+
+void check(bool cond, const char *msg) {
+    if (!cond) {
+        fprintf(stderr, "Check failed: %s\n", msg);
+        abort();
+    }
+}
+
+bool isSameConfig(const BlynkInjectConfig &a, const BlynkInjectConfig &b) {
+    return a.intf == b.intf && a.ssid == b.ssid && a.pass == b.pass && a.auth == b.auth &&
+            a.host == b.host && a.ip == b.ip && a.mask == b.mask && a.gw == b.gw && a.dns == b.dns &&
+            a.dns2 == b.dns2 && a.forceSave == b.forceSave;
+}
+
+// Decodes a message by looking up every property in the schema. Returns INJECT_CMD_MALFORMED if
+// the message is not an object or it doesn't have exactly one "t" property
+InjectCommand referenceDecode(const char *json, size_t size, BlynkInjectConfig &cfg, bool &invalidKeys) {
+    const JSONValue msg = JSONValue::parseCopy(json, size);
+    if (!msg.isObject()) {
+        return INJECT_CMD_MALFORMED;
+    }
+    JSONString t;
+    int count = 0;
+    JSONObjectIterator it(msg);
+    while (it.next()) {
+        if (it.name() == "t") {
+            t = it.value().toString();
+            ++count;
+        }
+    }
+    if (count != 1) {
+        return INJECT_CMD_MALFORMED;
+    }
+    const InjectCommand cmd = (InjectCommand)INJECT_COMMANDS.find(t.data(), t.size());
+    invalidKeys = false;
+    if (cmd != INJECT_CMD_SET) {
+        return cmd;
+    }
+    JSONObjectIterator props(msg);
+    while (props.next()) {
+        const JSONString name = props.name();
+        const int key = INJECT_SCHEMA.find(name.data(), name.size());
+        if (key < 0) {
+            invalidKeys = true;
+            continue;
+        }
+        const JSONField<BlynkInjectConfig> &f = INJECT_SCHEMA.field(key);
+        if (f.type == JSONField<BlynkInjectConfig>::STRING) {
+            cfg.*f.str = props.value().toString().data();
+        } else if (f.type == JSONField<BlynkInjectConfig>::PRESENCE) {
+            cfg.*f.flag = true;
+        }
+    }
+    return cmd;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const char* const json = (const char*)data;
+    BlynkInjectConfig cfg1 = {}, cfg2 = {};
+    bool invalid1 = false, invalid2 = false;
+    const InjectCommand cmd = injectDecodeMessage(json, size, cfg1, invalid1);
+    check(cmd >= INJECT_CMD_MALFORMED && cmd < INJECT_CMD_COUNT, "Unknown command");
+    check(injectDecodeMessage(json, size, cfg2, invalid2) == cmd, "Decoding is not deterministic");
+    check(invalid1 == invalid2 && isSameConfig(cfg1, cfg2), "Decoding is not deterministic");
+    if (cmd != INJECT_CMD_SET) {
+        check(isSameConfig(cfg1, BlynkInjectConfig()), "Config changed by a message other than \"set\"");
+    }
+    if (cmd == INJECT_CMD_MALFORMED || memmem(json, size, "\\u", 2)) {
+        return 0;
+    }
+    BlynkInjectConfig cfg3 = {};
+    bool invalid3 = false;
+    const InjectCommand refCmd = referenceDecode(json, size, cfg3, invalid3);
+    if (refCmd != INJECT_CMD_MALFORMED) {
+        check(refCmd == cmd, "Command differs from the reference decoder");
+        check(invalid3 == invalid1, "Unknown keys differ from the reference decoder");
+        check(isSameConfig(cfg3, cfg1), "Config differs from the reference decoder");
+    }
+    return 0;
+}
@@ -0,0 +1,452 @@
+#include "unity.h"
+#include "bench.h"
+#include "inject_messages.h"
+#include "alloc_count.h"
+
+#include "BlynkInjectProto.h"
+#include "CborWriter.h"
+
+#include <string>
+#include <vector>
+
+static const unsigned ITERATIONS = 200000;
+
+// Decoder used by BlynkInject::parse_message() before it switched to a single pass
+// with perfect hash dispatch
+static InjectCommand legacyDecodeMessage(const JSONValue& outerObj, BlynkInjectConfig& _config, bool& foundInvalid) {
+    JSONString t;
+    {
+        JSONObjectIterator iter(outerObj);
+        while (iter.next()) {
+            if (iter.name() == "t") {
+                t = iter.value().toString();
+            }
+        }
+    }
+
+    foundInvalid = false;
+    if (t == "set") {
+        JSONObjectIterator item(outerObj);
+        while (item.next()) {
+          const JSONString& key = item.name();
+          if      (key == "t")      { /* skip */ }
+          else if (key == "if")     { _config.intf  = item.value().toString().data(); }
+          else if (key == "ssid")   { _config.ssid  = item.value().toString().data(); }
+          else if (key == "pass")   { _config.pass  = item.value().toString().data(); }
+          else if (key == "blynk")  { _config.auth  = item.value().toString().data(); }
+          else if (key == "host")   { _config.host  = item.value().toString().data(); }
+          else if (key == "port")   { /* ignored */ }
+          else if (key == "ip")     { _config.ip    = item.value().toString().data(); }
+          else if (key == "mask")   { _config.mask  = item.value().toString().data(); }
+          else if (key == "gw")     { _config.gw    = item.value().toString().data(); }
+          else if (key == "dns")    { _config.dns   = item.value().toString().data(); }
+          else if (key == "dns2")   { _config.dns2  = item.value().toString().data(); }
+          else if (key == "save")   { _config.forceSave = true; }
+          else                      { foundInvalid = true; }
+        }
+        return INJECT_CMD_SET;
+    }
+    else if (t == "connect") { return INJECT_CMD_CONNECT; }
+    else if (t == "info")    { return INJECT_CMD_INFO; }
+    else if (t == "ifs")     { return INJECT_CMD_IFS; }
+    else if (t == "scan")    { return INJECT_CMD_SCAN; }
+    else if (t == "reset")   { return INJECT_CMD_RESET; }
+    else if (t == "reboot")  { return INJECT_CMD_REBOOT; }
+    return INJECT_CMD_INVALID;
+}
+
+static InjectCommand decodeLegacy(const char* msg, BlynkInjectConfig& cfg, bool& invalid) {
+    std::string json = msg;
+    StaticJSONDocument<32> doc;
+    doc.parse(&json[0], json.size());
+    if (doc.value().type() != JSON_TYPE_OBJECT) {
+        return INJECT_CMD_MALFORMED;
+    }
+    return legacyDecodeMessage(doc.value(), cfg, invalid);
+}
+
+static InjectCommand decode(const char* msg, BlynkInjectConfig& cfg, bool& invalid) {
+    return injectDecodeMessage(msg, strlen(msg), cfg, invalid);
+}
+
+// Converts a JSON document to CBOR as it's parsed
+class CborTranscoder: public spark::JSONStreamHandler {
+public:
+    explicit CborTranscoder(CborWriter& writer) : writer_(writer) {}
+
+    virtual bool beginArray() override { writer_.beginArray(); return true; }
+    virtual bool endArray() override { writer_.endArray(); return true; }
+    virtual bool beginObject() override { writer_.beginObject(); return true; }
+    virtual bool endObject() override { writer_.endObject(); return true; }
+
+    virtual bool name(const char *name, size_t size) override {
+        part_.append(name, size);
+        writer_.name(part_.data(), part_.size());
+        part_.clear();
+        return true;
+    }
+
+    virtual bool value(spark::JSONType type, const char *val, size_t size) override {
+        part_.append(val, size);
+        switch (type) {
+        case spark::JSON_TYPE_BOOL:
+            writer_.value(val[0] == 't');
+            break;
+        case spark::JSON_TYPE_NUMBER:
+            if (strpbrk(part_.c_str(), ".eE")) {
+                writer_.value(strtod(part_.c_str(), nullptr));
+            } else {
+                writer_.value(strtoll(part_.c_str(), nullptr, 10));
+            }
+            break;
+        case spark::JSON_TYPE_STRING:
+            writer_.value(part_.data(), part_.size());
+            break;
+        default:
+            writer_.nullValue();
+            break;
+        }
+        part_.clear();
+        return true;
+    }
+
+    virtual bool valuePart(const char *data, size_t size) override {
+        part_.append(data, size);
+        return true;
+    }
+
+    virtual bool namePart(const char *data, size_t size) override {
+        part_.append(data, size);
+        return true;
+    }
+
+private:
+    CborWriter& writer_;
+    std::string part_;
+};
+
+static std::string toCbor(const char* json) {
+    std::vector<char> cbor(strlen(json) + 16);
+    CborBufferWriter writer(cbor.data(), cbor.size());
+    CborTranscoder transcoder(writer);
+    char buf[64];
+    spark::JSONStreamParser parser(transcoder, buf, sizeof(buf));
+    parser.write((const uint8_t*)json, strlen(json));
+    TEST_ASSERT_TRUE(parser.end());
+    TEST_ASSERT_TRUE(writer.dataSize() <= cbor.size());
+    return std::string(cbor.data(), writer.dataSize());
+}
+
+static void assertSameConfig(const BlynkInjectConfig& a, const BlynkInjectConfig& b) {
+    TEST_ASSERT_TRUE(a.intf == b.intf);
+    TEST_ASSERT_TRUE(a.ssid == b.ssid);
+    TEST_ASSERT_TRUE(a.pass == b.pass);
+    TEST_ASSERT_TRUE(a.auth == b.auth);
+    TEST_ASSERT_TRUE(a.host == b.host);
+    TEST_ASSERT_TRUE(a.ip == b.ip);
+    TEST_ASSERT_TRUE(a.mask == b.mask);
+    TEST_ASSERT_TRUE(a.gw == b.gw);
+    TEST_ASSERT_TRUE(a.dns == b.dns);
+    TEST_ASSERT_TRUE(a.dns2 == b.dns2);
+    TEST_ASSERT_EQUAL(a.forceSave, b.forceSave);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_perfect_hash() {
+    for (size_t i = 0; i < INJECT_CMD_COUNT; ++i) {
+        TEST_ASSERT_EQUAL(i, INJECT_COMMANDS.find(INJECT_COMMAND_NAMES[i]));
+    }
+    for (size_t i = 0; i < INJECT_KEY_COUNT; ++i) {
+        TEST_ASSERT_EQUAL(i, INJECT_SCHEMA.find(INJECT_FIELDS[i].name, strlen(INJECT_FIELDS[i].name)));
+    }
+    const char* unknown[] = { "", "s", "se", "sett", "SET", "dns3", "tt", "connec", "pas", "blynk.cloud" };
+    for (const char* key: unknown) {
+        TEST_ASSERT_EQUAL(-1, INJECT_COMMANDS.find(key));
+        TEST_ASSERT_EQUAL(-1, INJECT_SCHEMA.find(key, strlen(key)));
+    }
+    // Keys are compared by length, not as null-terminated strings
+    TEST_ASSERT_EQUAL(INJECT_KEY_DNS, INJECT_SCHEMA.find("dns2", 3));
+
+    static constexpr const char* const DUPLICATES[] = { "a", "b", "a" };
+    static_assert(!makePerfectHash(DUPLICATES).isValid(), "Duplicate keys must be rejected");
+}
+
+void test_decode_messages() {
+    const InjectCommand expected[] = {
+        INJECT_CMD_INFO, INJECT_CMD_IFS, INJECT_CMD_SCAN, INJECT_CMD_SET, INJECT_CMD_SET,
+        INJECT_CMD_CONNECT, INJECT_CMD_RESET
+    };
+    static_assert(sizeof(expected) / sizeof(expected[0]) == INJECT_MESSAGES_COUNT, "");
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        BlynkInjectConfig cfg1 = {}, cfg2 = {};
+        bool invalid1 = true, invalid2 = true;
+        TEST_ASSERT_EQUAL(expected[i], decodeLegacy(INJECT_MESSAGES[i], cfg1, invalid1));
+        TEST_ASSERT_EQUAL(expected[i], decode(INJECT_MESSAGES[i], cfg2, invalid2));
+        TEST_ASSERT_FALSE(invalid1);
+        TEST_ASSERT_FALSE(invalid2);
+        assertSameConfig(cfg1, cfg2);
+    }
+    BlynkInjectConfig cfg = {};
+    bool invalid = false;
+    decode(INJECT_MESSAGES[4], cfg, invalid);
+    TEST_ASSERT_TRUE(cfg.dns2 == "1.1.1.1");
+    TEST_ASSERT_TRUE(cfg.pass == "12345678");
+    TEST_ASSERT_TRUE(cfg.forceSave);
+    decode(INJECT_MESSAGES[3], cfg, invalid);
+    TEST_ASSERT_TRUE(cfg.pass == "Sup3r$ecret\"Pa55");
+}
+
+void test_decode_edge_cases() {
+    std::vector<std::string> messages = {
+        R"json({"t":"set","ssid":"a","bogus":1,"pass":"b"})json",   // Unknown key
+        R"json({"ssid":"a","pass":"b","t":"set","host":"h"})json",  // "t" is not first
+        R"json({"ssid":"a","t":"connect"})json",                    // Keys ignored for other commands
+        R"json({"t":"set","ssid":null,"pass":{"a":[1]},"ip":[]})json",
+        R"json({"t":"set","ssid":12,"pass":true})json",
+        R"json({"t":"sets"})json",
+        R"json({"t":"se"})json",
+        R"json({"t":1})json",
+        R"json({"cmd":"set"})json",
+        R"json({})json",
+        R"json([])json",
+        R"json("set")json",
+        R"json({"t":"info")json",
+        R"json(not json)json",
+    };
+    // Values that don't fit into the reader's buffer
+    messages.push_back(R"json({"t":"set","ssid":"a","save":")json" + std::string(100, 's') + R"json("})json");
+    messages.push_back(R"json({"t":"set","ssid":"a",")json" + std::string(64, 'k') + R"json(":1})json");
+    messages.push_back(R"json({"t":"set","ssid":"a","port":)json" + std::string(70, '4') + R"json(})json");
+    messages.push_back(R"json({"t":"set","ssid":)json" + std::string(70, '4') + R"json(})json");
+    for (const std::string& msg: messages) {
+        BlynkInjectConfig cfg1 = {}, cfg2 = {};
+        cfg1.ip = cfg2.ip = "1.2.3.4";
+        bool invalid1 = false, invalid2 = false;
+        TEST_ASSERT_EQUAL(decodeLegacy(msg.c_str(), cfg1, invalid1), decode(msg.c_str(), cfg2, invalid2));
+        TEST_ASSERT_EQUAL(invalid1, invalid2);
+        assertSameConfig(cfg1, cfg2);
+    }
+    // Values nested deeper than the parser tracks are skipped
+    BlynkInjectConfig cfg = {};
+    bool invalid = true;
+    const std::string deep = R"json({"t":"set","port":)json" + std::string(40, '[') + std::string(40, ']') +
+            R"json(,"ssid":"a"})json";
+    TEST_ASSERT_EQUAL(INJECT_CMD_SET, decode(deep.c_str(), cfg, invalid));
+    TEST_ASSERT_FALSE(invalid);
+    TEST_ASSERT_TRUE(cfg.ssid == "a");
+
+    // Long values are stored in parts
+    const std::string pass(200, 'p');
+    const std::string msg = R"json({"t":"set","pass":")json" + pass + R"json(","ssid":"s"})json";
+    invalid = true;
+    TEST_ASSERT_EQUAL(INJECT_CMD_SET, decode(msg.c_str(), cfg, invalid));
+    TEST_ASSERT_FALSE(invalid);
+    TEST_ASSERT_TRUE(cfg.pass == pass.c_str());
+    TEST_ASSERT_TRUE(cfg.ssid == "s");
+
+    // A message that fails to parse doesn't change the config
+    const std::string set = R"json({"t":"set","ssid":"new","pass":"secret","save":true})json";
+    const std::string cborSet = toCbor(set.c_str());
+    for (size_t size = 0; size < set.size(); ++size) {
+        TEST_ASSERT_EQUAL(INJECT_CMD_MALFORMED, injectDecodeMessage(set.data(), size, cfg, invalid));
+        TEST_ASSERT_TRUE(cfg.ssid == "s");
+        TEST_ASSERT_TRUE(cfg.pass == pass.c_str());
+        TEST_ASSERT_FALSE(cfg.forceSave);
+    }
+    for (size_t size = 1; size < cborSet.size(); ++size) {
+        TEST_ASSERT_EQUAL(INJECT_CMD_MALFORMED, injectDecodeMessage(cborSet.data(), size, cfg, invalid));
+        TEST_ASSERT_TRUE(cfg.ssid == "s");
+        TEST_ASSERT_FALSE(cfg.forceSave);
+    }
+    TEST_ASSERT_EQUAL(INJECT_CMD_SET, decode(set.c_str(), cfg, invalid));
+    TEST_ASSERT_TRUE(cfg.ssid == "new");
+    TEST_ASSERT_TRUE(cfg.pass == "secret");
+    TEST_ASSERT_TRUE(cfg.forceSave);
+}
+
+void test_decode_cbor() {
+    std::vector<std::string> messages(INJECT_MESSAGES, INJECT_MESSAGES + INJECT_MESSAGES_COUNT);
+    messages.push_back(R"json({"ssid":"a","pass":"b","t":"set","host":"h"})json");
+    messages.push_back(R"json({"t":"set","ssid":null,"pass":{"a":[1]},"ip":[],"bogus":1})json");
+    messages.push_back(R"json({"t":"set","ssid":12,"pass":true,"gw":1.5})json");
+    messages.push_back(R"json({"t":"set","pass":")json" + std::string(200, 'p') + R"json("})json");
+    messages.push_back(R"json({"t":"set","ssid":"a",")json" + std::string(64, 'k') + R"json(":1})json");
+    for (const std::string& msg: messages) {
+        const std::string cbor = toCbor(msg.c_str());
+        TEST_ASSERT_TRUE(injectIsCborMessage(cbor.data(), cbor.size()));
+        TEST_ASSERT_FALSE(injectIsCborMessage(msg.data(), msg.size()));
+        BlynkInjectConfig cfg1 = {}, cfg2 = {};
+        bool invalid1 = false, invalid2 = false;
+        TEST_ASSERT_EQUAL(decode(msg.c_str(), cfg1, invalid1),
+                injectDecodeMessage(cbor.data(), cbor.size(), cfg2, invalid2));
+        TEST_ASSERT_EQUAL(invalid1, invalid2);
+        assertSameConfig(cfg1, cfg2);
+    }
+    // Only maps are CBOR messages
+    BlynkInjectConfig cfg = {};
+    bool invalid = false;
+    TEST_ASSERT_EQUAL(INJECT_CMD_MALFORMED, injectDecodeMessage("\x9f\xff", 2, cfg, invalid));
+    TEST_ASSERT_EQUAL(INJECT_CMD_MALFORMED, injectDecodeMessage("\xbf\x61t", 3, cfg, invalid));
+    TEST_ASSERT_EQUAL(INJECT_CMD_INVALID, injectDecodeMessage("\xa0", 1, cfg, invalid));
+}
+
+// String handling of a provisioning session: the app reads the interfaces and a scan result, sends
+// the configuration and connects, and the configuration is saved
+static void runSession() {
+    String mac = "AA:BB:CC:DD:EE:FF"; // NetMgr::getMacAddress()
+    benchKeep(mac);
+    for (int i = 0; i < 15; ++i) {
+        String ssid, sec, bssid; // NetMgr::scanGetResult()
+        char name[32];
+        snprintf(name, sizeof(name), "Network %d", i);
+        ssid = name;
+        sec = "WPA2_PSK";
+        bssid = "AA:BB:CC:DD:EE:FF";
+        benchKeep(ssid);
+    }
+    BlynkInjectConfig config = {};
+    bool invalid = false;
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        injectDecodeMessage(INJECT_MESSAGES[i], strlen(INJECT_MESSAGES[i]), config, invalid);
+    }
+    BlynkInjectConfig saved = config;
+    benchKeep(saved);
+}
+
+void test_session_allocs() {
+    const unsigned long allocs = countAllocs(runSession);
+    if (ALLOC_COUNT_SUPPORTED) {
+        printf("\nHeap allocations per provisioning session: %lu\n", allocs);
+        // All the strings are short enough to be stored in String objects
+        TEST_ASSERT_EQUAL(0, allocs);
+    }
+}
+
+void bench_decode() {
+    printf("\n");
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const char* msg = INJECT_MESSAGES[i];
+        const size_t size = strlen(msg);
+        std::vector<char> buf(size);
+        BlynkInjectConfig cfg = {};
+        bool invalid = false;
+        // Parsing into a token tree, then matching keys with string compares
+        const double before = benchNs(ITERATIONS, [&]() {
+            memcpy(buf.data(), msg, size);
+            StaticJSONDocument<32> doc;
+            doc.parse(buf.data(), size);
+            benchKeep(legacyDecodeMessage(doc.value(), cfg, invalid));
+        });
+        // Streaming straight into the config
+        const double after = benchNs(ITERATIONS, [&]() {
+            memcpy(buf.data(), msg, size);
+            benchKeep(injectDecodeMessage(buf.data(), size, cfg, invalid));
+        });
+        char name[32];
+        snprintf(name, sizeof(name), "parse_message #%u (%uB)", (unsigned)i, (unsigned)size);
+        benchReport(name, before, after);
+    }
+
+    // Throughput over all messages
+    size_t total = 0;
+    std::vector<std::vector<char>> bufs;
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        total += strlen(INJECT_MESSAGES[i]);
+        bufs.emplace_back(INJECT_MESSAGES[i], INJECT_MESSAGES[i] + strlen(INJECT_MESSAGES[i]));
+    }
+    BlynkInjectConfig cfg = {};
+    bool invalid = false;
+    const double ns = benchNs(ITERATIONS / 10, [&]() {
+        for (const std::vector<char>& buf: bufs) {
+            benchKeep(injectDecodeMessage(buf.data(), buf.size(), cfg, invalid));
+        }
+    });
+    printf("parse_message, all messages  %10.1f ns  %7.1f MB/s\n", ns, total * 1000.0 / ns);
+
+    // Same messages in CBOR
+    size_t cborTotal = 0;
+    std::vector<std::string> cbor;
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        cbor.push_back(toCbor(INJECT_MESSAGES[i]));
+        cborTotal += cbor.back().size();
+    }
+    const double cborNs = benchNs(ITERATIONS / 10, [&]() {
+        for (const std::string& msg: cbor) {
+            benchKeep(injectDecodeMessage(msg.data(), msg.size(), cfg, invalid));
+        }
+    });
+    printf("parse_message, all messages, JSON -> CBOR  %10.1f ns -> %10.1f ns, %uB -> %uB\n",
+            ns, cborNs, (unsigned)total, (unsigned)cborTotal);
+}
+
+// Schema dispatch of a parsed message, the way InjectMessageReader stores a "set" command
+static InjectCommand schemaDecodeMessage(const JSONValue& outerObj, BlynkInjectConfig& cfg, bool& foundInvalid) {
+    InjectCommand cmd = INJECT_CMD_INVALID;
+    foundInvalid = false;
+    JSONObjectIterator item(outerObj);
+    while (item.next()) {
+        const JSONString& key = item.name();
+        const int field = INJECT_SCHEMA.find(key.data(), key.size());
+        const JSONString val = item.value().toString();
+        if (field == INJECT_KEY_T) {
+            cmd = (InjectCommand)INJECT_COMMANDS.find(val.data(), val.size());
+        } else if (field < 0) {
+            foundInvalid = true;
+        } else {
+            INJECT_SCHEMA.assign(cfg, field, item.value().type(), val.data(), val.size());
+        }
+    }
+    return cmd;
+}
+
+void bench_dispatch() {
+    // Key dispatch alone, without tokenizing
+    printf("\n");
+    std::string json = INJECT_MESSAGES[4];
+    StaticJSONDocument<32> doc;
+    doc.parse(&json[0], json.size());
+    const JSONValue msg = doc.value();
+    BlynkInjectConfig cfg = {};
+    bool invalid = false;
+    TEST_ASSERT_EQUAL(INJECT_CMD_SET, schemaDecodeMessage(msg, cfg, invalid));
+    const double before = benchNs(ITERATIONS, [&]() {
+        benchKeep(legacyDecodeMessage(msg, cfg, invalid));
+    });
+    const double after = benchNs(ITERATIONS, [&]() {
+        benchKeep(schemaDecodeMessage(msg, cfg, invalid));
+    });
+    benchReport("decode \"set\" (no parsing)", before, after);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_perfect_hash);
+    RUN_TEST(test_decode_messages);
+    RUN_TEST(test_decode_edge_cases);
+    RUN_TEST(test_decode_cbor);
+    RUN_TEST(test_session_allocs);
+    RUN_TEST(bench_decode);
+    RUN_TEST(bench_dispatch);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
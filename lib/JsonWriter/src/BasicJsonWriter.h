@@ -0,0 +1,800 @@
+#ifndef BasicJsonWriter_h
+#define BasicJsonWriter_h
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <type_traits>
+#include "tinyArduino.h"
+#include "NumberFormat.h"
+
+#ifdef JSON_WRITER_USE_UTF8_DECODER
+#include "Utf8Decoder.h"
+#endif
+
+#ifdef JSON_WRITER_USE_UTF8_DECODER
+#define JSON_KEY_ESCAPE_DEL 1
+#else
+#define JSON_KEY_ESCAPE_DEL 0
+#endif
+
+// Number of characters in a property name after escaping and quoting, including the separators
+constexpr size_t jsonKeySize(const char *name) {
+    size_t n = 4; // ,"":
+    for (; *name; ++name) {
+        const unsigned char c = *name;
+        if (c == '"' || c == '\\' || c == 0x08 || c == 0x09 || c == 0x0A || c == 0x0C || c == 0x0D) {
+            n += 2;
+        } else if (c <= 0x1F || (JSON_KEY_ESCAPE_DEL && c == 0x7F)) {
+            n += 6;
+        } else {
+            n += 1;
+        }
+    }
+    return n;
+}
+
+// Property name that is escaped and quoted at compile time, along with the value separator that
+// may precede it and the name separator that follows it. Non-ASCII characters are written as is,
+// regardless of setAsciiOnly(). Use JSON_KEY() to create one
+template <size_t N>
+class JsonKey {
+public:
+    constexpr explicit JsonKey(const char *name)
+      : _data()
+    {
+        size_t n = 0;
+        _data[n++] = ',';
+        _data[n++] = '"';
+        for (; *name; ++name) {
+            const unsigned char c = *name;
+            char e = 0;
+            switch (c) {
+            case '"':
+            case '\\':  e = c;   break;
+            case 0x08:  e = 'b'; break;
+            case 0x09:  e = 't'; break;
+            case 0x0A:  e = 'n'; break;
+            case 0x0C:  e = 'f'; break;
+            case 0x0D:  e = 'r'; break;
+            default:    break;
+            }
+            if (e) {
+                _data[n++] = '\\';
+                _data[n++] = e;
+            } else if (c <= 0x1F || (JSON_KEY_ESCAPE_DEL && c == 0x7F)) {
+                _data[n++] = '\\';
+                _data[n++] = 'u';
+                _data[n++] = '0';
+                _data[n++] = '0';
+                _data[n++] = '0' + (c >> 4);
+                _data[n++] = "0123456789ABCDEF"[c & 0xF];
+            } else {
+                _data[n++] = c;
+            }
+        }
+        _data[n++] = '"';
+        _data[n++] = ':';
+    }
+
+    const char* data() const {
+        return _data;
+    }
+
+    static constexpr size_t size() {
+        return N;
+    }
+
+private:
+    char _data[N];
+};
+
+// Escapes a property name at compile time, e.g. writer[JSON_KEY("ssid")] = ssid. The name must be
+// a string literal
+#define JSON_KEY(name) \
+    ([]() -> const JsonKey<jsonKeySize(name)>& { \
+        static constexpr JsonKey<jsonKeySize(name)> key(name); \
+        return key; \
+    }())
+
+// Number of value placeholders in a template, i.e. question marks outside of strings
+constexpr size_t jsonTemplateFields(const char *pattern) {
+    size_t n = 0;
+    bool str = false;
+    for (; *pattern; ++pattern) {
+        const char c = *pattern;
+        if (str) {
+            if (c == '\\' && pattern[1]) {
+                ++pattern;
+            } else if (c == '"') {
+                str = false;
+            }
+        } else if (c == '"') {
+            str = true;
+        } else if (c == '?') {
+            ++n;
+        }
+    }
+    return n;
+}
+
+// Number of characters in a template, excluding the placeholders
+constexpr size_t jsonTemplateSize(const char *pattern) {
+    size_t n = 0;
+    for (const char *s = pattern; *s; ++s) {
+        ++n;
+    }
+    return n - jsonTemplateFields(pattern);
+}
+
+// Document with a fixed structure, in which only some of the values change. The pattern is
+// written in JSON, with a question mark in place of each value, e.g. {"t":"scan","ssid":?}, and
+// is split into the static parts at compile time. The static parts are written as is, the values
+// are passed to BasicJsonWriter::fill() and formatted the usual way. Use JSON_TEMPLATE() to
+// create one
+template <size_t N, size_t F>
+class JsonTemplate {
+public:
+    constexpr explicit JsonTemplate(const char *pattern)
+      : _data()
+      , _bounds()
+    {
+        size_t n = 0;
+        size_t f = 0;
+        bool str = false;
+        for (; *pattern; ++pattern) {
+            const char c = *pattern;
+            if (str) {
+                if (c == '\\' && pattern[1]) {
+                    _data[n++] = c;
+                    ++pattern;
+                } else if (c == '"') {
+                    str = false;
+                }
+            } else if (c == '"') {
+                str = true;
+            } else if (c == '?') {
+                _bounds[++f] = n;
+                continue;
+            }
+            _data[n++] = *pattern;
+        }
+        _bounds[F + 1] = n;
+    }
+
+    const char* data() const {
+        return _data;
+    }
+
+    // Static part that precedes the value with the given index, or follows the last value if the
+    // index is equal to fields()
+    const char* part(size_t index) const {
+        return _data + _bounds[index];
+    }
+
+    size_t partSize(size_t index) const {
+        return _bounds[index + 1] - _bounds[index];
+    }
+
+    static constexpr size_t size() {
+        return N;
+    }
+
+    static constexpr size_t fields() {
+        return F;
+    }
+
+private:
+    char   _data[N + 1];
+    size_t _bounds[F + 2]; // Offsets of the static parts
+};
+
+// Prepares a template at compile time, e.g.
+// writer.fill(JSON_TEMPLATE(R"({"t":"scan","ssid":?,"rssi":?})"), ssid, rssi). The pattern must be
+// a string literal
+#define JSON_TEMPLATE(pattern) \
+    ([]() -> const JsonTemplate<jsonTemplateSize(pattern), jsonTemplateFields(pattern)>& { \
+        static constexpr JsonTemplate<jsonTemplateSize(pattern), jsonTemplateFields(pattern)> tpl(pattern); \
+        return tpl; \
+    }())
+
+namespace json_writer_detail {
+
+// Longest escape sequence, a surrogate pair
+const size_t MAX_ESCAPE_LENGTH = 12;
+
+// Characters findSpecial() stops at, in addition to quotes, backslashes and control characters
+enum SpecialChars {
+    SPECIAL_ASCII,    // None
+    SPECIAL_UTF8,     // DEL, and 0xC2 and 0xE2, which start U+0080..U+009F, U+2028 and U+2029 in UTF-8
+    SPECIAL_NON_ASCII // DEL and all non-ASCII bytes
+};
+
+// Returns a pointer to the first character in [s, end) that may need to be escaped
+template <SpecialChars special>
+const char* findSpecial(const char *s, const char *end);
+
+// Writes "\uXXXX" and returns its length
+size_t escapeCodePoint(unsigned c, char *buf);
+
+// Writes the escape sequence of a character found by findSpecial() and returns its length
+size_t escapeChar(unsigned char c, char *buf);
+
+// Decodes a character of valid UTF-8
+int decodeValid(const unsigned char *s, size_t *len);
+
+// NaN and infinite values are not permitted by the spec
+double toFinite(double val);
+
+// Longest number written by formatNumber()
+const size_t MAX_NUMBER_LENGTH = MAX_SHORTEST_DOUBLE_LENGTH;
+
+// Write a number the same way the respective BasicJsonWriter::value() does and return its length
+inline size_t formatNumber(unsigned long long val, char *buf) {
+    char tmp[MAX_INT_LENGTH];
+    char* const end = tmp + sizeof(tmp);
+    const char* const s = formatUInt64(val, end);
+    memcpy(buf, s, end - s);
+    return end - s;
+}
+
+inline size_t formatNumber(long long val, char *buf) {
+    if (val < 0) {
+        *buf = '-';
+        return formatNumber(0ull - (unsigned long long)val, buf + 1) + 1;
+    }
+    return formatNumber((unsigned long long)val, buf);
+}
+
+inline size_t formatNumber(int val, char *buf) {
+    return formatNumber((long long)val, buf);
+}
+
+inline size_t formatNumber(unsigned val, char *buf) {
+    return formatNumber((unsigned long long)val, buf);
+}
+
+inline size_t formatNumber(long val, char *buf) {
+    return formatNumber((long long)val, buf);
+}
+
+inline size_t formatNumber(unsigned long val, char *buf) {
+    return formatNumber((unsigned long long)val, buf);
+}
+
+inline size_t formatNumber(double val, char *buf) {
+    return formatDoubleShortest(toFinite(val), buf);
+}
+
+} // namespace json_writer_detail
+
+// JSON document writer that is not tied to a particular output. The derived class provides
+// write(const char *data, size_t size), and optionally printf(), which are called directly
+// rather than through a vtable, so that appends to a buffer are inlined into the writer's
+// methods. JsonWriter is the polymorphic variant
+template <typename Derived>
+class BasicJsonWriter {
+public:
+    class AssignHelper {
+    public:
+        AssignHelper(Derived& w) : _writer(w) {}
+
+        template <typename T>
+        void operator = (const T& val) {
+            _writer.value(val);
+        }
+
+    private:
+        Derived& _writer;
+    };
+
+    void setAsciiOnly(bool value = true) {
+        _asciiOnly = value;
+    }
+
+    Derived& beginArray();
+    Derived& endArray();
+    Derived& beginObject();
+    Derived& endObject();
+    Derived& name(const char *name);
+    Derived& name(const char *name, size_t size);
+    Derived& name(const String &name);
+    template <size_t N>
+    Derived& name(const JsonKey<N> &key);
+    Derived& value(bool val);
+    Derived& value(int val);
+    Derived& value(unsigned val);
+    Derived& value(long val);
+    Derived& value(long long val);
+    Derived& value(unsigned long val);
+    Derived& value(unsigned long long val);
+    Derived& value(double val, int precision);
+    Derived& value(double val);
+    Derived& value(const char *val);
+    Derived& value(const char *val, size_t size);
+    Derived& value(const String &val);
+    Derived& nullValue();
+
+    // Write the numbers as elements of the current array. They are formatted into a block on the
+    // stack, which is passed to write() when it's full, rather than one by one
+    template <typename T>
+    Derived& values(const T *data, size_t size);
+    template <typename T>
+    Derived& values(const T *data, size_t size, int precision);
+
+    // Writes a document or a value prepared with JSON_TEMPLATE(), substituting the arguments for
+    // its placeholders in order
+    template <size_t N, size_t F, typename... Args>
+    Derived& fill(const JsonTemplate<N, F> &tpl, const Args&... args);
+
+    AssignHelper operator[](const char* name) {
+        this->name(name, strlen(name));
+        return AssignHelper(derived());
+    }
+
+    AssignHelper operator[](const String &name) {
+        this->name(name.c_str(), name.length());
+        return AssignHelper(derived());
+    }
+
+    template <size_t N>
+    AssignHelper operator[](const JsonKey<N> &key) {
+        this->name(key);
+        return AssignHelper(derived());
+    }
+
+protected:
+    BasicJsonWriter();
+    ~BasicJsonWriter() = default;
+
+    // Used for values that can't be formatted otherwise
+    void printf(const char *fmt, ...);
+    void vprintf(const char *fmt, va_list args);
+
+private:
+    enum State {
+        BEGIN, // Beginning of a document or a compound value
+        NEXT,  // Expecting next element of a compound value
+        VALUE, // Expecting value of an object's property
+        KEY    // Expecting value of an object's property, the name separator is already written
+    };
+
+    State _state;
+    bool  _asciiOnly = false;
+
+    Derived& derived();
+    void writeSeparator();
+    void writeKey(const char *key, size_t size);
+    template <size_t N, size_t F, typename T, typename... Args>
+    void fillFields(const JsonTemplate<N, F> &tpl, size_t index, const T& val, const Args&... args);
+    template <size_t N, size_t F>
+    void fillFields(const JsonTemplate<N, F> &tpl, size_t index);
+    void writeEscaped(const char *data, size_t size);
+    void writeInt(long long val);
+    void writeUInt(unsigned long long val);
+    void put(char c);
+};
+
+template <typename Derived>
+inline BasicJsonWriter<Derived>::BasicJsonWriter()
+  : _state(BEGIN)
+{}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::beginArray() {
+    writeSeparator();
+    put('[');
+    _state = BEGIN;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::endArray() {
+    put(']');
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::beginObject() {
+    writeSeparator();
+    put('{');
+    _state = BEGIN;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::endObject() {
+    put('}');
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::name(const char *name) {
+    return this->name(name, strlen(name));
+}
+
+template <typename Derived>
+Derived& BasicJsonWriter<Derived>::name(const char *name, size_t size) {
+    writeSeparator();
+    writeEscaped(name, size);
+    _state = VALUE;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::name(const String &name) {
+    return this->name(name.c_str(), name.length());
+}
+
+template <typename Derived>
+template <size_t N>
+inline Derived& BasicJsonWriter<Derived>::name(const JsonKey<N> &key) {
+    writeKey(key.data(), key.size());
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(bool val) {
+    writeSeparator();
+    if (val) {
+        derived().write("true", 4);
+    } else {
+        derived().write("false", 5);
+    }
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(int val) {
+    writeSeparator();
+    writeInt(val);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(unsigned val) {
+    writeSeparator();
+    writeUInt(val);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(long val) {
+    writeSeparator();
+    writeInt(val);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(long long val) {
+    writeSeparator();
+    writeInt(val);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(unsigned long val) {
+    writeSeparator();
+    writeUInt(val);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(unsigned long long val) {
+    writeSeparator();
+    writeUInt(val);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+Derived& BasicJsonWriter<Derived>::value(double val, int precision) {
+    writeSeparator();
+    val = json_writer_detail::toFinite(val);
+    char buf[MAX_FIXED_DOUBLE_LENGTH];
+    const size_t n = formatDoubleFixed(val, precision, buf);
+    if (n) {
+        derived().write(buf, n);
+    } else {
+        derived().printf("%.*lf", precision, val); // Very large value or precision
+    }
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+Derived& BasicJsonWriter<Derived>::value(double val) {
+    writeSeparator();
+    char buf[MAX_SHORTEST_DOUBLE_LENGTH];
+    derived().write(buf, formatDoubleShortest(json_writer_detail::toFinite(val), buf));
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(const char *val) {
+    return value(val, strlen(val));
+}
+
+template <typename Derived>
+Derived& BasicJsonWriter<Derived>::value(const char *val, size_t size) {
+    writeSeparator();
+    writeEscaped(val, size);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::value(const String &val) {
+    return value(val.c_str(), val.length());
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::nullValue() {
+    writeSeparator();
+    derived().write("null", 4);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+template <typename T>
+Derived& BasicJsonWriter<Derived>::values(const T *data, size_t size) {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "Not a number type");
+    using json_writer_detail::MAX_NUMBER_LENGTH;
+    if (!size) {
+        return derived();
+    }
+    writeSeparator();
+    char buf[128];
+    size_t n = json_writer_detail::formatNumber(data[0], buf);
+    for (size_t i = 1; i < size; ++i) {
+        if (n > sizeof(buf) - 1 - MAX_NUMBER_LENGTH) {
+            derived().write(buf, n);
+            n = 0;
+        }
+        buf[n++] = ',';
+        n += json_writer_detail::formatNumber(data[i], buf + n);
+    }
+    derived().write(buf, n);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+template <typename T>
+Derived& BasicJsonWriter<Derived>::values(const T *data, size_t size, int precision) {
+    static_assert(std::is_floating_point<T>::value, "Not a floating point type");
+    if (!size) {
+        return derived();
+    }
+    writeSeparator();
+    char buf[128];
+    size_t n = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (n > sizeof(buf) - 1 - MAX_FIXED_DOUBLE_LENGTH) {
+            derived().write(buf, n);
+            n = 0;
+        }
+        if (i) {
+            buf[n++] = ',';
+        }
+        const double val = json_writer_detail::toFinite(data[i]);
+        const size_t len = formatDoubleFixed(val, precision, buf + n);
+        if (len) {
+            n += len;
+        } else {
+            derived().write(buf, n);
+            n = 0;
+            derived().printf("%.*lf", precision, val); // Very large value or precision
+        }
+    }
+    derived().write(buf, n);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+template <size_t N, size_t F, typename... Args>
+inline Derived& BasicJsonWriter<Derived>::fill(const JsonTemplate<N, F> &tpl, const Args&... args) {
+    static_assert(sizeof...(Args) == F, "Number of values doesn't match the template");
+    writeSeparator();
+    fillFields(tpl, 0, args...);
+    _state = NEXT;
+    return derived();
+}
+
+template <typename Derived>
+void BasicJsonWriter<Derived>::printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+template <typename Derived>
+void BasicJsonWriter<Derived>::vprintf(const char *fmt, va_list args) {
+    char buf[16];
+    va_list args2;
+    va_copy(args2, args);
+    int n = vsnprintf(buf, sizeof(buf), fmt, args);
+    if ((size_t)n >= sizeof(buf)) {
+        char buf[n + 1]; // Use larger buffer
+        n = vsnprintf(buf, sizeof(buf), fmt, args2);
+        if (n > 0) {
+            derived().write(buf, n);
+        }
+    } else if (n > 0) {
+        derived().write(buf, n);
+    }
+    va_end(args2);
+}
+
+template <typename Derived>
+inline Derived& BasicJsonWriter<Derived>::derived() {
+    return static_cast<Derived&>(*this);
+}
+
+template <typename Derived>
+inline void BasicJsonWriter<Derived>::writeSeparator() {
+    switch (_state) {
+    case NEXT:
+        put(',');
+        break;
+    case VALUE:
+        put(':');
+        break;
+    default:
+        break;
+    }
+}
+
+template <typename Derived>
+inline void BasicJsonWriter<Derived>::writeKey(const char *key, size_t size) {
+    // The key starts with a value separator, which is only needed after another property
+    if (_state == NEXT) {
+        derived().write(key, size);
+    } else {
+        derived().write(key + 1, size - 1);
+    }
+    _state = KEY;
+}
+
+template <typename Derived>
+template <size_t N, size_t F, typename T, typename... Args>
+inline void BasicJsonWriter<Derived>::fillFields(const JsonTemplate<N, F> &tpl, size_t index, const T& val, const Args&... args) {
+    derived().write(tpl.part(index), tpl.partSize(index));
+    _state = KEY; // The static part ends where a value is expected
+    value(val);
+    fillFields(tpl, index + 1, args...);
+}
+
+template <typename Derived>
+template <size_t N, size_t F>
+inline void BasicJsonWriter<Derived>::fillFields(const JsonTemplate<N, F> &tpl, size_t index) {
+    derived().write(tpl.part(index), tpl.partSize(index));
+}
+
+#ifdef JSON_WRITER_USE_UTF8_DECODER
+
+template <typename Derived>
+void BasicJsonWriter<Derived>::writeEscaped(const char *str, size_t size) {
+    using namespace json_writer_detail;
+    put('"');
+    const char *end = str + size;
+    const char *run = str; // Beginning of the characters that are written as is
+    const char *s = str;
+    bool validated = false;
+    for (;;) {
+        s = (_asciiOnly || !validated) ? findSpecial<SPECIAL_NON_ASCII>(s, end) : findSpecial<SPECIAL_UTF8>(s, end);
+        if (s == end) {
+            break;
+        }
+        if (!validated && (unsigned char)*s >= 0x80) {
+            // Invalid UTF-8 ends the string. What precedes it can be copied as is, except for
+            // the characters that need escaping
+            Utf8Decoder decoder(s, end - s);
+            end = s + decoder.skip_valid();
+            validated = true;
+            if (s == end) {
+                break;
+            }
+        }
+        char esc[MAX_ESCAPE_LENGTH];
+        size_t n = 0;
+        size_t len = 1;
+        if ((unsigned char)*s < 0x80) {
+            // Basic escaping, or DEL
+            n = escapeChar(*s, esc);
+        } else {
+            const int c = decodeValid((const unsigned char*)s, &len);
+            if (c <= 0x9F || c == 0x2028 || c == 0x2029) {
+                // Control
+                n = escapeCodePoint(c, esc);
+            } else if (_asciiOnly) {
+                if (c < 0x10000) {
+                    // Basic Multilingual Plane
+                    n = escapeCodePoint(c, esc);
+                } else {
+                    // Beyond the Basic Multilingual Plane
+                    const int cp = c - 0x10000;
+                    n = escapeCodePoint(0xD800 | (cp >> 10), esc);
+                    n += escapeCodePoint(0xDC00 | (cp & 0x3FF), esc + n);
+                }
+            }
+        }
+        if (n) {
+            if (s != run) {
+                derived().write(run, s - run);
+            }
+            derived().write(esc, n);
+            run = s + len;
+        } // else: Pass-through UTF8 bytes
+        s += len;
+    }
+    if (s != run) {
+        derived().write(run, s - run);
+    }
+    put('"');
+}
+
+#else
+
+template <typename Derived>
+void BasicJsonWriter<Derived>::writeEscaped(const char *str, size_t size) {
+    using namespace json_writer_detail;
+    put('"');
+    const char* const end = str + size;
+    for (;;) {
+        const char *s = findSpecial<SPECIAL_ASCII>(str, end);
+        if (s != str) {
+            derived().write(str, s - str); // Write preceeding characters
+        }
+        if (s == end) {
+            break;
+        }
+        char esc[MAX_ESCAPE_LENGTH];
+        derived().write(esc, escapeChar(*s, esc));
+        str = s + 1;
+    }
+    put('"');
+}
+
+#endif
+
+template <typename Derived>
+void BasicJsonWriter<Derived>::writeInt(long long val) {
+    char buf[MAX_INT_LENGTH];
+    char* const end = buf + sizeof(buf);
+    char *s;
+    if (val < 0) {
+        s = formatUInt64(0ull - (unsigned long long)val, end);
+        *--s = '-';
+    } else {
+        s = formatUInt64(val, end);
+    }
+    derived().write(s, end - s);
+}
+
+template <typename Derived>
+void BasicJsonWriter<Derived>::writeUInt(unsigned long long val) {
+    char buf[MAX_INT_LENGTH];
+    char* const end = buf + sizeof(buf);
+    const char* const s = formatUInt64(val, end);
+    derived().write(s, end - s);
+}
+
+template <typename Derived>
+inline void BasicJsonWriter<Derived>::put(char c) {
+    derived().write(&c, 1);
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CborFormat_h
+#define CborFormat_h
+
+/*
+ * Initial bytes of CBOR (RFC 8949) data items used by CborWriter and CborReader
+ */
+
+#include <stdint.h>
+
+// Major types, in the high 3 bits of the initial byte
+const uint8_t CBOR_UNSIGNED  = 0x00;
+const uint8_t CBOR_NEGATIVE  = 0x20;
+const uint8_t CBOR_BYTES     = 0x40;
+const uint8_t CBOR_TEXT      = 0x60;
+const uint8_t CBOR_ARRAY     = 0x80;
+const uint8_t CBOR_MAP       = 0xA0;
+const uint8_t CBOR_TAG       = 0xC0;
+const uint8_t CBOR_SIMPLE    = 0xE0;
+
+const uint8_t CBOR_MAJOR_MASK = 0xE0;
+
+// Additional information, in the low 5 bits of the initial byte
+const uint8_t CBOR_ARG_MASK       = 0x1F;
+const uint8_t CBOR_ARG_UINT8      = 24;
+const uint8_t CBOR_ARG_INDEFINITE = 31;
+
+const uint8_t CBOR_FALSE     = 0xF4;
+const uint8_t CBOR_TRUE      = 0xF5;
+const uint8_t CBOR_NULL      = 0xF6;
+const uint8_t CBOR_UNDEFINED = 0xF7;
+const uint8_t CBOR_FLOAT16   = 0xF9;
+const uint8_t CBOR_FLOAT32   = 0xFA;
+const uint8_t CBOR_FLOAT64   = 0xFB;
+const uint8_t CBOR_BREAK     = 0xFF;
+
+const uint8_t CBOR_ARRAY_INDEFINITE = CBOR_ARRAY | CBOR_ARG_INDEFINITE;
+const uint8_t CBOR_MAP_INDEFINITE   = CBOR_MAP | CBOR_ARG_INDEFINITE;
+
+#endif
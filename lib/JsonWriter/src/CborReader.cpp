@@ -0,0 +1,244 @@
+#include "CborReader.h"
+#include "CborFormat.h"
+#include "NumberFormat.h"
+
+#include <cmath>
+#include <string.h>
+
+namespace {
+
+// Marks an indefinite-length compound value in CborReader::_remaining
+const uint32_t INDEFINITE = 0xFFFFFFFF;
+
+double halfToDouble(uint16_t half) {
+    const int exp = (half >> 10) & 0x1F;
+    const int mant = half & 0x3FF;
+    double val;
+    if (exp == 0) {
+        val = std::ldexp(mant, -24); // Subnormal
+    } else if (exp == 0x1F) {
+        val = mant ? NAN : INFINITY;
+    } else {
+        val = std::ldexp(mant + 0x400, exp - 25);
+    }
+    return (half & 0x8000) ? -val : val;
+}
+
+} // namespace
+
+CborReader::CborReader(spark::JSONStreamHandler &handler, char *buf, size_t size)
+  : _h(handler)
+  , _buf(buf)
+  , _buf_size(size)
+  , _p(nullptr)
+  , _end(nullptr)
+  , _objects(0)
+  , _names(0)
+  , _depth(0)
+{}
+
+bool CborReader::parse(const char *data, size_t size) {
+    _p = (const uint8_t*)data;
+    _end = _p + size;
+    _objects = 0;
+    _names = 0;
+    _depth = 0;
+    do {
+        bool isName = false;
+        if (_depth > 0) {
+            const uint32_t bit = 1u << (_depth - 1);
+            isName = _names & bit;
+            uint32_t &remaining = _remaining[_depth - 1];
+            if (remaining == INDEFINITE) {
+                if (_p < _end && *_p == CBOR_BREAK) {
+                    ++_p;
+                    if ((_objects & bit) && !isName) {
+                        return false; // Key without a value
+                    }
+                    if (!endCompound()) {
+                        return false;
+                    }
+                    continue;
+                }
+            } else if (remaining == 0) {
+                if (!endCompound()) {
+                    return false;
+                }
+                continue;
+            } else {
+                --remaining;
+            }
+            if (_objects & bit) {
+                _names ^= bit;
+            }
+        }
+        uint8_t major, info;
+        uint64_t arg;
+        do {
+            if (!readHead(&major, &info, &arg)) {
+                return false;
+            }
+        } while (major == CBOR_TAG);
+        if (isName && major != CBOR_TEXT) {
+            return false;
+        }
+        bool ok;
+        switch (major) {
+        case CBOR_UNSIGNED:
+        case CBOR_NEGATIVE: {
+            char buf[MAX_INT_LENGTH + 2];
+            char* const end = buf + sizeof(buf) - 1;
+            *end = '\0';
+            char* s;
+            if (major == CBOR_UNSIGNED) {
+                s = formatUInt64(arg, end);
+            } else if (arg == UINT64_MAX) {
+                s = end - 21;
+                memcpy(s, "-18446744073709551616", 21);
+            } else {
+                s = formatUInt64(arg + 1, end);
+                *--s = '-';
+            }
+            ok = _h.value(spark::JSON_TYPE_NUMBER, s, end - s);
+            break;
+        }
+        case CBOR_TEXT:
+            ok = (info != CBOR_ARG_INDEFINITE) && readString(arg, isName);
+            break;
+        case CBOR_ARRAY:
+        case CBOR_MAP:
+            ok = beginCompound(major == CBOR_MAP, arg, info == CBOR_ARG_INDEFINITE);
+            break;
+        case CBOR_SIMPLE:
+            ok = readSimple(info, arg);
+            break;
+        default: // Byte strings
+            ok = false;
+            break;
+        }
+        if (!ok) {
+            return false;
+        }
+    } while (_depth > 0);
+    return _p == _end;
+}
+
+bool CborReader::readHead(uint8_t *major, uint8_t *info, uint64_t *arg) {
+    if (_p == _end) {
+        return false;
+    }
+    *major = *_p & CBOR_MAJOR_MASK;
+    *info = *_p & CBOR_ARG_MASK;
+    ++_p;
+    if (*info < CBOR_ARG_UINT8) {
+        *arg = *info;
+        return true;
+    }
+    if (*info == CBOR_ARG_INDEFINITE) {
+        // Breaks are handled by parse()
+        *arg = 0;
+        return *major == CBOR_TEXT || *major == CBOR_ARRAY || *major == CBOR_MAP;
+    }
+    if (*info > CBOR_ARG_UINT8 + 3) {
+        return false; // Reserved
+    }
+    const size_t n = 1 << (*info - CBOR_ARG_UINT8);
+    if ((size_t)(_end - _p) < n) {
+        return false;
+    }
+    uint64_t val = 0;
+    for (size_t i = 0; i < n; ++i) {
+        val = (val << 8) | _p[i];
+    }
+    _p += n;
+    *arg = val;
+    return true;
+}
+
+bool CborReader::readString(uint64_t size, bool isName) {
+    if (size > (uint64_t)(_end - _p)) {
+        return false;
+    }
+    const char* s = (const char*)_p;
+    _p += size;
+    const size_t part = _buf_size - 1;
+    while (size > part) {
+        memcpy(_buf, s, part);
+        _buf[part] = '\0';
+        if (!(isName ? _h.namePart(_buf, part) : _h.valuePart(_buf, part))) {
+            return false;
+        }
+        s += part;
+        size -= part;
+    }
+    memcpy(_buf, s, size);
+    _buf[size] = '\0';
+    return isName ? _h.name(_buf, size) : _h.value(spark::JSON_TYPE_STRING, _buf, size);
+}
+
+bool CborReader::readSimple(uint8_t info, uint64_t arg) {
+    double val;
+    switch (CBOR_SIMPLE | info) {
+    case CBOR_FALSE:
+        return _h.value(spark::JSON_TYPE_BOOL, "false", 5);
+    case CBOR_TRUE:
+        return _h.value(spark::JSON_TYPE_BOOL, "true", 4);
+    case CBOR_NULL:
+    case CBOR_UNDEFINED:
+        return _h.value(spark::JSON_TYPE_NULL, "null", 4);
+    case CBOR_FLOAT16:
+        val = halfToDouble(arg);
+        break;
+    case CBOR_FLOAT32: {
+        const uint32_t bits = arg;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        val = f;
+        break;
+    }
+    case CBOR_FLOAT64:
+        memcpy(&val, &arg, sizeof(val));
+        break;
+    default:
+        return false; // Unassigned simple value or unexpected break
+    }
+    if (!std::isfinite(val)) {
+        return _h.value(spark::JSON_TYPE_NULL, "null", 4);
+    }
+    char buf[MAX_SHORTEST_DOUBLE_LENGTH + 1];
+    const size_t n = formatDoubleShortest(val, buf);
+    buf[n] = '\0';
+    return _h.value(spark::JSON_TYPE_NUMBER, buf, n);
+}
+
+bool CborReader::beginCompound(bool object, uint64_t count, bool indefinite) {
+    if (_depth == MAX_DEPTH) {
+        return false;
+    }
+    if (!indefinite) {
+        if (count >= (object ? INDEFINITE / 2 : INDEFINITE)) {
+            return false;
+        }
+        if (object) {
+            count *= 2; // Keys and values
+        }
+    }
+    if (!(object ? _h.beginObject() : _h.beginArray())) {
+        return false;
+    }
+    const uint32_t bit = 1u << _depth;
+    if (object) {
+        _objects |= bit;
+        _names |= bit;
+    } else {
+        _objects &= ~bit;
+        _names &= ~bit;
+    }
+    _remaining[_depth++] = indefinite ? INDEFINITE : count;
+    return true;
+}
+
+bool CborReader::endCompound() {
+    const uint32_t bit = 1u << --_depth;
+    return (_objects & bit) ? _h.endObject() : _h.endArray();
+}
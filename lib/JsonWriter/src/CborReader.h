@@ -0,0 +1,44 @@
+#ifndef CborReader_h
+#define CborReader_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "wiring_json.h"
+
+// Parses a CBOR (RFC 8949) document and reports its contents to a JSON stream handler, so that
+// handlers such as JSONSchemaReader can read documents in either format. Maps, arrays, text
+// strings, integers, floats, booleans and null are supported. Map keys must be text strings,
+// tags are skipped, NaN and infinite values are reported as nulls. Byte strings and
+// indefinite-length text strings are not supported, and nesting is limited to MAX_DEPTH levels.
+//
+// Events follow the JSONStreamParser conventions: names and values are passed as null-terminated
+// strings, numbers in JSON notation, and names and strings that don't fit into the buffer in parts
+class CborReader {
+public:
+    static const unsigned MAX_DEPTH = 32;
+
+    CborReader(spark::JSONStreamHandler &handler, char *buf, size_t size);
+
+    // Parses a complete document. Returns false if the document is invalid or not supported,
+    // if there's data after it, or if the handler stopped parsing
+    bool parse(const char *data, size_t size);
+
+private:
+    spark::JSONStreamHandler &_h;
+    char*           _buf;
+    size_t          _buf_size;
+    const uint8_t*  _p;
+    const uint8_t*  _end;
+    uint32_t        _remaining[MAX_DEPTH]; // Items left in each open compound value
+    uint32_t        _objects; // Type of each open compound value, 1 stands for a map
+    uint32_t        _names; // 1 if the next item of an open map is a key
+    unsigned        _depth;
+
+    bool readHead(uint8_t *major, uint8_t *info, uint64_t *arg);
+    bool readString(uint64_t size, bool isName);
+    bool readSimple(uint8_t info, uint64_t arg);
+    bool beginCompound(bool object, uint64_t count, bool indefinite);
+    bool endCompound();
+};
+
+#endif
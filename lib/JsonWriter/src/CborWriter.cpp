@@ -0,0 +1,326 @@
+#include "CborWriter.h"
+#include "CborFormat.h"
+
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Returns the IEEE 754 half-precision representation of the value, or -1 if it can't be
+// represented exactly. Subnormal half-precision values are not used
+int32_t toHalf(float val) {
+    uint32_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t exp = (bits >> 23) & 0xFF;
+    const uint32_t mant = bits & 0x7FFFFF;
+    if (exp == 0 && mant == 0) {
+        return sign; // Zero
+    }
+    if (exp == 0xFF && mant == 0) {
+        return sign | 0x7C00; // Infinity
+    }
+    if (exp < 127 - 14 || exp > 127 + 15 || (mant & 0x1FFF) != 0) {
+        return -1;
+    }
+    return sign | ((exp - 127 + 15) << 10) | (mant >> 13);
+}
+
+int hexDigit(char c) {
+    return (c <= '9') ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+uint32_t hexValue(const char *s) {
+    return (hexDigit(s[0]) << 12) | (hexDigit(s[1]) << 8) | (hexDigit(s[2]) << 4) | hexDigit(s[3]);
+}
+
+// Decodes the escape sequence at the beginning of a string. Stores the UTF-8 encoded character
+// to buf and returns the length of the sequence. Unpaired surrogates are replaced with U+FFFD
+size_t unescape(const char *s, const char *end, char *buf, size_t *size) {
+    *size = 1;
+    switch (s[1]) {
+    case 'b':  buf[0] = 0x08; return 2;
+    case 't':  buf[0] = 0x09; return 2;
+    case 'n':  buf[0] = 0x0A; return 2;
+    case 'f':  buf[0] = 0x0C; return 2;
+    case 'r':  buf[0] = 0x0D; return 2;
+    case 'u':  break;
+    default:   buf[0] = s[1]; return 2; // Quote, slash or backslash
+    }
+    uint32_t cp = hexValue(s + 2);
+    size_t len = 6;
+    if (cp >= 0xD800 && cp <= 0xDBFF && end - s >= 12 && s[6] == '\\' && s[7] == 'u') {
+        const uint32_t low = hexValue(s + 8);
+        if (low >= 0xDC00 && low <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            len = 12;
+        }
+    }
+    if (cp >= 0xD800 && cp <= 0xDFFF) {
+        cp = 0xFFFD;
+    }
+    if (cp < 0x80) {
+        buf[0] = cp;
+    } else if (cp < 0x800) {
+        buf[0] = 0xC0 | (cp >> 6);
+        buf[1] = 0x80 | (cp & 0x3F);
+        *size = 2;
+    } else if (cp < 0x10000) {
+        buf[0] = 0xE0 | (cp >> 12);
+        buf[1] = 0x80 | ((cp >> 6) & 0x3F);
+        buf[2] = 0x80 | (cp & 0x3F);
+        *size = 3;
+    } else {
+        buf[0] = 0xF0 | (cp >> 18);
+        buf[1] = 0x80 | ((cp >> 12) & 0x3F);
+        buf[2] = 0x80 | ((cp >> 6) & 0x3F);
+        buf[3] = 0x80 | (cp & 0x3F);
+        *size = 4;
+    }
+    return len;
+}
+
+} // namespace
+
+CborWriter& CborWriter::beginArray() {
+    write(CBOR_ARRAY_INDEFINITE);
+    return *this;
+}
+
+CborWriter& CborWriter::endArray() {
+    write(CBOR_BREAK);
+    return *this;
+}
+
+CborWriter& CborWriter::beginObject() {
+    write(CBOR_MAP_INDEFINITE);
+    return *this;
+}
+
+CborWriter& CborWriter::endObject() {
+    write(CBOR_BREAK);
+    return *this;
+}
+
+CborWriter& CborWriter::name(const char *name, size_t size) {
+    return value(name, size);
+}
+
+CborWriter& CborWriter::value(bool val) {
+    write(val ? CBOR_TRUE : CBOR_FALSE);
+    return *this;
+}
+
+CborWriter& CborWriter::value(int val) {
+    return value((long long)val);
+}
+
+CborWriter& CborWriter::value(unsigned val) {
+    writeHead(CBOR_UNSIGNED, val);
+    return *this;
+}
+
+CborWriter& CborWriter::value(long val) {
+    return value((long long)val);
+}
+
+CborWriter& CborWriter::value(long long val) {
+    if (val < 0) {
+        writeHead(CBOR_NEGATIVE, -(unsigned long long)(val + 1));
+    } else {
+        writeHead(CBOR_UNSIGNED, val);
+    }
+    return *this;
+}
+
+CborWriter& CborWriter::value(unsigned long val) {
+    writeHead(CBOR_UNSIGNED, val);
+    return *this;
+}
+
+CborWriter& CborWriter::value(unsigned long long val) {
+    writeHead(CBOR_UNSIGNED, val);
+    return *this;
+}
+
+CborWriter& CborWriter::value(double val) {
+    uint8_t buf[9];
+    size_t n;
+    if (std::isnan(val)) {
+        buf[0] = CBOR_FLOAT16;
+        buf[1] = 0x7E;
+        buf[2] = 0x00;
+        n = 3;
+    } else if ((double)(float)val == val) {
+        const float f = val;
+        const int32_t half = toHalf(f);
+        if (half >= 0) {
+            buf[0] = CBOR_FLOAT16;
+            buf[1] = half >> 8;
+            buf[2] = half;
+            n = 3;
+        } else {
+            uint32_t bits;
+            memcpy(&bits, &f, sizeof(bits));
+            buf[0] = CBOR_FLOAT32;
+            for (int i = 0; i < 4; ++i) {
+                buf[1 + i] = bits >> (24 - i * 8);
+            }
+            n = 5;
+        }
+    } else {
+        uint64_t bits;
+        memcpy(&bits, &val, sizeof(bits));
+        buf[0] = CBOR_FLOAT64;
+        for (int i = 0; i < 8; ++i) {
+            buf[1 + i] = bits >> (56 - i * 8);
+        }
+        n = 9;
+    }
+    write((const char*)buf, n);
+    return *this;
+}
+
+CborWriter& CborWriter::value(const char *val, size_t size) {
+    writeHead(CBOR_TEXT, size);
+    write(val, size);
+    return *this;
+}
+
+CborWriter& CborWriter::nullValue() {
+    write(CBOR_NULL);
+    return *this;
+}
+
+void CborWriter::writeHead(uint8_t major, uint64_t arg) {
+    uint8_t buf[9];
+    size_t n;
+    if (arg < 24) {
+        buf[0] = major | arg;
+        n = 1;
+    } else if (arg <= 0xFF) {
+        buf[0] = major | 24;
+        n = 2;
+    } else if (arg <= 0xFFFF) {
+        buf[0] = major | 25;
+        n = 3;
+    } else if (arg <= 0xFFFFFFFF) {
+        buf[0] = major | 26;
+        n = 5;
+    } else {
+        buf[0] = major | 27;
+        n = 9;
+    }
+    for (size_t i = n - 1; i > 0; --i) {
+        buf[i] = arg;
+        arg >>= 8;
+    }
+    write((const char*)buf, n);
+}
+
+// Writes a text string containing JSON escape sequences, such as a name escaped by JsonKey
+void CborWriter::writeEscaped(const char *str, size_t size) {
+    const char* const end = str + size;
+    const char* esc = (const char*)memchr(str, '\\', size);
+    if (!esc) {
+        value(str, size);
+        return;
+    }
+    char buf[4];
+    size_t n = 0;
+    size_t len = esc - str;
+    for (const char* s = esc; s < end;) {
+        if (*s == '\\') {
+            s += unescape(s, end, buf, &n);
+            len += n;
+        } else {
+            ++s;
+            ++len;
+        }
+    }
+    writeHead(CBOR_TEXT, len);
+    while (esc) {
+        write(str, esc - str);
+        str = esc + unescape(esc, end, buf, &n);
+        write(buf, n);
+        esc = (const char*)memchr(str, '\\', end - str);
+    }
+    write(str, end - str);
+}
+
+// Translates a static part of a JSON template. Names are written the same way as string values,
+// so the structure of the document doesn't need to be tracked
+void CborWriter::writePart(const char *json, size_t size) {
+    const char* const end = json + size;
+    const char* s = json;
+    while (s < end) {
+        switch (*s) {
+        case '{':
+            beginObject();
+            ++s;
+            break;
+        case '[':
+            beginArray();
+            ++s;
+            break;
+        case '}':
+        case ']':
+            write(CBOR_BREAK);
+            ++s;
+            break;
+        case '"': {
+            const char* const str = ++s;
+            while (s < end && *s != '"') {
+                s += (*s == '\\') ? 2 : 1;
+            }
+            writeEscaped(str, std::min(s, end) - str);
+            ++s;
+            break;
+        }
+        case 't':
+            value(true);
+            s += 4;
+            break;
+        case 'f':
+            value(false);
+            s += 5;
+            break;
+        case 'n':
+            nullValue();
+            s += 4;
+            break;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9': {
+            char num[32]; // The part is not null-terminated
+            size_t n = 0;
+            bool integer = true;
+            for (; s < end && *s && strchr("+-.0123456789eE", *s); ++s) {
+                integer = integer && *s != '.' && *s != 'e' && *s != 'E';
+                if (n < sizeof(num) - 1) {
+                    num[n++] = *s;
+                }
+            }
+            num[n] = 0;
+            if (!integer) {
+                value(strtod(num, nullptr));
+            } else if (num[0] == '-') {
+                value(strtoll(num, nullptr, 10));
+            } else {
+                value(strtoull(num, nullptr, 10));
+            }
+            break;
+        }
+        default: // Separators and whitespace
+            ++s;
+            break;
+        }
+    }
+}
+
+void CborBufferWriter::write(const char *data, size_t size) {
+    if (_n < _buf_size) {
+        memcpy(_buf + _n, data, std::min(size, _buf_size - _n));
+    }
+    _n += size;
+}
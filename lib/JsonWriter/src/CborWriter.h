@@ -0,0 +1,229 @@
+#ifndef CborWriter_h
+#define CborWriter_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include "tinyArduino.h"
+#include "JsonWriter.h"
+
+// Abstract CBOR (RFC 8949) document writer with the same interface as JsonWriter, so that
+// a document can be written in either format by changing the writer's type. Objects and
+// arrays are written as indefinite-length maps and arrays, since the number of elements is
+// not known in advance. Strings are written as is and are expected to be valid UTF-8
+class CborWriter {
+public:
+    class AssignHelper {
+    public:
+        AssignHelper(CborWriter& w) : _writer(w) {}
+
+        template <typename T>
+        void operator = (const T& val) {
+            _writer.value(val);
+        }
+
+    private:
+        CborWriter& _writer;
+    };
+
+    CborWriter() = default;
+    virtual ~CborWriter() = default;
+
+    CborWriter& beginArray();
+    CborWriter& endArray();
+    CborWriter& beginObject();
+    CborWriter& endObject();
+    CborWriter& name(const char *name);
+    CborWriter& name(const char *name, size_t size);
+    CborWriter& name(const String &name);
+    template <size_t N>
+    CborWriter& name(const JsonKey<N> &key);
+    CborWriter& value(bool val);
+    CborWriter& value(int val);
+    CborWriter& value(unsigned val);
+    CborWriter& value(long val);
+    CborWriter& value(long long val);
+    CborWriter& value(unsigned long val);
+    CborWriter& value(unsigned long long val);
+    CborWriter& value(double val, int precision); // Precision only applies to text formats
+    CborWriter& value(double val);
+    CborWriter& value(const char *val);
+    CborWriter& value(const char *val, size_t size);
+    CborWriter& value(const String &val);
+    CborWriter& nullValue();
+
+    // Write the numbers as elements of the current array
+    template <typename T>
+    CborWriter& values(const T *data, size_t size);
+    template <typename T>
+    CborWriter& values(const T *data, size_t size, int precision); // Precision only applies to text formats
+
+    // Writes a document or a value prepared with JSON_TEMPLATE(), substituting the arguments for
+    // its placeholders in order. The static parts of the template are translated to CBOR
+    template <size_t N, size_t F, typename... Args>
+    CborWriter& fill(const JsonTemplate<N, F> &tpl, const Args&... args);
+
+    AssignHelper operator[](const char* name) {
+        this->name(name, strlen(name));
+        return AssignHelper(*this);
+    }
+
+    AssignHelper operator[](const String &name) {
+        this->name(name.c_str(), name.length());
+        return AssignHelper(*this);
+    }
+
+    template <size_t N>
+    AssignHelper operator[](const JsonKey<N> &key) {
+        this->name(key);
+        return AssignHelper(*this);
+    }
+
+protected:
+    virtual void write(const char *data, size_t size) = 0;
+
+private:
+    template <size_t N, size_t F, typename T, typename... Args>
+    void fillFields(const JsonTemplate<N, F> &tpl, size_t index, const T& val, const Args&... args);
+    template <size_t N, size_t F>
+    void fillFields(const JsonTemplate<N, F> &tpl, size_t index);
+
+    void writeHead(uint8_t major, uint64_t arg);
+    void writeEscaped(const char *str, size_t size);
+    void writePart(const char *json, size_t size);
+    void write(uint8_t b);
+};
+
+class CborStreamWriter
+  : public CborWriter
+{
+public:
+    explicit CborStreamWriter(Print &stream);
+
+    Print* stream() const;
+
+protected:
+    virtual void write(const char *data, size_t size) override;
+
+private:
+    Print &_stream;
+};
+
+class CborBufferWriter
+  : public CborWriter
+{
+public:
+    CborBufferWriter(char *buf, size_t size);
+
+    char* buffer() const;
+    size_t bufferSize() const;
+
+    size_t dataSize() const; // Returned value can be greater than buffer size
+
+protected:
+    virtual void write(const char *data, size_t size) override;
+
+private:
+    char*  _buf;
+    size_t _buf_size, _n;
+};
+
+
+// CborWriter
+inline CborWriter& CborWriter::name(const char *name) {
+    return this->name(name, strlen(name));
+}
+
+inline CborWriter& CborWriter::name(const String &name) {
+    return this->name(name.c_str(), name.length());
+}
+
+template <size_t N>
+inline CborWriter& CborWriter::name(const JsonKey<N> &key) {
+    // Skip the separators and quotes
+    writeEscaped(key.data() + 2, key.size() - 4);
+    return *this;
+}
+
+inline CborWriter& CborWriter::value(double val, int) {
+    return value(val);
+}
+
+inline CborWriter& CborWriter::value(const char *val) {
+    return value(val, strlen(val));
+}
+
+inline CborWriter& CborWriter::value(const String &val) {
+    return value(val.c_str(), val.length());
+}
+
+template <typename T>
+inline CborWriter& CborWriter::values(const T *data, size_t size) {
+    static_assert(std::is_arithmetic<T>::value && !std::is_same<T, bool>::value, "Not a number type");
+    for (size_t i = 0; i < size; ++i) {
+        value(data[i]);
+    }
+    return *this;
+}
+
+template <typename T>
+inline CborWriter& CborWriter::values(const T *data, size_t size, int) {
+    static_assert(std::is_floating_point<T>::value, "Not a floating point type");
+    return values(data, size);
+}
+
+template <size_t N, size_t F, typename... Args>
+inline CborWriter& CborWriter::fill(const JsonTemplate<N, F> &tpl, const Args&... args) {
+    static_assert(sizeof...(Args) == F, "Number of values doesn't match the template");
+    fillFields(tpl, 0, args...);
+    return *this;
+}
+
+template <size_t N, size_t F, typename T, typename... Args>
+inline void CborWriter::fillFields(const JsonTemplate<N, F> &tpl, size_t index, const T& val, const Args&... args) {
+    writePart(tpl.part(index), tpl.partSize(index));
+    value(val);
+    fillFields(tpl, index + 1, args...);
+}
+
+template <size_t N, size_t F>
+inline void CborWriter::fillFields(const JsonTemplate<N, F> &tpl, size_t index) {
+    writePart(tpl.part(index), tpl.partSize(index));
+}
+
+inline void CborWriter::write(uint8_t b) {
+    write((const char*)&b, 1);
+}
+
+// CborStreamWriter
+inline CborStreamWriter::CborStreamWriter(Print &stream)
+  : _stream(stream)
+{}
+
+inline Print* CborStreamWriter::stream() const {
+    return &_stream;
+}
+
+inline void CborStreamWriter::write(const char *data, size_t size) {
+    _stream.write((const uint8_t*)data, size);
+}
+
+// CborBufferWriter
+inline CborBufferWriter::CborBufferWriter(char *buf, size_t size)
+  : _buf(buf)
+  , _buf_size(size)
+  , _n(0)
+{}
+
+inline char* CborBufferWriter::buffer() const {
+    return _buf;
+}
+
+inline size_t CborBufferWriter::bufferSize() const {
+    return _buf_size;
+}
+
+inline size_t CborBufferWriter::dataSize() const {
+    return _n;
+}
+
+#endif
@@ -1,226 +1,139 @@
 #include "JsonWriter.h"
+#include "NumberFormat.h"
 
-#ifdef JSON_WRITER_USE_UTF8_DECODER
-#include "Utf8Decoder.h"
-#endif
+#include <cmath>
+#include <limits>
 
-JsonWriter& JsonWriter::beginArray() {
-    writeSeparator();
-    write('[');
-    _state = BEGIN;
-    return *this;
-}
-
-JsonWriter& JsonWriter::endArray() {
-    write(']');
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::beginObject() {
-    writeSeparator();
-    write('{');
-    _state = BEGIN;
-    return *this;
-}
-
-JsonWriter& JsonWriter::endObject() {
-    write('}');
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::name(const char *name, size_t size) {
-    writeSeparator();
-    writeEscaped(name, size);
-    _state = VALUE;
-    return *this;
-}
+namespace json_writer_detail {
 
-JsonWriter& JsonWriter::value(bool val) {
-    writeSeparator();
-    if (val) {
-        write("true", 4);
-    } else {
-        write("false", 5);
+double toFinite(double val) {
+    if (std::isnan(val)) {
+        return 0;
     }
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(int val) {
-    writeSeparator();
-    printf("%d", val);
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(unsigned val) {
-    writeSeparator();
-    printf("%u", val);
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(long val) {
-    writeSeparator();
-    printf("%ld", val);
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(unsigned long val) {
-    writeSeparator();
-    printf("%lu", val);
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(double val, int precision) {
-    writeSeparator();
-    printf("%.*lf", precision, val);
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(double val) {
-    writeSeparator();
-    printf("%g", val);
-    _state = NEXT;
-    return *this;
-}
-
-JsonWriter& JsonWriter::value(const char *val, size_t size) {
-    writeSeparator();
-    writeEscaped(val, size);
-    _state = NEXT;
-    return *this;
+    if (std::isinf(val)) {
+        return (val < 0) ? std::numeric_limits<double>::lowest() : std::numeric_limits<double>::max();
+    }
+    return val;
 }
 
-JsonWriter& JsonWriter::nullValue() {
-    writeSeparator();
-    write("null", 4);
-    _state = NEXT;
-    return *this;
-}
+namespace {
 
-void JsonWriter::printf(const char *fmt, ...) {
-    char buf[16];
-    va_list args;
-    va_start(args, fmt);
-    int n = vsnprintf(buf, sizeof(buf), fmt, args);
-    va_end(args);
-    if ((size_t)n >= sizeof(buf)) {
-        char buf[n + 1]; // Use larger buffer
-        va_start(args, fmt);
-        n = vsnprintf(buf, sizeof(buf), fmt, args);
-        va_end(args);
-        if (n > 0) {
-            write(buf, n);
-        }
-    } else if (n > 0) {
-        write(buf, n);
+template <SpecialChars special>
+inline bool isSpecial(unsigned char c) {
+    if (c < 0x20 || c == '"' || c == '\\') {
+        return true;
     }
-}
-
-void JsonWriter::writeSeparator() {
-    switch (_state) {
-    case NEXT:
-        write(',');
-        break;
-    case VALUE:
-        write(':');
-        break;
+    switch (special) {
+    case SPECIAL_UTF8:
+        return c == 0x7F || c == 0xC2 || c == 0xE2;
+    case SPECIAL_NON_ASCII:
+        return c >= 0x7F;
     default:
-        break;
+        return false;
     }
 }
 
-#ifdef JSON_WRITER_USE_UTF8_DECODER
+} // namespace
 
-void JsonWriter::writeEscaped(const char *str, size_t size) {
-    Utf8Decoder decoder(str, size);
-    const char* const HEXFMT = "\\u%04X";
-    write('"');
+template <SpecialChars special>
+const char* findSpecial(const char *s, const char *end) {
+    // SWAR: a byte of x is less than n if (x - n) & ~x has its high bit set, and the lowest
+    // such byte is always reported correctly. Words with a candidate byte are then checked a
+    // byte at a time
+    typedef uintptr_t word_t;
+    const word_t ones = (word_t)-1 / 0xff;
+    const word_t highs = ones * 0x80;
     for (;;) {
-        const int c = decoder.next();
-        if (c < 0) {
-            // Finish
-            //if (c == UTF8_END) => no errors detected
-            break;
-        } else if (c == '"' || c == '\\' || c <= 0x1F) {
-            // Basic escaping
-            write('\\');
-            switch (c) {
-            case '"':                                // Double quote
-            case '\\':  write((char)c);      break;  // Backslash
-            case 0x08:  write('b');          break;  // Backspace
-            case 0x09:  write('t');          break;  // Horizontal tab
-            case 0x0A:  write('n');          break;  // Line feed
-            case 0x0C:  write('f');          break;  // Form feed
-            case 0x0D:  write('r');          break;  // Carriage return
-            default:    printf(HEXFMT+1, c); break;
+        while ((size_t)(end - s) >= sizeof(word_t)) {
+            word_t v;
+            memcpy(&v, s, sizeof(v)); // Unaligned load
+            const word_t q = v ^ (ones * '"');
+            const word_t b = v ^ (ones * '\\');
+            if ((((v - ones * 0x20) & ~v) | ((q - ones) & ~q) | ((b - ones) & ~b)) & highs) {
+                break;
+            }
+            if (special != SPECIAL_ASCII && ((v | (v + ones)) & highs)) { // 0x7F and above
+                if (special == SPECIAL_NON_ASCII) {
+                    break;
+                }
+                const word_t d = v ^ (ones * 0x7F);
+                const word_t c2 = v ^ (ones * 0xC2);
+                const word_t e2 = v ^ (ones * 0xE2);
+                if ((((d - ones) & ~d) | ((c2 - ones) & ~c2) | ((e2 - ones) & ~e2)) & highs) {
+                    break;
+                }
             }
-        } else if (c < 0x7F) {
-            // ASCII
-            write((char)c);
-        } else if (c <= 0x9F || c == 0x2028 || c == 0x2029) {
-            // Control
-            printf(HEXFMT, c);
-        } else if (_asciiOnly) {
-            if (c < 0x10000) {
-                // Basic Multilingual Plane
-                printf(HEXFMT, c);
-            } else {
-                // Beyond the Basic Multilingual Plane
-                const int cp = c - 0x10000;
-                const uint16_t w0 = (uint16_t)(0xD800 | (cp >> 10));
-                const uint16_t w1 = (uint16_t)(0xDC00 | (cp & 0x3FF));
-                printf(HEXFMT, w0);
-                printf(HEXFMT, w1);
+            s += sizeof(word_t);
+        }
+        const char* const wordEnd = ((size_t)(end - s) > sizeof(word_t)) ? s + sizeof(word_t) : end;
+        for (; s != wordEnd; ++s) {
+            if (isSpecial<special>(*s)) {
+                return s;
             }
-        } else {
-            // Pass-through UTF8 bytes
-            const int off = decoder.at_byte();
-            const int len = decoder.symbol_size();
-            write(str + off, len);
+        }
+        if (s == end) {
+            return s;
         }
     }
-    write('"');
 }
 
-#else
-
-void JsonWriter::writeEscaped(const char *str, size_t size) {
-    write('"');
-    const char* const end = str + size;
-    const char *s = str;
-    while (s != end) {
-        const char c = *s;
-        if (c == '"' || c == '\\' || c <= 0x1F) {
-            write(str, s - str); // Write preceeding characters
-            write('\\');
-            switch (c) {
-            case '"':                                // Double quote
-            case '\\':  write(c);            break;  // Backslash
-            case 0x08:  write('b');          break;  // Backspace
-            case 0x09:  write('t');          break;  // Horizontal tab
-            case 0x0A:  write('n');          break;  // Line feed
-            case 0x0C:  write('f');          break;  // Form feed
-            case 0x0D:  write('r');          break;  // Carriage return
-            default:    printf("u%04X", (unsigned)c); break;
-            }
-            str = s + 1;
-        }
-        ++s;
+template const char* findSpecial<SPECIAL_ASCII>(const char *s, const char *end);
+template const char* findSpecial<SPECIAL_UTF8>(const char *s, const char *end);
+template const char* findSpecial<SPECIAL_NON_ASCII>(const char *s, const char *end);
+
+size_t escapeCodePoint(unsigned c, char *buf) {
+    static const char HEX_DIGITS[] = "0123456789ABCDEF";
+    buf[0] = '\\';
+    buf[1] = 'u';
+    buf[2] = HEX_DIGITS[(c >> 12) & 0xF];
+    buf[3] = HEX_DIGITS[(c >> 8) & 0xF];
+    buf[4] = HEX_DIGITS[(c >> 4) & 0xF];
+    buf[5] = HEX_DIGITS[c & 0xF];
+    return 6;
+}
+
+size_t escapeChar(unsigned char c, char *buf) {
+    char e;
+    switch (c) {
+    case '"':                   // Double quote
+    case '\\':  e = c;   break; // Backslash
+    case 0x08:  e = 'b'; break; // Backspace
+    case 0x09:  e = 't'; break; // Horizontal tab
+    case 0x0A:  e = 'n'; break; // Line feed
+    case 0x0C:  e = 'f'; break; // Form feed
+    case 0x0D:  e = 'r'; break; // Carriage return
+    default:    return escapeCodePoint(c, buf);
     }
-    if (s != str) {
-        write(str, s - str); // Write remaining characters
+    buf[0] = '\\';
+    buf[1] = e;
+    return 2;
+}
+
+int decodeValid(const unsigned char *s, size_t *len) {
+    if (s[0] < 0xE0) {
+        *len = 2;
+        return ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+    }
+    if (s[0] < 0xF0) {
+        *len = 3;
+        return ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
     }
-    write('"');
+    *len = 4;
+    return ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) | ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
 }
 
-#endif
+} // namespace json_writer_detail
+
+template class BasicJsonWriter<JsonWriter>;
+template class BasicJsonWriter<InlineJsonBufferWriter>;
+
+// JsonWriter
+void JsonWriter::printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vprintf(fmt, args);
+    va_end(args);
+}
 
 // JsonBufferWriter
 void JsonBufferWriter::write(const char *data, size_t size) {
@@ -237,3 +150,48 @@ void JsonBufferWriter::printf(const char *fmt, ...) {
     va_end(args);
     _n += n;
 }
+
+// InlineJsonBufferWriter
+void InlineJsonBufferWriter::printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(_buf + _n, (_n < _buf_size) ? _buf_size - _n : 0, fmt, args);
+    va_end(args);
+    _n += n;
+}
+
+// JsonSizeWriter
+void JsonSizeWriter::printf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    const int n = vsnprintf(nullptr, 0, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        _n += n;
+    }
+}
+
+void JsonChunkWriter::write(const char *data, size_t size) {
+    _total += size;
+    if (_buf_size == 0) {
+        return; // No chunk can be filled
+    }
+    while (size > 0) {
+        if (_n == 0 && size >= _buf_size) {
+            // Pass full chunks without copying them
+            _callback(data, _buf_size, _arg);
+            data += _buf_size;
+            size -= _buf_size;
+            continue;
+        }
+        const size_t n = std::min(size, _buf_size - _n);
+        memcpy(_buf + _n, data, n);
+        _n += n;
+        data += n;
+        size -= n;
+        if (_n == _buf_size) {
+            _callback(_buf, _n, _arg);
+            _n = 0;
+        }
+    }
+}
@@ -4,76 +4,22 @@
 #include <stdarg.h>
 #include "tinyArduino.h"
 #include "wiring_json.h"
+#include "BasicJsonWriter.h"
 
-class JsonWriter {
+// Polymorphic JSON writer, the base class of writers that are used through a reference or
+// a pointer. See BasicJsonWriter for writers that are not
+class JsonWriter
+  : public BasicJsonWriter<JsonWriter>
+{
 public:
-
-    class AssignHelper {
-    public:
-        AssignHelper(JsonWriter& w) : _writer(w) {}
-
-        template <typename T>
-        void operator = (const T& val) {
-            _writer.value(val);
-        }
-
-    private:
-        JsonWriter& _writer;
-    };
-
-    JsonWriter();
+    JsonWriter() = default;
     virtual ~JsonWriter() = default;
 
-    void setAsciiOnly(bool value = true) {
-        _asciiOnly = value;
-    }
-
-    JsonWriter& beginArray();
-    JsonWriter& endArray();
-    JsonWriter& beginObject();
-    JsonWriter& endObject();
-    JsonWriter& name(const char *name);
-    JsonWriter& name(const char *name, size_t size);
-    JsonWriter& name(const String &name);
-    JsonWriter& value(bool val);
-    JsonWriter& value(int val);
-    JsonWriter& value(unsigned val);
-    JsonWriter& value(long val);
-    JsonWriter& value(unsigned long val);
-    JsonWriter& value(double val, int precision);
-    JsonWriter& value(double val);
-    JsonWriter& value(const char *val);
-    JsonWriter& value(const char *val, size_t size);
-    JsonWriter& value(const String &val);
-    JsonWriter& nullValue();
-
-    AssignHelper operator[](const char* name) {
-        this->name(name, strlen(name));
-        return AssignHelper(*this);
-    }
-
-    AssignHelper operator[](const String &name) {
-        this->name(name.c_str(), name.length());
-        return AssignHelper(*this);
-    }
-
 protected:
     virtual void write(const char *data, size_t size) = 0;
     virtual void printf(const char *fmt, ...);
 
-private:
-    enum State {
-        BEGIN, // Beginning of a document or a compound value
-        NEXT,  // Expecting next element of a compound value
-        VALUE  // Expecting value of an object's property
-    };
-
-    State _state;
-    bool  _asciiOnly = false;
-
-    void writeSeparator();
-    void writeEscaped(const char *data, size_t size);
-    void write(char c);
+    friend class BasicJsonWriter<JsonWriter>;
 };
 
 class JsonStreamWriter
@@ -112,31 +58,75 @@ private:
     size_t _buf_size, _n;
 };
 
+// Same as JsonBufferWriter, but not polymorphic, so that appends to the buffer are inlined
+// into the writer's methods
+class InlineJsonBufferWriter
+  : public BasicJsonWriter<InlineJsonBufferWriter>
+{
+public:
+    InlineJsonBufferWriter(char *buf, size_t size);
 
-// JsonWriter
-inline JsonWriter::JsonWriter()
-  : _state(BEGIN)
-{}
+    const char* c_str();
+    char* buffer() const;
+    size_t bufferSize() const;
 
-inline JsonWriter& JsonWriter::name(const char *name) {
-    return this->name(name, strlen(name));
-}
+    size_t dataSize() const; // Returned value can be greater than buffer size
 
-inline JsonWriter& JsonWriter::name(const String &name) {
-    return this->name(name.c_str(), name.length());
-}
+protected:
+    void write(const char *data, size_t size);
+    void printf(const char *fmt, ...);
 
-inline JsonWriter& JsonWriter::value(const char *val) {
-    return value(val, strlen(val));
-}
+    friend class BasicJsonWriter<InlineJsonBufferWriter>;
 
-inline JsonWriter& JsonWriter::value(const String &val) {
-    return value(val.c_str(), val.length());
-}
+private:
+    char*  _buf;
+    size_t _buf_size, _n;
+};
 
-inline void JsonWriter::write(char c) {
-    write(&c, 1);
-}
+// Counts the size of a document without writing it, so that a buffer of the exact size can be
+// allocated before writing the document again with the same calls
+class JsonSizeWriter
+  : public JsonWriter
+{
+public:
+    JsonSizeWriter();
+
+    size_t dataSize() const;
+
+protected:
+    virtual void write(const char *data, size_t size) override;
+    virtual void printf(const char *fmt, ...) override;
+
+private:
+    size_t _n;
+};
+
+// Writes to a fixed-size buffer and passes it to a callback each time it fills up, so that
+// documents of any size can be written with constant memory, e.g. in chunks of a BLE MTU.
+// Call flush() at the end of the document to pass the remaining data. With a zero-size buffer
+// nothing is passed to the callback, and only dataSize() is counted
+class JsonChunkWriter
+  : public JsonWriter
+{
+public:
+    typedef void (*FlushCallback)(const char *data, size_t size, void *arg);
+
+    JsonChunkWriter(char *buf, size_t size, FlushCallback callback, void *arg = nullptr);
+
+    void flush();
+
+    size_t chunkSize() const;
+    size_t dataSize() const; // Total size of the data, including flushed chunks
+
+protected:
+    virtual void write(const char *data, size_t size) override;
+
+private:
+    char*         _buf;
+    size_t        _buf_size, _n, _total;
+    FlushCallback _callback;
+    void*         _arg;
+};
 
 // JsonStreamWriter
 inline JsonStreamWriter::JsonStreamWriter(Print &stream)
@@ -177,4 +167,81 @@ inline size_t JsonBufferWriter::dataSize() const {
     return _n;
 }
 
+// InlineJsonBufferWriter
+inline InlineJsonBufferWriter::InlineJsonBufferWriter(char *buf, size_t size)
+  : _buf(buf)
+  , _buf_size(size)
+  , _n(0)
+{}
+
+inline const char* InlineJsonBufferWriter::c_str() {
+    if (_n < _buf_size) {
+        _buf[_n] = '\0';
+    }
+    return _buf;
+}
+
+inline char* InlineJsonBufferWriter::buffer() const {
+    return _buf;
+}
+
+inline size_t InlineJsonBufferWriter::bufferSize() const {
+    return _buf_size;
+}
+
+inline size_t InlineJsonBufferWriter::dataSize() const {
+    return _n;
+}
+
+inline void InlineJsonBufferWriter::write(const char *data, size_t size) {
+    if (_n + size <= _buf_size) {
+        memcpy(_buf + _n, data, size); // Constant size for separators and literals
+    } else if (_n < _buf_size) {
+        memcpy(_buf + _n, data, _buf_size - _n);
+    }
+    _n += size;
+}
+
+// JsonSizeWriter
+inline JsonSizeWriter::JsonSizeWriter()
+  : _n(0)
+{}
+
+inline size_t JsonSizeWriter::dataSize() const {
+    return _n;
+}
+
+inline void JsonSizeWriter::write(const char*, size_t size) {
+    _n += size;
+}
+
+// JsonChunkWriter
+inline JsonChunkWriter::JsonChunkWriter(char *buf, size_t size, FlushCallback callback, void *arg)
+  : _buf(buf)
+  , _buf_size(size)
+  , _n(0)
+  , _total(0)
+  , _callback(callback)
+  , _arg(arg)
+{}
+
+inline void JsonChunkWriter::flush() {
+    if (_n > 0) {
+        _callback(_buf, _n, _arg);
+        _n = 0;
+    }
+}
+
+inline size_t JsonChunkWriter::chunkSize() const {
+    return _buf_size;
+}
+
+inline size_t JsonChunkWriter::dataSize() const {
+    return _total;
+}
+
+// Instantiated in JsonWriter.cpp
+extern template class BasicJsonWriter<JsonWriter>;
+extern template class BasicJsonWriter<InlineJsonBufferWriter>;
+
 #endif
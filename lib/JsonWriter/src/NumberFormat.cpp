@@ -0,0 +1,383 @@
+#include "NumberFormat.h"
+
+#include <cmath>
+#include <string.h>
+
+namespace {
+
+// Two-digit decimal representations of numbers from 0 to 99
+const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+const uint32_t POW10_32[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+const uint64_t POW10_64[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull,
+    1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull, 10000000000000ull,
+    100000000000000ull, 1000000000000000ull, 10000000000000000ull, 100000000000000000ull,
+    1000000000000000000ull, 10000000000000000000ull
+};
+
+// Normalized significands and binary exponents of 10^-348, 10^-340, ..., 10^340
+const uint64_t CACHED_POWERS_F[] = {
+    0xfa8fd5a0081c0288ull, 0xbaaee17fa23ebf76ull, 0x8b16fb203055ac76ull,
+    0xcf42894a5dce35eaull, 0x9a6bb0aa55653b2dull, 0xe61acf033d1a45dfull,
+    0xab70fe17c79ac6caull, 0xff77b1fcbebcdc4full, 0xbe5691ef416bd60cull,
+    0x8dd01fad907ffc3cull, 0xd3515c2831559a83ull, 0x9d71ac8fada6c9b5ull,
+    0xea9c227723ee8bcbull, 0xaecc49914078536dull, 0x823c12795db6ce57ull,
+    0xc21094364dfb5637ull, 0x9096ea6f3848984full, 0xd77485cb25823ac7ull,
+    0xa086cfcd97bf97f4ull, 0xef340a98172aace5ull, 0xb23867fb2a35b28eull,
+    0x84c8d4dfd2c63f3bull, 0xc5dd44271ad3cdbaull, 0x936b9fcebb25c996ull,
+    0xdbac6c247d62a584ull, 0xa3ab66580d5fdaf6ull, 0xf3e2f893dec3f126ull,
+    0xb5b5ada8aaff80b8ull, 0x87625f056c7c4a8bull, 0xc9bcff6034c13053ull,
+    0x964e858c91ba2655ull, 0xdff9772470297ebdull, 0xa6dfbd9fb8e5b88full,
+    0xf8a95fcf88747d94ull, 0xb94470938fa89bcfull, 0x8a08f0f8bf0f156bull,
+    0xcdb02555653131b6ull, 0x993fe2c6d07b7facull, 0xe45c10c42a2b3b06ull,
+    0xaa242499697392d3ull, 0xfd87b5f28300ca0eull, 0xbce5086492111aebull,
+    0x8cbccc096f5088ccull, 0xd1b71758e219652cull, 0x9c40000000000000ull,
+    0xe8d4a51000000000ull, 0xad78ebc5ac620000ull, 0x813f3978f8940984ull,
+    0xc097ce7bc90715b3ull, 0x8f7e32ce7bea5c70ull, 0xd5d238a4abe98068ull,
+    0x9f4f2726179a2245ull, 0xed63a231d4c4fb27ull, 0xb0de65388cc8ada8ull,
+    0x83c7088e1aab65dbull, 0xc45d1df942711d9aull, 0x924d692ca61be758ull,
+    0xda01ee641a708deaull, 0xa26da3999aef774aull, 0xf209787bb47d6b85ull,
+    0xb454e4a179dd1877ull, 0x865b86925b9bc5c2ull, 0xc83553c5c8965d3dull,
+    0x952ab45cfa97a0b3ull, 0xde469fbd99a05fe3ull, 0xa59bc234db398c25ull,
+    0xf6c69a72a3989f5cull, 0xb7dcbf5354e9beceull, 0x88fcf317f22241e2ull,
+    0xcc20ce9bd35c78a5ull, 0x98165af37b2153dfull, 0xe2a0b5dc971f303aull,
+    0xa8d9d1535ce3b396ull, 0xfb9b7cd9a4a7443cull, 0xbb764c4ca7a44410ull,
+    0x8bab8eefb6409c1aull, 0xd01fef10a657842cull, 0x9b10a4e5e9913129ull,
+    0xe7109bfba19c0c9dull, 0xac2820d9623bf429ull, 0x80444b5e7aa7cf85ull,
+    0xbf21e44003acdd2dull, 0x8e679c2f5e44ff8full, 0xd433179d9c8cb841ull,
+    0x9e19db92b4e31ba9ull, 0xeb96bf6ebadf77d9ull, 0xaf87023b9bf0ee6bull,
+};
+
+const int16_t CACHED_POWERS_E[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007,  -980,  -954,  -927,
+     -901,  -874,  -847,  -821,  -794,  -768,  -741,  -715,  -688,  -661,  -635,  -608,
+     -582,  -555,  -529,  -502,  -475,  -449,  -422,  -396,  -369,  -343,  -316,  -289,
+     -263,  -236,  -210,  -183,  -157,  -130,  -103,   -77,   -50,   -24,     3,    30,
+       56,    83,   109,   136,   162,   189,   216,   242,   269,   295,   322,   348,
+      375,   402,   428,   455,   481,   508,   534,   561,   588,   614,   641,   667,
+      694,   720,   747,   774,   800,   827,   853,   880,   907,   933,   960,   986,
+     1013,  1039,  1066,
+};
+
+const uint64_t DOUBLE_HIDDEN_BIT = 1ull << 52;
+const uint64_t DOUBLE_SIGNIFICAND_MASK = DOUBLE_HIDDEN_BIT - 1;
+const int      DOUBLE_EXPONENT_BIAS = 1075; // Including the significand's length
+
+// Floating-point number with a 64-bit significand and no hidden bit
+struct DiyFp {
+    uint64_t f;
+    int e;
+};
+
+// Upper 64 bits of the product, rounded
+DiyFp multiply(const DiyFp &a, const DiyFp &b) {
+    const uint64_t a1 = a.f >> 32, a0 = a.f & 0xffffffff;
+    const uint64_t b1 = b.f >> 32, b0 = b.f & 0xffffffff;
+    const uint64_t p11 = a1 * b1, p10 = a1 * b0, p01 = a0 * b1, p00 = a0 * b0;
+    const uint64_t mid = (p00 >> 32) + (p10 & 0xffffffff) + (p01 & 0xffffffff) + (1u << 31);
+    return { p11 + (p10 >> 32) + (p01 >> 32) + (mid >> 32), a.e + b.e + 64 };
+}
+
+DiyFp normalize(const DiyFp &v) {
+    const int lz = __builtin_clzll(v.f);
+    return { v.f << lz, v.e - lz };
+}
+
+// Returns the cached power of ten c such that the exponent of a normalized number with the
+// binary exponent e, multiplied by c, is in the [-60, -32] range. c is 10^-k
+DiyFp cachedPower(int e, int *k) {
+    // ceil((-61 - e) * log10(2)), the multiplication is exact for the range of double exponents
+    const int x = -61 - e;
+    const int dk = (x == 0) ? 0 : ((x * 78913) >> 18) + 1;
+    const int index = ((dk + 347) >> 3) + 1;
+    *k = 348 - index * 8;
+    return { CACHED_POWERS_F[index], CACHED_POWERS_E[index] };
+}
+
+// Moves the last digit towards w while the number stays within the rounding interval
+void grisuRound(char *digits, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw) {
+    while (rest < wpw && delta - rest >= tenKappa &&
+            (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+        --digits[len - 1];
+        rest += tenKappa;
+    }
+}
+
+// Generates the shortest digits of a number within (mp - delta, mp], closest to w
+int grisuDigits(const DiyFp &w, const DiyFp &mp, uint64_t delta, char *digits, int *k) {
+    const int shift = -mp.e;
+    const uint64_t one = 1ull << shift;
+    const uint64_t wpw = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> shift);
+    uint64_t p2 = mp.f & (one - 1);
+    int kappa = 1;
+    while (kappa < 10 && p1 >= POW10_32[kappa]) {
+        ++kappa;
+    }
+    int len = 0;
+    // Integral part
+    while (kappa > 0) {
+        --kappa;
+        const uint32_t d = p1 / POW10_32[kappa];
+        p1 %= POW10_32[kappa];
+        if (d || len) {
+            digits[len++] = '0' + d;
+        }
+        const uint64_t rest = ((uint64_t)p1 << shift) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            grisuRound(digits, len, delta, rest, (uint64_t)POW10_32[kappa] << shift, wpw);
+            return len;
+        }
+    }
+    // Fractional part
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        const char d = (char)(p2 >> shift);
+        if (d || len) {
+            digits[len++] = '0' + d;
+        }
+        p2 &= one - 1;
+        --kappa;
+        if (p2 < delta) {
+            *k += kappa;
+            grisuRound(digits, len, delta, p2, one, (-kappa < 20) ? wpw * POW10_64[-kappa] : 0);
+            return len;
+        }
+    }
+}
+
+// Writes the digits of a positive value, which is digits * 10^k
+int grisu2(double val, char *digits, int *k) {
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    const int be = (int)((bits >> 52) & 0x7ff);
+    DiyFp v;
+    if (be) {
+        v = { (bits & DOUBLE_SIGNIFICAND_MASK) | DOUBLE_HIDDEN_BIT, be - DOUBLE_EXPONENT_BIAS };
+    } else {
+        v = { bits & DOUBLE_SIGNIFICAND_MASK, 1 - DOUBLE_EXPONENT_BIAS };
+    }
+    // Boundaries of the rounding interval. The lower one is closer at powers of two
+    const DiyFp plus = normalize({ (v.f << 1) + 1, v.e - 1 });
+    DiyFp minus = (v.f == DOUBLE_HIDDEN_BIT && be > 1) ? DiyFp{ (v.f << 2) - 1, v.e - 2 } :
+            DiyFp{ (v.f << 1) - 1, v.e - 1 };
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    const DiyFp c = cachedPower(plus.e, k);
+    const DiyFp w = multiply(normalize(v), c);
+    DiyFp wp = multiply(plus, c);
+    DiyFp wm = multiply(minus, c);
+    // Account for the error of the multiplication
+    ++wm.f;
+    --wp.f;
+    return grisuDigits(w, wp, wp.f - wm.f, digits, k);
+}
+
+char* writeExponent(int e, char *s) {
+    *s++ = 'e';
+    if (e < 0) {
+        *s++ = '-';
+        e = -e;
+    } else {
+        *s++ = '+';
+    }
+    if (e >= 100) {
+        *s++ = '0' + e / 100;
+        e %= 100;
+        memcpy(s, DIGIT_PAIRS + e * 2, 2);
+        s += 2;
+    } else if (e >= 10) {
+        memcpy(s, DIGIT_PAIRS + e * 2, 2);
+        s += 2;
+    } else {
+        *s++ = '0' + e;
+    }
+    return s;
+}
+
+// Lays out len digits with the decimal point after the first point digits
+char* writeDecimal(const char *digits, int len, int point, char *s) {
+    if (point >= len && point <= 21) {
+        // 123000
+        memcpy(s, digits, len);
+        memset(s + len, '0', point - len);
+        return s + point;
+    }
+    if (point > 0 && point <= 21) {
+        // 123.45
+        memcpy(s, digits, point);
+        s[point] = '.';
+        memcpy(s + point + 1, digits + point, len - point);
+        return s + len + 1;
+    }
+    if (point > -6 && point <= 0) {
+        // 0.00123
+        s[0] = '0';
+        s[1] = '.';
+        memset(s + 2, '0', -point);
+        memcpy(s + 2 - point, digits, len);
+        return s + 2 - point + len;
+    }
+    // 1.23e-7
+    *s++ = digits[0];
+    if (len > 1) {
+        *s++ = '.';
+        memcpy(s, digits + 1, len - 1);
+        s += len - 1;
+    }
+    return writeExponent(point - 1, s);
+}
+
+// Multiplies a 128-bit binary fraction by 10 and returns the integral part of the result
+unsigned fractionTimes10(uint32_t *frac) {
+    uint32_t carry = 0;
+    for (int i = 3; i >= 0; --i) {
+        const uint64_t t = (uint64_t)frac[i] * 10 + carry;
+        frac[i] = (uint32_t)t;
+        carry = (uint32_t)(t >> 32);
+    }
+    return carry;
+}
+
+// Compares a 128-bit binary fraction with 1/2
+int compareWithHalf(const uint32_t *frac) {
+    if (frac[0] != 0x80000000) {
+        return (frac[0] > 0x80000000) ? 1 : -1;
+    }
+    return (frac[1] | frac[2] | frac[3]) ? 1 : 0;
+}
+
+// Same as formatUInt64(), but always writes 8 digits
+char* formatUInt32Padded8(uint32_t val, char *end) {
+    for (int i = 0; i < 4; ++i) {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + (val % 100) * 2, 2);
+        val /= 100;
+    }
+    return end;
+}
+
+char* formatUInt32(uint32_t val, char *end) {
+    while (val >= 100) {
+        const uint32_t i = (val % 100) * 2;
+        val /= 100;
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + i, 2);
+    }
+    if (val >= 10) {
+        end -= 2;
+        memcpy(end, DIGIT_PAIRS + val * 2, 2);
+    } else {
+        *--end = '0' + val;
+    }
+    return end;
+}
+
+} // namespace
+
+char* formatUInt64(uint64_t val, char *end) {
+    // 64-bit division is slow on 32-bit targets, so use it only to split the number into 8-digit parts
+    while (val > UINT32_MAX) {
+        const uint64_t q = val / 100000000;
+        end = formatUInt32Padded8((uint32_t)(val - q * 100000000), end);
+        val = q;
+    }
+    return formatUInt32((uint32_t)val, end);
+}
+
+size_t formatDoubleShortest(double val, char *buf) {
+    char *s = buf;
+    if (std::signbit(val)) {
+        *s++ = '-';
+        val = -val;
+    }
+    if (val == 0) {
+        *s++ = '0';
+        return s - buf;
+    }
+    char digits[18];
+    int k = 0;
+    const int len = grisu2(val, digits, &k);
+    s = writeDecimal(digits, len, len + k, s);
+    return s - buf;
+}
+
+size_t formatDoubleFixed(double val, int precision, char *buf) {
+    if (precision < 0 || precision > MAX_FIXED_DOUBLE_PRECISION) {
+        return 0;
+    }
+    uint64_t bits;
+    memcpy(&bits, &val, sizeof(bits));
+    const int be = (int)((bits >> 52) & 0x7ff);
+    if (be >= DOUBLE_EXPONENT_BIAS + 12) {
+        return 0; // Not less than 2^64, or not finite
+    }
+    // val = m * 2^e
+    uint64_t m = bits & DOUBLE_SIGNIFICAND_MASK;
+    int e = 1 - DOUBLE_EXPONENT_BIAS;
+    if (be) {
+        m |= DOUBLE_HIDDEN_BIT;
+        e = be - DOUBLE_EXPONENT_BIAS;
+    }
+    // Split the value into the integral part and a 128-bit binary fraction, exactly
+    uint64_t intPart = 0, fracHi = 0, fracLo = 0;
+    if (e >= 0) {
+        intPart = m << e;
+    } else if (e > -64) {
+        intPart = m >> -e;
+        fracHi = (m & ((1ull << -e) - 1)) << (64 + e);
+    } else if (e >= -128) {
+        const int shift = 128 + e; // Position of the significand in the fraction
+        fracHi = shift ? m >> (64 - shift) : 0;
+        fracLo = (shift < 64) ? m << shift : 0;
+    } else if (m) {
+        // Less than 2^-75, all digits are zero and it's rounded down
+        fracLo = 1;
+    }
+    uint32_t frac[4] = { (uint32_t)(fracHi >> 32), (uint32_t)fracHi, (uint32_t)(fracLo >> 32), (uint32_t)fracLo };
+    char digits[MAX_FIXED_DOUBLE_PRECISION];
+    for (int i = 0; i < precision; ++i) {
+        digits[i] = '0' + fractionTimes10(frac);
+    }
+    // Round half to even
+    const int cmp = compareWithHalf(frac);
+    const bool odd = precision ? (digits[precision - 1] & 1) : (intPart & 1);
+    if (cmp > 0 || (cmp == 0 && odd)) {
+        int i = precision - 1;
+        while (i >= 0 && digits[i] == '9') {
+            digits[i--] = '0';
+        }
+        if (i >= 0) {
+            ++digits[i];
+        } else {
+            ++intPart;
+        }
+    }
+    char *s = buf;
+    if (bits >> 63) {
+        *s++ = '-';
+    }
+    char tmp[MAX_INT_LENGTH];
+    const char* const p = formatUInt64(intPart, tmp + sizeof(tmp));
+    const size_t n = tmp + sizeof(tmp) - p;
+    memcpy(s, p, n);
+    s += n;
+    if (precision) {
+        *s++ = '.';
+        memcpy(s, digits, precision);
+        s += precision;
+    }
+    return s - buf;
+}
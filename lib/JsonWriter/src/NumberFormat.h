@@ -0,0 +1,35 @@
+#ifndef NumberFormat_h
+#define NumberFormat_h
+
+/*
+ * Number formatting for JsonWriter that doesn't depend on the printf() family
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Length of the longest 64-bit integer, including the sign
+const size_t MAX_INT_LENGTH = 20;
+
+// Length of the longest number written by formatDoubleShortest()
+const size_t MAX_SHORTEST_DOUBLE_LENGTH = 25;
+
+// Maximum precision and length of a number written by formatDoubleFixed()
+const int    MAX_FIXED_DOUBLE_PRECISION = 17;
+const size_t MAX_FIXED_DOUBLE_LENGTH = 1 + MAX_INT_LENGTH + 1 + MAX_FIXED_DOUBLE_PRECISION;
+
+// Formats a number backwards, ending at end, and returns a pointer to its first character
+char* formatUInt64(uint64_t val, char *end);
+
+// Writes the shortest decimal representation that reads back as the same value (Grisu2, which
+// is the shortest in all but a small fraction of cases and always round-trips) and returns its
+// length. The notation follows JavaScript: 0.000001, 1.5e-7, 123.25, 100000000000000000000, 1e+21.
+// The value must be finite
+size_t formatDoubleShortest(double val, char *buf);
+
+// Writes the value with the given number of fractional digits, rounded exactly the same way
+// "%.*f" does, and returns its length. Returns 0 if the value is not less than 2^64 in magnitude
+// or the precision is out of range, in which case nothing is written
+size_t formatDoubleFixed(double val, int precision, char *buf);
+
+#endif
@@ -27,6 +27,8 @@ SOFTWARE.
 
 #include "Utf8Decoder.h"
 
+#include <stdint.h>
+
 /*
     Very Strict UTF-8 Decoder
 
@@ -51,30 +53,34 @@ SOFTWARE.
 */
 
 /*
-    Get the next byte. It returns UTF8_END if there are no more bytes.
+    The decoding is driven by Bjoern Hoehrmann's DFA (http://bjoern.hoehrmann.de/utf-8/decoder/dfa/,
+    MIT license), which is exactly as strict as the rules above. The first part of the table maps
+    bytes to character classes, the second part maps a state and a character class to the next
+    state. States are multiples of 12.
 */
-int Utf8Decoder::get() {
-    int c;
-    if (_index >= _length) {
-        return UTF8_END;
-    }
-    c = _input[_index] & 0xFF;
-    _index += 1;
-    return c;
-}
+enum {
+    UTF8_ACCEPT = 0,
+    UTF8_REJECT = 12
+};
+
+static const uint8_t UTF8_DFA[] = {
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // 00..1f
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // 20..3f
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // 40..5f
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, // 60..7f
+    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9,9, // 80..9f
+    7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7, // a0..bf
+    8,8,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2,2, // c0..df
+    10,3,3,3,3,3,3,3,3,3,3,3,3,4,3,3,11,6,6,6,5,8,8,8,8,8,8,8,8,8,8,8, // e0..ff
+
+     0,12,24,36,60,96,84,12,12,12,48,72, 12,12,12,12,12,12,12,12,12,12,12,12,
+    12, 0,12,12,12,12,12, 0,12, 0,12,12, 12,24,12,12,12,12,12,24,12,24,12,12,
+    12,12,12,12,12,12,12,24,12,12,12,12, 12,24,12,12,12,12,12,12,12,24,12,12,
+    12,12,12,12,12,12,12,36,12,36,12,12, 12,36,12,12,12,12,12,36,12,36,12,12,
+    12,36,12,12,12,12,12,12,12,12,12,12
+};
 
 
-/*
-    Get the 6-bit payload of the next continuation byte.
-    Return UTF8_ERROR if it is not a contination byte.
-*/
-int Utf8Decoder::cont() {
-    int c = get();
-    return ((c & 0xC0) == 0x80)
-        ? (c & 0x3F)
-        : UTF8_ERROR;
-}
-
 /*
     Get the current byte offset. This is generally used in error reporting.
 */
@@ -101,62 +107,80 @@ int Utf8Decoder::at_character() const {
          or  UTF8_ERROR (error)
 */
 int Utf8Decoder::next() {
-    int c;  /* the first byte of the character */
-    int c1; /* the first continuation character */
-    int c2; /* the second continuation character */
-    int c3; /* the third continuation character */
-    int r;  /* the result */
+    uint32_t c;     /* the current byte */
+    uint32_t type;  /* its character class */
+    uint32_t state; /* the state of the DFA */
+    uint32_t r;     /* the result */
 
     if (_index >= _length) {
         return _index == _length ? UTF8_END : UTF8_ERROR;
     }
     _byte = _index;
     _char += 1;
-    c = get();
-/*
-    Zero continuation (0 to 127)
-*/
-    if ((c & 0x80) == 0) {
-        return c;
+    c = _input[_index++] & 0xFF;
+    if (c < 0x80) {
+        return c; /* ASCII */
     }
-/*
-    One continuation (128 to 2047)
-*/
-    if ((c & 0xE0) == 0xC0) {
-        c1 = cont();
-        if (c1 >= 0) {
-            r = ((c & 0x1F) << 6) | c1;
-            if (r >= 128) {
-                return r;
-            }
+    type = UTF8_DFA[c];
+    state = UTF8_DFA[256 + type];
+    r = (0xFF >> type) & c;
+    /* States above UTF8_REJECT expect continuation bytes */
+    while (state > UTF8_REJECT) {
+        if (_index >= _length) {
+            return UTF8_ERROR; /* truncated */
         }
+        c = _input[_index++] & 0xFF;
+        state = UTF8_DFA[256 + state + UTF8_DFA[c]];
+        r = (r << 6) | (c & 0x3F);
+    }
+    return (state == UTF8_ACCEPT) ? (int)r : UTF8_ERROR;
+}
 
-/*
-    Two continuations (2048 to 55295 and 57344 to 65535)
-*/
-    } else if ((c & 0xF0) == 0xE0) {
-        c1 = cont();
-        c2 = cont();
-        if ((c1 | c2) >= 0) {
-            r = ((c & 0x0F) << 12) | (c1 << 6) | c2;
-            if (r >= 2048 && (r < 55296 || r > 57343)) {
-                return r;
-            }
-        }
 
 /*
-    Three continuations (65536 to 1114111)
+    Skip valid characters. Runs of ASCII are skipped 8 bytes at a time.
+    Returns: the byte offset of the first invalid or truncated character,
+             which becomes the current one, or the length of the input
 */
-    } else if ((c & 0xF8) == 0xF0) {
-        c1 = cont();
-        c2 = cont();
-        c3 = cont();
-        if ((c1 | c2 | c3) >= 0) {
-            r = ((c & 0x07) << 18) | (c1 << 12) | (c2 << 6) | c3;
-            if (r >= 65536 && r <= 1114111) {
-                return r;
+int Utf8Decoder::skip_valid() {
+    int i = _index;
+    int chars = 0;
+    while (i < _length) {
+        const uint32_t c = _input[i] & 0xFF;
+        if (c < 0x80) {
+            i += 1;
+            chars += 1;
+            while (i + 8 <= _length) {
+                uint64_t w;
+                memcpy(&w, _input + i, sizeof(w));
+                if (w & 0x8080808080808080ull) {
+                    break;
+                }
+                i += 8;
+                chars += 8;
             }
+            continue;
+        }
+        /* Two-byte characters are the most common ones, check them directly */
+        if (c >= 0xC2 && c <= 0xDF && i + 1 < _length && (_input[i + 1] & 0xC0) == 0x80) {
+            i += 2;
+            chars += 1;
+            continue;
+        }
+        int j = i + 1;
+        uint32_t state = UTF8_DFA[256 + UTF8_DFA[c]];
+        while (state > UTF8_REJECT && j < _length) {
+            state = UTF8_DFA[256 + state + UTF8_DFA[_input[j] & 0xFF]];
+            j += 1;
+        }
+        if (state != UTF8_ACCEPT) {
+            break; /* invalid or truncated */
         }
+        i = j;
+        chars += 1;
     }
-    return UTF8_ERROR;
+    _index = i;
+    _byte = i;
+    _char += chars;
+    return i;
 }
@@ -17,14 +17,14 @@ public:
 
   int   next();
 
+  // Skips valid characters and returns the byte offset of the first
+  // invalid or truncated one, or the length of the input
+  int   skip_valid();
+
   int   at_byte()       const;
   int   at_character()  const;
   int   symbol_size()   const { return _index - _byte; }
 
-private:
-  int   get();
-  int   cont();
-
 private:
   int   _index = 0;
   int   _char = 0;
@@ -0,0 +1,368 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "CborReader.h"
+#include "CborWriter.h"
+#include "JsonWriter.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <string>
+
+using namespace spark;
+
+static const unsigned ITERATIONS = 100000;
+
+// Records parser events as text, so that JSON and CBOR documents can be compared
+class Recorder: public JSONStreamHandler {
+public:
+    std::string log;
+
+    virtual bool beginArray() override { log += "["; return true; }
+    virtual bool endArray() override { log += "]"; return true; }
+    virtual bool beginObject() override { log += "{"; return true; }
+    virtual bool endObject() override { log += "}"; return true; }
+
+    virtual bool name(const char *name, size_t size) override {
+        TEST_ASSERT_EQUAL(strlen(name), size);
+        log += "name:" + std::string(name, size) + ";";
+        return true;
+    }
+
+    virtual bool value(JSONType type, const char *val, size_t size) override {
+        TEST_ASSERT_EQUAL('\0', val[size]);
+        log += typeName(type) + part_ + std::string(val, size) + ";";
+        part_.clear();
+        return true;
+    }
+
+    virtual bool valuePart(const char *data, size_t size) override {
+        TEST_ASSERT_EQUAL(strlen(data), size);
+        part_.append(data, size);
+        ++parts;
+        return true;
+    }
+
+    unsigned parts = 0;
+
+private:
+    std::string part_;
+
+    static std::string typeName(JSONType type) {
+        switch (type) {
+        case JSON_TYPE_NULL:    return "";
+        case JSON_TYPE_BOOL:    return "b:";
+        case JSON_TYPE_NUMBER:  return "n:";
+        case JSON_TYPE_STRING:  return "s:";
+        default:                return "?:";
+        }
+    }
+};
+
+static std::string toHex(const char* data, size_t size) {
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    for (size_t i = 0; i < size; ++i) {
+        hex += HEX_DIGITS[(uint8_t)data[i] >> 4];
+        hex += HEX_DIGITS[(uint8_t)data[i] & 0xF];
+    }
+    return hex;
+}
+
+static std::string fromHex(const char* hex) {
+    std::string data;
+    for (; hex[0] && hex[1]; hex += 2) {
+        data += (char)std::stoi(std::string(hex, 2), nullptr, 16);
+    }
+    return data;
+}
+
+template <typename T>
+static std::string encode(T val) {
+    char buf[32];
+    CborBufferWriter writer(buf, sizeof(buf));
+    writer.value(val);
+    return toHex(buf, writer.dataSize());
+}
+
+static bool decode(const std::string& data, std::string* log, size_t bufSize = 64) {
+    Recorder rec;
+    std::string buf(bufSize, '\0');
+    CborReader reader(rec, &buf[0], buf.size());
+    const bool ok = reader.parse(data.data(), data.size());
+    *log = rec.log;
+    return ok;
+}
+
+static bool decodeJson(const char* data, size_t size, std::string* log) {
+    Recorder rec;
+    char buf[64];
+    JSONStreamParser parser(rec, buf, sizeof(buf));
+    const bool ok = parser.write((const uint8_t*)data, size) == size && parser.end();
+    *log = rec.log;
+    return ok;
+}
+
+// Writes a document with a bit of everything in the given format
+template <typename Writer>
+static void writeDocument(Writer& writer) {
+    writer.beginObject();
+    writer[JSON_KEY("t")] = "scan";
+    writer[JSON_KEY("ssid")] = "Blynk \"Office\" \xd0\xba";
+    writer["rssi"] = -67;
+    writer[String("ch")] = 6u;
+    writer[JSON_KEY("big")] = ULLONG_MAX;
+    writer[JSON_KEY("small")] = LLONG_MIN;
+    writer[JSON_KEY("flag")] = true;
+    writer.name("list").beginArray();
+    writer.value(0.5).value(23.45).value(-1e300).value(1.5e-7).value(DBL_MIN).value(100000.0);
+    writer.beginObject().endObject();
+    writer.beginArray().nullValue().value(false).endArray();
+    writer.endArray();
+    writer[JSON_KEY("long")] = std::string(200, 'x').c_str();
+    writer.endObject();
+}
+
+// Writes a document from a template with a bit of everything in the given format
+template <typename Writer>
+static void fillDocument(Writer& writer) {
+    const double data[] = { 0.5, -2.25, 1e300 };
+    const float fixed[] = { 0.5f, -2.5f };
+    const int ints[] = { 1, -1, 100000 };
+    writer.beginArray();
+    writer.fill(JSON_TEMPLATE(R"json({ "t" : "scan", "ssid":?, "rssi":?,
+            "list": [0, -17, 1.5, -0.125, 18446744073709551615, true, false, null, {}, []],
+            "esc\"\\\/\b\f\n\r\t\u0001\u00e9\u20ac\ud83d\ude00\ud800?": ?, "x": [?, ?] })json"),
+            "Blynk \"Office\"", -67, String("str"), 2.5, false);
+    writer.fill(JSON_TEMPLATE(R"json("static")json"));
+    writer.fill(JSON_TEMPLATE(R"json(?)json"), 42u);
+    writer.values(data, 3).values(fixed, 2, 1).values(ints, 3).values(ints, 0);
+    writer.endArray();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_encode() {
+    // Examples from RFC 8949, Appendix A
+    TEST_ASSERT_EQUAL_STRING("00", encode(0).c_str());
+    TEST_ASSERT_EQUAL_STRING("17", encode(23).c_str());
+    TEST_ASSERT_EQUAL_STRING("1818", encode(24).c_str());
+    TEST_ASSERT_EQUAL_STRING("1864", encode(100).c_str());
+    TEST_ASSERT_EQUAL_STRING("1903e8", encode(1000).c_str());
+    TEST_ASSERT_EQUAL_STRING("1a000f4240", encode(1000000).c_str());
+    TEST_ASSERT_EQUAL_STRING("1b000000e8d4a51000", encode(1000000000000LL).c_str());
+    TEST_ASSERT_EQUAL_STRING("1bffffffffffffffff", encode(ULLONG_MAX).c_str());
+    TEST_ASSERT_EQUAL_STRING("20", encode(-1).c_str());
+    TEST_ASSERT_EQUAL_STRING("29", encode(-10).c_str());
+    TEST_ASSERT_EQUAL_STRING("3863", encode(-100).c_str());
+    TEST_ASSERT_EQUAL_STRING("3903e7", encode(-1000).c_str());
+    TEST_ASSERT_EQUAL_STRING("3b7fffffffffffffff", encode(LLONG_MIN).c_str());
+    TEST_ASSERT_EQUAL_STRING("f90000", encode(0.0).c_str());
+    TEST_ASSERT_EQUAL_STRING("f98000", encode(-0.0).c_str());
+    TEST_ASSERT_EQUAL_STRING("f93c00", encode(1.0).c_str());
+    TEST_ASSERT_EQUAL_STRING("fb3ff199999999999a", encode(1.1).c_str());
+    TEST_ASSERT_EQUAL_STRING("f93e00", encode(1.5).c_str());
+    TEST_ASSERT_EQUAL_STRING("f97bff", encode(65504.0).c_str());
+    TEST_ASSERT_EQUAL_STRING("fa47c35000", encode(100000.0).c_str());
+    TEST_ASSERT_EQUAL_STRING("fa7f7fffff", encode(3.4028234663852886e+38).c_str());
+    TEST_ASSERT_EQUAL_STRING("fb7e37e43c8800759c", encode(1.0e+300).c_str());
+    TEST_ASSERT_EQUAL_STRING("f90400", encode(0.00006103515625).c_str());
+    TEST_ASSERT_EQUAL_STRING("f9c400", encode(-4.0).c_str());
+    TEST_ASSERT_EQUAL_STRING("fbc010666666666666", encode(-4.1).c_str());
+    TEST_ASSERT_EQUAL_STRING("f97c00", encode(INFINITY).c_str());
+    TEST_ASSERT_EQUAL_STRING("f97e00", encode(NAN).c_str());
+    TEST_ASSERT_EQUAL_STRING("f9fc00", encode(-INFINITY).c_str());
+    TEST_ASSERT_EQUAL_STRING("f4", encode(false).c_str());
+    TEST_ASSERT_EQUAL_STRING("f5", encode(true).c_str());
+    TEST_ASSERT_EQUAL_STRING("60", encode("").c_str());
+    TEST_ASSERT_EQUAL_STRING("6161", encode("a").c_str());
+    TEST_ASSERT_EQUAL_STRING("6449455446", encode("IETF").c_str());
+    TEST_ASSERT_EQUAL_STRING("62225c", encode("\"\\").c_str());
+    TEST_ASSERT_EQUAL_STRING("62c3bc", encode("\xc3\xbc").c_str());
+
+    char buf[64];
+    CborBufferWriter writer(buf, sizeof(buf));
+    writer.beginObject();
+    writer["a"] = 1;
+    writer.name("b").beginArray().value(2).value(3).endArray();
+    writer.endObject();
+    writer.beginArray().endArray();
+    writer.nullValue();
+    TEST_ASSERT_EQUAL_STRING("bf61610161629f0203ffff9ffff6", toHex(buf, writer.dataSize()).c_str());
+
+    // Keys escaped at compile time are written unescaped
+    CborBufferWriter keys(buf, sizeof(buf));
+    keys[JSON_KEY("ssid")] = 1;
+    keys[JSON_KEY("q\"b\\s")] = 1;
+    keys[JSON_KEY("\b\t\n\f\r\x01\x1f\x7f.")] = 1;
+    TEST_ASSERT_EQUAL_STRING("647373696401657122625c73016908090a0c0d011f7f2e01",
+            toHex(buf, keys.dataSize()).c_str());
+}
+
+void test_decode() {
+    std::string log;
+    TEST_ASSERT_TRUE(decode(fromHex("bf61610161629f0203ffff"), &log));
+    TEST_ASSERT_EQUAL_STRING("{name:a;n:1;name:b;[n:2;n:3;]}", log.c_str());
+    TEST_ASSERT_TRUE(decode(fromHex("a26161016162820203"), &log)); // Definite lengths
+    TEST_ASSERT_EQUAL_STRING("{name:a;n:1;name:b;[n:2;n:3;]}", log.c_str());
+    TEST_ASSERT_TRUE(decode(fromHex("83a0f6f7"), &log));
+    TEST_ASSERT_EQUAL_STRING("[{}null;null;]", log.c_str());
+    TEST_ASSERT_TRUE(decode(fromHex("c11a514b67b0"), &log)); // Tags are skipped
+    TEST_ASSERT_EQUAL_STRING("n:1363896240;", log.c_str());
+    TEST_ASSERT_TRUE(decode(fromHex("3bffffffffffffffff"), &log));
+    TEST_ASSERT_EQUAL_STRING("n:-18446744073709551616;", log.c_str());
+    TEST_ASSERT_TRUE(decode(fromHex("84f90001f97c00fa7fc00000fb3ff199999999999a"), &log));
+    TEST_ASSERT_EQUAL_STRING("[n:5.960464477539063e-8;null;null;n:1.1;]", log.c_str());
+
+    // Long strings are passed in parts
+    Recorder rec;
+    char buf[8];
+    CborReader reader(rec, buf, sizeof(buf));
+    const std::string str = "\x70" "0123456789abcdef";
+    TEST_ASSERT_TRUE(reader.parse(str.data(), str.size()));
+    TEST_ASSERT_EQUAL_STRING("s:0123456789abcdef;", rec.log.c_str());
+    TEST_ASSERT_EQUAL(2, rec.parts);
+    // Names must fit into the buffer
+    TEST_ASSERT_FALSE(decode(fromHex("a1686e616d656e616d6501"), &log, 8));
+    TEST_ASSERT_TRUE(decode(fromHex("a1676e616d656e616d01"), &log, 8));
+
+    const char* invalid[] = {
+        "",
+        "18",                   // Truncated argument
+        "1c",                   // Reserved additional information
+        "6261",                 // Truncated string
+        "4161",                 // Byte string
+        "7f6161ff",             // Indefinite-length text string
+        "a10101",               // Key is not a text string
+        "bf6161ff",             // Key without a value
+        "9f01",                 // Missing break
+        "ff",                   // Unexpected break
+        "8201ff",               // Break in a definite-length array
+        "f820",                 // Unassigned simple value
+        "0101",                 // Data after the document
+        "9b00000001000000000000", // Too many elements
+    };
+    for (const char* hex: invalid) {
+        TEST_ASSERT_FALSE_MESSAGE(decode(fromHex(hex), &log), hex);
+    }
+    // Nesting is limited
+    const std::string deep = std::string(CborReader::MAX_DEPTH, '\x81') + '\x01';
+    TEST_ASSERT_TRUE(decode(deep, &log));
+    TEST_ASSERT_FALSE(decode('\x81' + deep, &log));
+}
+
+void test_round_trip() {
+    // A document written in CBOR is read back the same way as the same document in JSON
+    char json[1024], cbor[1024], buf[64];
+    JsonBufferWriter jsonWriter(json, sizeof(json));
+    writeDocument(jsonWriter);
+    CborBufferWriter cborWriter(cbor, sizeof(cbor));
+    writeDocument(cborWriter);
+    TEST_ASSERT_TRUE(cborWriter.dataSize() < jsonWriter.dataSize());
+
+    Recorder fromJson;
+    JSONStreamParser parser(fromJson, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(jsonWriter.dataSize(), parser.write((const uint8_t*)json, jsonWriter.dataSize()));
+    TEST_ASSERT_TRUE(parser.end());
+
+    Recorder fromCbor;
+    CborReader reader(fromCbor, buf, sizeof(buf));
+    TEST_ASSERT_TRUE(reader.parse(cbor, cborWriter.dataSize()));
+    TEST_ASSERT_EQUAL_STRING(fromJson.log.c_str(), fromCbor.log.c_str());
+}
+
+void test_fill() {
+    // Templates and arrays of numbers are written as the equivalent CBOR
+    char json[1024], cbor[1024];
+    JsonBufferWriter jsonWriter(json, sizeof(json));
+    fillDocument(jsonWriter);
+    CborBufferWriter cborWriter(cbor, sizeof(cbor));
+    fillDocument(cborWriter);
+
+    std::string fromJson, fromCbor;
+    TEST_ASSERT_TRUE(decodeJson(json, jsonWriter.dataSize(), &fromJson));
+    TEST_ASSERT_TRUE(decode(std::string(cbor, cborWriter.dataSize()), &fromCbor));
+    TEST_ASSERT_EQUAL_STRING(fromJson.c_str(), fromCbor.c_str());
+    TEST_ASSERT_TRUE(fromCbor.find("name:esc\"\\/\b\f\n\r\t\x01\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80\xef\xbf\xbd?;") !=
+            std::string::npos);
+
+    char buf[64];
+    CborBufferWriter writer(buf, sizeof(buf));
+    writer.fill(JSON_TEMPLATE(R"({"a":?,"b":[2,?]})"), 1, 3);
+    TEST_ASSERT_EQUAL_STRING("bf61610161629f0203ffff", toHex(buf, writer.dataSize()).c_str());
+}
+
+// Messages shaped like the Blynk.Inject info and scan responses
+template <typename Writer>
+static void writeMessages(Writer& writer) {
+    writer.beginObject();
+    writer[JSON_KEY("t")       ] = "info";
+    writer[JSON_KEY("vendor")  ] = "Blynk";
+    writer[JSON_KEY("tmpl_id") ] = "TMPL0123456";
+    writer[JSON_KEY("fw_type") ] = "TMPL0123456";
+    writer[JSON_KEY("fw_ver")  ] = "0.1.0";
+    writer[JSON_KEY("name")    ] = "Blynk Device";
+    writer[JSON_KEY("last_error")] = 0;
+    writer.endObject();
+    for (int i = 0; i < 4; ++i) {
+        writer.beginObject();
+        writer[JSON_KEY("t")     ] = "scan";
+        writer[JSON_KEY("ssid")  ] = "Blynk Office";
+        writer[JSON_KEY("bssid") ] = "AA:BB:CC:DD:EE:FF";
+        writer[JSON_KEY("rssi")  ] = -67 - i;
+        writer[JSON_KEY("sec")   ] = "WPA2";
+        writer[JSON_KEY("ch")    ] = 6 + i;
+        writer.endObject();
+    }
+}
+
+void bench_cbor() {
+    printf("\n");
+    char buf[1024];
+    size_t jsonSize = 0, cborSize = 0;
+    const double json = benchNs(ITERATIONS, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writeMessages(writer);
+        jsonSize = writer.dataSize();
+        benchKeep(writer.dataSize());
+    });
+    const double cbor = benchNs(ITERATIONS, [&]() {
+        CborBufferWriter writer(buf, sizeof(buf));
+        writeMessages(writer);
+        cborSize = writer.dataSize();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("info + 4 scans, JSON -> CBOR", json, cbor);
+    printf("info + 4 scans, size          %6uB -> %6uB\n", (unsigned)jsonSize, (unsigned)cborSize);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_encode);
+    RUN_TEST(test_decode);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_fill);
+    RUN_TEST(bench_cbor);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
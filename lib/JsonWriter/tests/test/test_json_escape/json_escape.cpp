@@ -0,0 +1,256 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "JsonWriter.h"
+
+#ifdef JSON_WRITER_USE_UTF8_DECODER
+#include "Utf8Decoder.h"
+#endif
+
+#include <random>
+#include <string>
+
+static const unsigned ITERATIONS = 100000;
+
+// Escapes strings the way JsonWriter used to, a character at a time
+class LegacyWriter: public JsonBufferWriter {
+public:
+    using JsonBufferWriter::JsonBufferWriter;
+
+#ifdef JSON_WRITER_USE_UTF8_DECODER
+
+    void legacyValue(const char *str, size_t size) {
+        Utf8Decoder decoder(str, size);
+        const char* const HEXFMT = "\\u%04X";
+        write("\"", 1);
+        for (;;) {
+            const int c = decoder.next();
+            if (c < 0) {
+                break;
+            } else if (c == '"' || c == '\\' || c <= 0x1F) {
+                write("\\", 1);
+                switch (c) {
+                case '"':
+                case '\\':  write((const char*)&c, 1); break;
+                case 0x08:  write("b", 1);             break;
+                case 0x09:  write("t", 1);             break;
+                case 0x0A:  write("n", 1);             break;
+                case 0x0C:  write("f", 1);             break;
+                case 0x0D:  write("r", 1);             break;
+                default:    printf(HEXFMT+1, c);       break;
+                }
+            } else if (c < 0x7F) {
+                const char ch = (char)c;
+                write(&ch, 1);
+            } else if (c <= 0x9F || c == 0x2028 || c == 0x2029) {
+                printf(HEXFMT, c);
+            } else if (asciiOnly) {
+                if (c < 0x10000) {
+                    printf(HEXFMT, c);
+                } else {
+                    const int cp = c - 0x10000;
+                    printf(HEXFMT, 0xD800 | (cp >> 10));
+                    printf(HEXFMT, 0xDC00 | (cp & 0x3FF));
+                }
+            } else {
+                write(str + decoder.at_byte(), decoder.symbol_size());
+            }
+        }
+        write("\"", 1);
+    }
+
+#else
+
+    void legacyValue(const char *str, size_t size) {
+        write("\"", 1);
+        const char* const end = str + size;
+        const char *s = str;
+        while (s != end) {
+            const unsigned char c = *s;
+            if (c == '"' || c == '\\' || c <= 0x1F) {
+                write(str, s - str);
+                write("\\", 1);
+                switch (c) {
+                case '"':
+                case '\\':  write(s, 1);   break;
+                case 0x08:  write("b", 1); break;
+                case 0x09:  write("t", 1); break;
+                case 0x0A:  write("n", 1); break;
+                case 0x0C:  write("f", 1); break;
+                case 0x0D:  write("r", 1); break;
+                default:    printf("u%04X", (unsigned)c); break;
+                }
+                str = s + 1;
+            }
+            ++s;
+        }
+        if (s != str) {
+            write(str, s - str);
+        }
+        write("\"", 1);
+    }
+
+#endif
+
+    bool asciiOnly = false;
+};
+
+// Counts calls to write()
+class CountingWriter: public JsonWriter {
+public:
+    size_t writes = 0;
+    std::string data;
+
+protected:
+    virtual void write(const char *data, size_t size) override {
+        ++writes;
+        this->data.append(data, size);
+    }
+};
+
+static std::string escape(const std::string& str, bool asciiOnly = false) {
+    std::string buf(str.size() * 12 + 2, '\0');
+    JsonBufferWriter writer(&buf[0], buf.size());
+    writer.setAsciiOnly(asciiOnly);
+    writer.value(str.data(), str.size());
+    buf.resize(writer.dataSize());
+    return buf;
+}
+
+static std::string legacyEscape(const std::string& str, bool asciiOnly = false) {
+    std::string buf(str.size() * 12 + 2, '\0');
+    LegacyWriter writer(&buf[0], buf.size());
+    writer.asciiOnly = asciiOnly;
+    writer.legacyValue(str.data(), str.size());
+    buf.resize(writer.dataSize());
+    return buf;
+}
+
+// Random string built from ASCII text, special characters and UTF-8 sequences, some of them invalid
+static std::string randomString(std::mt19937& rnd) {
+    static const char* const PIECES[] = {
+        "a", "bc", "Blynk HaLow ", "\"", "\\", "\n", "\t", "\x01", "\x1f", "\x7f", " ", "/",
+        "\xc3\xa9", "\xd0\xbc", "\xe2\x82\xac", "\xf0\x9f\x98\x81", "\xc2\x85", "\xe2\x80\xa8",
+        "\xc3", "\xff", "\xed\xa0\x80", "" /* Null character */
+    };
+    std::string s;
+    const unsigned n = rnd() % 40;
+    for (unsigned i = 0; i < n; ++i) {
+        const unsigned k = rnd() % (sizeof(PIECES) / sizeof(PIECES[0]));
+        if (k == sizeof(PIECES) / sizeof(PIECES[0]) - 1) {
+            s += '\0';
+        } else {
+            s += PIECES[k];
+        }
+    }
+    return s;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_escape() {
+    TEST_ASSERT_EQUAL_STRING("\"a\\\"b\\\\c\\n\\t\\u0001\\u001F/\"", escape("a\"b\\c\n\t\x01\x1f/").c_str());
+    TEST_ASSERT_EQUAL(8, escape(std::string("\0", 1)).size());
+    TEST_ASSERT_EQUAL_STRING("\"\xd0\xbc\xd0\xbe\xd1\x80\xd0\xb4\xd0\xb0 \xf0\x9f\x98\x81\"",
+            escape("\xd0\xbc\xd0\xbe\xd1\x80\xd0\xb4\xd0\xb0 \xf0\x9f\x98\x81").c_str());
+#ifdef JSON_WRITER_USE_UTF8_DECODER
+    TEST_ASSERT_EQUAL_STRING("\"\\u007F\\u0085\\u2028\"", escape("\x7f\xc2\x85\xe2\x80\xa8").c_str());
+    TEST_ASSERT_EQUAL_STRING("\"\\u043C \\uD83D\\uDE01\"", escape("\xd0\xbc \xf0\x9f\x98\x81", true).c_str());
+    TEST_ASSERT_EQUAL_STRING("\"ab\"", escape("ab\xc3" "cd").c_str()); // Invalid UTF-8 ends the string
+#else
+    TEST_ASSERT_EQUAL_STRING("\"\x7f\xc3\"", escape("\x7f\xc3").c_str());
+#endif
+
+    // Same output as before, with special characters at every offset
+    for (size_t len = 0; len < 40; ++len) {
+        for (size_t pos = 0; pos < len; ++pos) {
+            for (const char* special: { "\"", "\\", "\x1f", "\x7f", "\xc3\xa9", "\xc2\x9f", "\xc3" }) {
+                std::string s(len, 'x');
+                s.replace(pos, 1, special);
+                TEST_ASSERT_TRUE(escape(s) == legacyEscape(s));
+            }
+        }
+    }
+    std::mt19937 rnd(1);
+    for (unsigned i = 0; i < 100000; ++i) {
+        const std::string s = randomString(rnd);
+        TEST_ASSERT_TRUE(escape(s) == legacyEscape(s));
+        TEST_ASSERT_TRUE(escape(s, true) == legacyEscape(s, true));
+    }
+}
+
+void test_bulk_writes() {
+    // Clean runs are written at once
+    const struct {
+        const char* str;
+        size_t writes;
+    } cases[] = {
+        { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa", 3 },
+        { "\xd0\xbc\xd0\xbe\xd1\x80\xd0\xb4\xd0\xb0 \xf0\x9f\x98\x81 \xc3\xa9", 3 },
+        { "line 1\nline 2", 5 },
+        { "\"quoted\"", 5 }
+    };
+    for (const auto& c: cases) {
+        CountingWriter writer;
+        writer.value(c.str);
+        TEST_ASSERT_EQUAL(c.writes, writer.writes);
+    }
+}
+
+void bench_escape() {
+    printf("\n");
+    const std::string ssid = "Blynk Office 5th floor, east wing AP";
+    const std::string text = "{\"key\":\"value\"}\nTemperature: 23.5 \xc2\xb0" "C, humidity 45%";
+    const std::string utf8 = "\xd0\x9c\xd0\xbe\xd1\x8f \xd0\xbc\xd0\xb5\xd1\x80\xd0\xb5\xd0\xb6\xd0\xb0 Wi-Fi";
+    const std::string cert = std::string(1000, 'M');
+    std::string str;
+    for (int i = 0; i < 16; ++i) {
+        str += utf8 + " ";
+    }
+    const std::string longUtf8 = str;
+    for (const std::string* s: { &ssid, &text, &utf8, &longUtf8, &cert }) {
+        std::string buf(s->size() * 12 + 2, '\0');
+        const double before = benchNs(ITERATIONS, [&]() {
+            LegacyWriter writer(&buf[0], buf.size());
+            writer.legacyValue(s->data(), s->size());
+            benchKeep(writer.dataSize());
+        });
+        const double after = benchNs(ITERATIONS, [&]() {
+            JsonBufferWriter writer(&buf[0], buf.size());
+            writer.value(s->data(), s->size());
+            benchKeep(writer.dataSize());
+        });
+        char name[32];
+        snprintf(name, sizeof(name), "%uB %s", (unsigned)s->size(), (s == &ssid) ? "ssid" :
+                (s == &text) ? "escapes" : (s == &utf8 || s == &longUtf8) ? "utf-8" : "clean");
+        benchReport(name, before, after);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_escape);
+    RUN_TEST(test_bulk_writes);
+    RUN_TEST(bench_escape);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,805 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "JsonWriter.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+static const unsigned ITERATIONS = 1000000;
+
+// Formats numbers the way JsonWriter used to
+class PrintfWriter: public JsonBufferWriter {
+public:
+    using JsonBufferWriter::JsonBufferWriter;
+
+    void formatInt(long long val) {
+        printf("%lld", val);
+    }
+
+    void formatDouble(double val) {
+        printf("%g", val);
+    }
+
+    void formatDouble(double val, int precision) {
+        printf("%.*lf", precision, val);
+    }
+};
+
+template <typename T>
+static std::string format(T val) {
+    char buf[32];
+    JsonBufferWriter writer(buf, sizeof(buf));
+    writer.value(val);
+    return std::string(buf, writer.dataSize());
+}
+
+static std::string format(double val, int precision) {
+    char buf[400];
+    JsonBufferWriter writer(buf, sizeof(buf));
+    writer.value(val, precision);
+    return std::string(buf, writer.dataSize());
+}
+
+// Number of significant digits in the shortest "%.*g" representation that reads back as val
+static int shortestDigits(double val) {
+    char buf[32];
+    for (int p = 1; p < 17; ++p) {
+        snprintf(buf, sizeof(buf), "%.*g", p, val);
+        if (strtod(buf, nullptr) == val) {
+            return p;
+        }
+    }
+    return 17;
+}
+
+// Number of significant digits in a formatted number
+static int significantDigits(const std::string& s) {
+    std::string digits;
+    for (char c: s) {
+        if (c == 'e') {
+            break;
+        }
+        if (isdigit((unsigned char)c)) {
+            digits += c;
+        }
+    }
+    const size_t first = digits.find_first_not_of('0');
+    const size_t last = digits.find_last_not_of('0');
+    return (first == std::string::npos) ? 0 : last - first + 1;
+}
+
+template <typename T>
+static void checkInt(T val, const char* fmt) {
+    char expected[32];
+    snprintf(expected, sizeof(expected), fmt, val);
+    const std::string s = format(val);
+    TEST_ASSERT_EQUAL_STRING(expected, s.c_str());
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_integers() {
+    // All lengths and the boundaries between them
+    unsigned long long p = 1;
+    for (int i = 0; i < 20; ++i) {
+        for (unsigned long long val: { p - 1, p, p + 1, p * 9 + (p - 1) }) {
+            checkInt(val, "%llu");
+            checkInt((long long)val, "%lld");
+            checkInt(-(long long)val, "%lld");
+            checkInt((unsigned)val, "%u");
+            checkInt((int)val, "%d");
+            checkInt((unsigned long)val, "%lu");
+            checkInt((long)val, "%ld");
+        }
+        p *= 10;
+    }
+    checkInt(INT_MIN, "%d");
+    checkInt(INT_MAX, "%d");
+    checkInt(UINT_MAX, "%u");
+    checkInt(LONG_MIN, "%ld");
+    checkInt(ULONG_MAX, "%lu");
+    checkInt(LLONG_MIN, "%lld");
+    checkInt(LLONG_MAX, "%lld");
+    checkInt(ULLONG_MAX, "%llu");
+    checkInt(0x100000000ull, "%llu");
+    for (unsigned i = 0; i < 100000; ++i) {
+        const unsigned long long val = ((unsigned long long)rand() << 40) ^ ((unsigned long long)rand() << 20) ^ rand();
+        checkInt(val >> (i % 64), "%llu");
+        checkInt((long long)val >> (i % 64), "%lld");
+        checkInt((int)val, "%d");
+    }
+
+    // Separators are written as usual
+    char buf[64];
+    JsonBufferWriter writer(buf, sizeof(buf));
+    writer.beginObject();
+    writer["a"] = -1;
+    writer["b"] = 12345678901234ll;
+    writer.name("c").beginArray().value(0u).value(-9l).value(10ull).endArray();
+    writer.endObject();
+    TEST_ASSERT_EQUAL_STRING("{\"a\":-1,\"b\":12345678901234,\"c\":[0,-9,10]}", writer.c_str());
+}
+
+void test_shortest_doubles() {
+    const struct {
+        double val;
+        const char* str;
+    } cases[] = {
+        { 0.0, "0" }, { -0.0, "-0" }, { 1.0, "1" }, { -2.5, "-2.5" }, { 0.1, "0.1" }, { 0.3, "0.3" },
+        { 1.0 / 3, "0.3333333333333333" }, { 123456.789, "123456.789" }, { 23.45f, "23.450000762939453" },
+        { 1e-6, "0.000001" }, { 1.5e-7, "1.5e-7" }, { 1e20, "100000000000000000000" }, { 1e21, "1e+21" },
+        { 1.25e100, "1.25e+100" }, { 5e-324, "5e-324" }, { DBL_MAX, "1.7976931348623157e+308" },
+        { DBL_MIN, "2.2250738585072014e-308" }, { 9007199254740993.0, "9007199254740992" },
+        // Not permitted by the spec
+        { NAN, "0" }, { INFINITY, "1.7976931348623157e+308" }, { -INFINITY, "-1.7976931348623157e+308" }
+    };
+    for (const auto& c: cases) {
+        TEST_ASSERT_EQUAL_STRING(c.str, format(c.val).c_str());
+    }
+
+    // Random values of all magnitudes read back the same and are almost always the shortest
+    std::mt19937_64 rnd(1);
+    unsigned longer = 0;
+    const unsigned n = 200000;
+    for (unsigned i = 0; i < n; ++i) {
+        uint64_t bits = rnd();
+        double val;
+        memcpy(&val, &bits, sizeof(val));
+        if (!std::isfinite(val)) {
+            continue;
+        }
+        const std::string s = format(val);
+        TEST_ASSERT_TRUE(s.size() <= 25);
+        TEST_ASSERT_TRUE(strtod(s.c_str(), nullptr) == val);
+        const int digits = significantDigits(s);
+        TEST_ASSERT_TRUE(digits >= shortestDigits(val));
+        if (digits > shortestDigits(val)) {
+            ++longer;
+        }
+    }
+    // Typical sensor readings
+    for (unsigned i = 0; i < n; ++i) {
+        const double val = (int)(rnd() % 2000000 - 1000000) / 100.0;
+        const std::string s = format(val);
+        TEST_ASSERT_TRUE(strtod(s.c_str(), nullptr) == val);
+        TEST_ASSERT_EQUAL(shortestDigits(val), significantDigits(s));
+    }
+    TEST_ASSERT_TRUE(longer < n / 100);
+}
+
+void test_fixed_doubles() {
+    TEST_ASSERT_EQUAL_STRING("3.14", format(3.14159, 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("-0.00", format(-0.001, 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("0.12", format(0.125, 2).c_str()); // Ties are rounded to even
+    TEST_ASSERT_EQUAL_STRING("1.00", format(0.999, 2).c_str());
+    TEST_ASSERT_EQUAL_STRING("2", format(2.5, 0).c_str());
+    TEST_ASSERT_EQUAL_STRING("0.000", format(NAN, 3).c_str());
+
+    // Same as printf(), including values and precisions handled by the fallback
+    std::mt19937_64 rnd(2);
+    for (unsigned i = 0; i < 200000; ++i) {
+        double val;
+        switch (i % 4) {
+        case 0: {
+            uint64_t bits = rnd();
+            memcpy(&val, &bits, sizeof(val));
+            if (!std::isfinite(val) || std::fabs(val) > 1e30) {
+                continue;
+            }
+            break;
+        }
+        case 1:
+            val = std::ldexp((double)(rnd() >> 11), (int)(rnd() % 140) - 120);
+            break;
+        case 2:
+            val = (int)(rnd() % 2000000 - 1000000) / 1000.0;
+            break;
+        default:
+            val = (int)(rnd() % 2000 - 1000) / 8.0; // Exact ties
+            break;
+        }
+        const int precision = rnd() % 20;
+        char expected[400];
+        snprintf(expected, sizeof(expected), "%.*f", precision, val);
+        TEST_ASSERT_EQUAL_STRING(expected, format(val, precision).c_str());
+    }
+}
+
+void test_keys() {
+    static_assert(jsonKeySize("ssid") == sizeof(",\"ssid\":") - 1, "Wrong key size");
+    const char* names[] = { "", "t", "last_error", "q\"b\\s", "\b\t\n\f\r", "\x01\x1f\x7f" };
+    // Keys with compile-time escaping produce the same output as run-time names
+    char expected[128], actual[128];
+    JsonBufferWriter a(expected, sizeof(expected)), b(actual, sizeof(actual));
+    a.beginObject();
+    b.beginObject();
+    for (const char* name: names) {
+        a[name] = 1;
+    }
+    b[JSON_KEY("")] = 1;
+    b[JSON_KEY("t")] = 1;
+    b[JSON_KEY("last_error")] = 1;
+    b[JSON_KEY("q\"b\\s")] = 1;
+    b[JSON_KEY("\b\t\n\f\r")] = 1;
+    b[JSON_KEY("\x01\x1f\x7f")] = 1;
+    a.endObject();
+    b.endObject();
+    TEST_ASSERT_EQUAL(a.dataSize(), b.dataSize());
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, a.dataSize());
+
+    // Non-ASCII characters are not escaped
+    JsonBufferWriter u(actual, sizeof(actual));
+    u[JSON_KEY("\xd0\xba\xe2\x80\xa8")] = 1;
+    TEST_ASSERT_EQUAL(9, u.dataSize());
+    TEST_ASSERT_EQUAL_MEMORY("\"\xd0\xba\xe2\x80\xa8\":1", actual, u.dataSize());
+
+    // Separators around nested values and a mix of key types
+    JsonBufferWriter w(actual, sizeof(actual));
+    w.beginArray();
+    w.beginObject();
+    w.name(JSON_KEY("a")).beginObject();
+    w["b"] = 1;
+    w.name(JSON_KEY("c")).beginArray().value(2).value(3).endArray();
+    w.endObject();
+    w.name(JSON_KEY("d")).value("x");
+    w.endObject();
+    w.beginObject();
+    w[JSON_KEY("e")] = true;
+    w.endObject();
+    w.endArray();
+    const char json[] = R"json([{"a":{"b":1,"c":[2,3]},"d":"x"},{"e":true}])json";
+    TEST_ASSERT_EQUAL(sizeof(json) - 1, w.dataSize());
+    TEST_ASSERT_EQUAL_MEMORY(json, actual, w.dataSize());
+}
+
+// Writes a scan result with many networks, well over the size of a BLE message
+template <typename Writer>
+static void writeScan(Writer& writer, int count) {
+    writer.beginArray();
+    for (int i = 0; i < count; ++i) {
+        writer.beginObject();
+        writer[JSON_KEY("ssid")] = "Network \"" + String(i) + "\"";
+        writer[JSON_KEY("bssid")] = "AA:BB:CC:DD:EE:FF";
+        writer[JSON_KEY("rssi")] = -40 - i;
+        writer.name(JSON_KEY("ch")).value(11.5, i % 3);
+        writer.endObject();
+    }
+    writer.endArray();
+}
+
+static void appendChunk(const char* data, size_t size, void* arg) {
+    ((std::vector<std::string>*)arg)->emplace_back(data, size);
+}
+
+void test_chunks() {
+    static char expected[16384];
+    JsonBufferWriter whole(expected, sizeof(expected));
+    writeScan(whole, 100);
+    TEST_ASSERT_TRUE(whole.dataSize() < sizeof(expected));
+
+    for (size_t chunkSize: { 1, 2, 7, 20, 64, 244, 512, 8192 }) {
+        std::vector<char> buf(chunkSize);
+        std::vector<std::string> chunks;
+        JsonChunkWriter writer(buf.data(), buf.size(), appendChunk, &chunks);
+        writeScan(writer, 100);
+        TEST_ASSERT_EQUAL(whole.dataSize() / chunkSize, chunks.size());
+        writer.flush();
+        writer.flush(); // Nothing left to flush
+        TEST_ASSERT_EQUAL((whole.dataSize() + chunkSize - 1) / chunkSize, chunks.size());
+        TEST_ASSERT_EQUAL(whole.dataSize(), writer.dataSize());
+
+        std::string data;
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            // Every chunk is full except for the last one
+            if (i + 1 < chunks.size()) {
+                TEST_ASSERT_EQUAL(chunkSize, chunks[i].size());
+            }
+            data += chunks[i];
+        }
+        TEST_ASSERT_EQUAL(whole.dataSize(), data.size());
+        TEST_ASSERT_EQUAL_MEMORY(expected, data.data(), data.size());
+    }
+
+    // A zero chunk size passes no data
+    std::vector<std::string> chunks;
+    JsonChunkWriter writer(nullptr, 0, appendChunk, &chunks);
+    writeScan(writer, 100);
+    writer.flush();
+    TEST_ASSERT_EQUAL(0, chunks.size());
+    TEST_ASSERT_EQUAL(whole.dataSize(), writer.dataSize());
+}
+
+void test_size() {
+    char buf[16384];
+    for (int count: { 0, 1, 10, 100 }) {
+        JsonSizeWriter size;
+        writeScan(size, count);
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writeScan(writer, count);
+        TEST_ASSERT_EQUAL(writer.dataSize(), size.dataSize());
+    }
+    // Escapes, number widths and values formatted with printf
+    const char str[] = "q\"b\\s\x01\xd0\xba\xe2\x80\xa8\xff";
+    JsonSizeWriter size;
+    JsonBufferWriter writer(buf, sizeof(buf));
+    for (JsonWriter* w: { (JsonWriter*)&size, (JsonWriter*)&writer }) {
+        w->beginArray();
+        w->value(str, sizeof(str) - 1);
+        w->value(LLONG_MIN).value(ULLONG_MAX).value(-0.0).value(DBL_MIN).value(1e300, 2);
+        w->endArray();
+    }
+    TEST_ASSERT_EQUAL(writer.dataSize(), size.dataSize());
+}
+
+void test_inline_writer() {
+    // Same output as JsonBufferWriter, including truncation
+    static char expected[16384], actual[16384];
+    for (size_t size: { 0, 1, 10, 100, 1000, 16384 }) {
+        JsonBufferWriter a(expected, size);
+        InlineJsonBufferWriter b(actual, size);
+        writeScan(a, 100);
+        writeScan(b, 100);
+        TEST_ASSERT_EQUAL(a.dataSize(), b.dataSize());
+        TEST_ASSERT_EQUAL(size, b.bufferSize());
+        TEST_ASSERT_EQUAL_MEMORY(expected, actual, std::min(size, a.dataSize()));
+    }
+    const char str[] = "q\"b\\s\x01\xd0\xba\xe2\x80\xa8\xff";
+    JsonBufferWriter a(expected, sizeof(expected));
+    InlineJsonBufferWriter b(actual, sizeof(actual));
+    a.beginArray().value(str, sizeof(str) - 1).value(1e300, 2).nullValue().value(true).endArray();
+    b.beginArray().value(str, sizeof(str) - 1).value(1e300, 2).nullValue().value(true).endArray();
+    TEST_ASSERT_EQUAL_STRING(a.c_str(), b.c_str());
+}
+
+void test_templates() {
+    static_assert(jsonTemplateFields(R"({"a":?,"b?":"\"?",?:[?,?]})") == 4, "Wrong field count");
+    static_assert(jsonTemplateSize(R"({"a":?})") == 6, "Wrong template size");
+    // Templates produce the same output as the writer's methods
+    const char str[] = "q\"b\\s\x01\xd0\xba\xe2\x80\xa8\xff";
+    char expected[256], actual[256];
+    JsonBufferWriter a(expected, sizeof(expected));
+    a.beginObject();
+    a[JSON_KEY("t")] = "scan";
+    a[JSON_KEY("ssid")] = str;
+    a[JSON_KEY("rssi")] = -67;
+    a[JSON_KEY("ch")] = 11.5;
+    a[JSON_KEY("ok")] = true;
+    a[JSON_KEY("mac")] = String("AA:BB");
+    a.endObject();
+    JsonBufferWriter b(actual, sizeof(actual));
+    b.fill(JSON_TEMPLATE(R"({"t":"scan","ssid":?,"rssi":?,"ch":?,"ok":?,"mac":?})"), str, -67, 11.5, true, String("AA:BB"));
+    TEST_ASSERT_EQUAL_STRING(a.c_str(), b.c_str());
+
+    // Question marks and escaped quotes in strings are not placeholders
+    InlineJsonBufferWriter c(actual, sizeof(actual));
+    c.fill(JSON_TEMPLATE(R"({"a?":"\"?\\",?:?})"), "k?", 1);
+    TEST_ASSERT_EQUAL_STRING(R"({"a?":"\"?\\","k?":1})", c.c_str());
+
+    // Templates as values of a larger document, and without placeholders
+    JsonBufferWriter d(actual, sizeof(actual));
+    d.beginArray();
+    d.value(1);
+    d.fill(JSON_TEMPLATE("[?,?]"), 2, "3");
+    d.fill(JSON_TEMPLATE("{}"));
+    d.beginObject();
+    d.name(JSON_KEY("a")).fill(JSON_TEMPLATE(R"({"b":?,"n":null})"), false);
+    d["c"] = 4;
+    d.endObject();
+    d.endArray();
+    TEST_ASSERT_EQUAL_STRING(R"([1,[2,"3"],{},{"a":{"b":false,"n":null},"c":4}])", d.c_str());
+}
+
+// Writes the numbers with values() and one by one, and compares the output
+template <typename T, typename... Precision>
+static void checkValues(const std::vector<T>& data, Precision... precision) {
+    static char expected[32768], actual[32768];
+    JsonBufferWriter a(expected, sizeof(expected));
+    InlineJsonBufferWriter b(actual, sizeof(actual));
+    a.beginObject().name("v").beginArray().value(0);
+    b.beginObject().name("v").beginArray().value(0);
+    for (T val: data) {
+        a.value(val, precision...);
+    }
+    b.values(data.data(), data.size(), precision...);
+    a.endArray().endObject();
+    b.endArray().endObject();
+    TEST_ASSERT_EQUAL(a.dataSize(), b.dataSize());
+    TEST_ASSERT_EQUAL_STRING(a.c_str(), b.c_str());
+}
+
+void test_values() {
+    std::mt19937 rnd(42);
+    std::vector<int> ints(1000);
+    for (int& val: ints) {
+        val = (int)rnd();
+    }
+    ints[0] = INT_MIN;
+    ints[1] = INT_MAX;
+    checkValues(ints);
+    checkValues(std::vector<int>());
+    checkValues(std::vector<long long>{ LLONG_MIN, LLONG_MAX, 0, -1 });
+    checkValues(std::vector<unsigned long long>{ ULLONG_MAX, 0, 4294967296ull });
+    checkValues(std::vector<uint8_t>{ 0, 127, 255 });
+    checkValues(std::vector<int16_t>{ INT16_MIN, -1, INT16_MAX });
+    checkValues(std::vector<unsigned long>{ ULONG_MAX, 1 });
+
+    std::vector<double> doubles(1000);
+    for (double& val: doubles) {
+        val = std::ldexp((double)rnd() - 2147483648.0, (int)(rnd() % 80) - 40);
+    }
+    doubles[0] = -DBL_MAX;
+    doubles[1] = DBL_MIN;
+    doubles[2] = NAN;
+    doubles[3] = -INFINITY;
+    doubles[4] = -0.0;
+    checkValues(doubles);
+    checkValues(doubles, 0);
+    checkValues(doubles, 3);
+    checkValues(doubles, MAX_FIXED_DOUBLE_PRECISION + 1); // Formatted with printf
+    checkValues(std::vector<float>{ 0.1f, -1.5f, FLT_MAX, 3.3f });
+    checkValues(std::vector<float>{ 0.1f, -1.5f, FLT_MAX, 3.3f }, 2);
+
+    // Same size as the output
+    JsonSizeWriter size;
+    char buf[256];
+    JsonBufferWriter writer(buf, sizeof(buf));
+    for (JsonWriter* w: { (JsonWriter*)&size, (JsonWriter*)&writer }) {
+        w->beginArray().values(ints.data(), 10).values(doubles.data(), 5, 2).endArray();
+    }
+    TEST_ASSERT_EQUAL(writer.dataSize(), size.dataSize());
+}
+
+void bench_integers() {
+    printf("\n");
+    // Typical values of a scan result
+    const int values[] = { -67, 11, 3, 2412, 0, -89, 165, 1 };
+    char buf[256];
+    const double before = benchNs(ITERATIONS, [&]() {
+        PrintfWriter writer(buf, sizeof(buf));
+        for (int val: values) {
+            writer.formatInt(val);
+        }
+        benchKeep(writer.dataSize());
+    });
+    const double after = benchNs(ITERATIONS, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (int val: values) {
+            writer.value(val);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("8 small ints", before, after);
+
+    const long long big[] = { 1700000000123ll, -9007199254740993ll, 42, 4294967296ll };
+    const double beforeBig = benchNs(ITERATIONS, [&]() {
+        PrintfWriter writer(buf, sizeof(buf));
+        for (long long val: big) {
+            writer.formatInt(val);
+        }
+        benchKeep(writer.dataSize());
+    });
+    const double afterBig = benchNs(ITERATIONS, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (long long val: big) {
+            writer.value(val);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("4 long longs", beforeBig, afterBig);
+}
+
+void bench_doubles() {
+    printf("\n");
+    // Typical telemetry readings
+    const double values[] = { 23.45, -4.125, 1013.25, 0.5, 57.8, 3.3, 101.325, -0.01 };
+    char buf[256];
+    const double beforeShortest = benchNs(ITERATIONS / 10, [&]() {
+        PrintfWriter writer(buf, sizeof(buf));
+        for (double val: values) {
+            writer.formatDouble(val);
+        }
+        benchKeep(writer.dataSize());
+    });
+    const double afterShortest = benchNs(ITERATIONS / 10, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (double val: values) {
+            writer.value(val);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("8 doubles, %g -> shortest", beforeShortest, afterShortest);
+
+    const double beforeFixed = benchNs(ITERATIONS / 10, [&]() {
+        PrintfWriter writer(buf, sizeof(buf));
+        for (double val: values) {
+            writer.formatDouble(val, 2);
+        }
+        benchKeep(writer.dataSize());
+    });
+    const double afterFixed = benchNs(ITERATIONS / 10, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (double val: values) {
+            writer.value(val, 2);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("8 doubles, precision 2", beforeFixed, afterFixed);
+}
+
+// Messages shaped like the Blynk.Inject info, if and scan responses
+template <typename Info, typename If, typename Scan>
+static void benchMessages(const char* name, Info info, If intf, Scan scan) {
+    char buf[256];
+    const double before = benchNs(ITERATIONS / 10, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        info(writer, false);
+        intf(writer, false);
+        scan(writer, false);
+        benchKeep(writer.dataSize());
+    });
+    const double after = benchNs(ITERATIONS / 10, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        info(writer, true);
+        intf(writer, true);
+        scan(writer, true);
+        benchKeep(writer.dataSize());
+    });
+    benchReport(name, before, after);
+}
+
+void bench_values() {
+    printf("\n");
+    // A window of sensor readings
+    std::mt19937 rnd(42);
+    std::vector<int> ints(1000);
+    std::vector<double> doubles(1000);
+    for (size_t i = 0; i < ints.size(); ++i) {
+        ints[i] = (int)(rnd() % 200000) - 100000;
+        doubles[i] = ints[i] / 100.0;
+    }
+    static char buf[16384];
+    const double beforeInts = benchNs(ITERATIONS / 1000, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (int val: ints) {
+            writer.value(val);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    const double afterInts = benchNs(ITERATIONS / 1000, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray().values(ints.data(), ints.size()).endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("1000 ints -> values()", beforeInts, afterInts);
+
+    const double beforeDoubles = benchNs(ITERATIONS / 1000, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (double val: doubles) {
+            writer.value(val);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    const double afterDoubles = benchNs(ITERATIONS / 1000, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray().values(doubles.data(), doubles.size()).endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("1000 doubles -> values()", beforeDoubles, afterDoubles);
+
+    const double beforeFixed = benchNs(ITERATIONS / 1000, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray();
+        for (double val: doubles) {
+            writer.value(val, 2);
+        }
+        writer.endArray();
+        benchKeep(writer.dataSize());
+    });
+    const double afterFixed = benchNs(ITERATIONS / 1000, [&]() {
+        JsonBufferWriter writer(buf, sizeof(buf));
+        writer.beginArray().values(doubles.data(), doubles.size(), 2).endArray();
+        benchKeep(writer.dataSize());
+    });
+    benchReport("1000 doubles, precision 2", beforeFixed, afterFixed);
+}
+
+void bench_keys() {
+    printf("\n");
+    benchMessages("info + if + scan, string -> JSON_KEY",
+        [](JsonWriter& writer, bool keys) {
+            writer.beginObject();
+            if (keys) {
+                writer[JSON_KEY("t")       ] = "info";
+                writer[JSON_KEY("vendor")  ] = "Blynk";
+                writer[JSON_KEY("tmpl_id") ] = "TMPL0123456";
+                writer[JSON_KEY("fw_type") ] = "TMPL0123456";
+                writer[JSON_KEY("fw_ver")  ] = "0.1.0";
+                writer[JSON_KEY("name")    ] = "Blynk Device";
+                writer[JSON_KEY("last_error")] = 0;
+            } else {
+                writer["t"       ] = "info";
+                writer["vendor"  ] = "Blynk";
+                writer["tmpl_id" ] = "TMPL0123456";
+                writer["fw_type" ] = "TMPL0123456";
+                writer["fw_ver"  ] = "0.1.0";
+                writer["name"    ] = "Blynk Device";
+                writer["last_error"] = 0;
+            }
+            writer.endObject();
+        },
+        [](JsonWriter& writer, bool keys) {
+            writer.beginObject();
+            if (keys) {
+                writer[JSON_KEY("t")     ] = "if";
+                writer[JSON_KEY("name")  ] = "wifi";
+                writer[JSON_KEY("mac")   ] = "AA:BB:CC:DD:EE:FF";
+                writer[JSON_KEY("scan")  ] = 1;
+                writer[JSON_KEY("5ghz")  ] = 0;
+                writer[JSON_KEY("static_ip")] = 1;
+            } else {
+                writer["t"     ] = "if";
+                writer["name"  ] = "wifi";
+                writer["mac"   ] = "AA:BB:CC:DD:EE:FF";
+                writer["scan"  ] = 1;
+                writer["5ghz"  ] = 0;
+                writer["static_ip"] = 1;
+            }
+            writer.endObject();
+        },
+        [](JsonWriter& writer, bool keys) {
+            writer.beginObject();
+            if (keys) {
+                writer[JSON_KEY("t")     ] = "scan";
+                writer[JSON_KEY("ssid")  ] = "Blynk Office";
+                writer[JSON_KEY("bssid") ] = "AA:BB:CC:DD:EE:FF";
+                writer[JSON_KEY("rssi")  ] = -67;
+                writer[JSON_KEY("sec")   ] = "WPA2";
+                writer[JSON_KEY("ch")    ] = 6;
+            } else {
+                writer["t"     ] = "scan";
+                writer["ssid"  ] = "Blynk Office";
+                writer["bssid" ] = "AA:BB:CC:DD:EE:FF";
+                writer["rssi"  ] = -67;
+                writer["sec"   ] = "WPA2";
+                writer["ch"    ] = 6;
+            }
+            writer.endObject();
+        });
+}
+
+// Messages shaped like the Blynk.Inject info, if and scan responses, using either writer type
+template <typename Writer>
+static void writeMessages(char* buf, size_t size) {
+    Writer info(buf, size);
+    info.beginObject();
+    info[JSON_KEY("t")       ] = "info";
+    info[JSON_KEY("vendor")  ] = "Blynk";
+    info[JSON_KEY("tmpl_id") ] = "TMPL0123456";
+    info[JSON_KEY("fw_type") ] = "TMPL0123456";
+    info[JSON_KEY("fw_ver")  ] = "0.1.0";
+    info[JSON_KEY("name")    ] = "Blynk Device";
+    info[JSON_KEY("last_error")] = 0;
+    info.endObject();
+    benchKeep(info.dataSize());
+
+    Writer intf(buf, size);
+    intf.beginObject();
+    intf[JSON_KEY("t")     ] = "if";
+    intf[JSON_KEY("name")  ] = "wifi";
+    intf[JSON_KEY("mac")   ] = "AA:BB:CC:DD:EE:FF";
+    intf[JSON_KEY("scan")  ] = 1;
+    intf[JSON_KEY("5ghz")  ] = 0;
+    intf[JSON_KEY("static_ip")] = 1;
+    intf.endObject();
+    benchKeep(intf.dataSize());
+
+    Writer scan(buf, size);
+    scan.beginObject();
+    scan[JSON_KEY("t")     ] = "scan";
+    scan[JSON_KEY("ssid")  ] = "Blynk Office";
+    scan[JSON_KEY("bssid") ] = "AA:BB:CC:DD:EE:FF";
+    scan[JSON_KEY("rssi")  ] = -67;
+    scan[JSON_KEY("sec")   ] = "WPA2";
+    scan[JSON_KEY("ch")    ] = 6;
+    scan.endObject();
+    benchKeep(scan.dataSize());
+}
+
+void bench_inline_writer() {
+    printf("\n");
+    char buf[256];
+    const double before = benchNs(ITERATIONS / 10, [&]() {
+        writeMessages<JsonBufferWriter>(buf, sizeof(buf));
+    });
+    const double after = benchNs(ITERATIONS / 10, [&]() {
+        writeMessages<InlineJsonBufferWriter>(buf, sizeof(buf));
+    });
+    benchReport("info + if + scan, virtual -> inline", before, after);
+}
+
+template <typename Writer>
+static void fillMessages(char* buf, size_t size) {
+    Writer info(buf, size);
+    info.fill(JSON_TEMPLATE(R"({"t":"info","vendor":?,"tmpl_id":?,"fw_type":?,"fw_ver":?,"name":?,"last_error":?})"),
+        "Blynk", "TMPL0123456", "TMPL0123456", "0.1.0", "Blynk Device", 0);
+    benchKeep(info.dataSize());
+
+    Writer intf(buf, size);
+    intf.fill(JSON_TEMPLATE(R"({"t":"if","name":"wifi","mac":?,"scan":?,"5ghz":?,"static_ip":?})"),
+        "AA:BB:CC:DD:EE:FF", 1, 0, 1);
+    benchKeep(intf.dataSize());
+
+    Writer scan(buf, size);
+    scan.fill(JSON_TEMPLATE(R"({"t":"scan","ssid":?,"bssid":?,"rssi":?,"sec":?,"ch":?})"),
+        "Blynk Office", "AA:BB:CC:DD:EE:FF", -67, "WPA2", 6);
+    benchKeep(scan.dataSize());
+}
+
+void bench_templates() {
+    printf("\n");
+    char buf[256];
+    const double before = benchNs(ITERATIONS / 10, [&]() {
+        writeMessages<InlineJsonBufferWriter>(buf, sizeof(buf));
+    });
+    const double after = benchNs(ITERATIONS / 10, [&]() {
+        fillMessages<InlineJsonBufferWriter>(buf, sizeof(buf));
+    });
+    benchReport("info + if + scan, keys -> template", before, after);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_integers);
+    RUN_TEST(test_shortest_doubles);
+    RUN_TEST(test_fixed_doubles);
+    RUN_TEST(test_keys);
+    RUN_TEST(test_chunks);
+    RUN_TEST(test_size);
+    RUN_TEST(test_inline_writer);
+    RUN_TEST(test_templates);
+    RUN_TEST(test_values);
+    RUN_TEST(bench_integers);
+    RUN_TEST(bench_doubles);
+    RUN_TEST(bench_values);
+    RUN_TEST(bench_keys);
+    RUN_TEST(bench_inline_writer);
+    RUN_TEST(bench_templates);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
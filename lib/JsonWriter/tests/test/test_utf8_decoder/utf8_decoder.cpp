@@ -0,0 +1,222 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "Utf8Decoder.h"
+
+#include <random>
+#include <string>
+
+static const unsigned ITERATIONS = 100000;
+
+// Branchy decoder that Utf8Decoder used to be, see Utf8Decoder.cpp for the rules
+class LegacyUtf8Decoder {
+public:
+    LegacyUtf8Decoder(const char* p, int length)
+        : _length(length), _input(p) {}
+
+    __attribute__((noinline)) int next() {
+        if (_index >= _length) {
+            return _index == _length ? UTF8_END : UTF8_ERROR;
+        }
+        _byte = _index;
+        const int c = get();
+        int c1, c2, c3, r;
+        if ((c & 0x80) == 0) {
+            return c;
+        }
+        if ((c & 0xE0) == 0xC0) {
+            c1 = cont();
+            if (c1 >= 0) {
+                r = ((c & 0x1F) << 6) | c1;
+                if (r >= 128) {
+                    return r;
+                }
+            }
+        } else if ((c & 0xF0) == 0xE0) {
+            c1 = cont();
+            c2 = cont();
+            if ((c1 | c2) >= 0) {
+                r = ((c & 0x0F) << 12) | (c1 << 6) | c2;
+                if (r >= 2048 && (r < 55296 || r > 57343)) {
+                    return r;
+                }
+            }
+        } else if ((c & 0xF8) == 0xF0) {
+            c1 = cont();
+            c2 = cont();
+            c3 = cont();
+            if ((c1 | c2 | c3) >= 0) {
+                r = ((c & 0x07) << 18) | (c1 << 12) | (c2 << 6) | c3;
+                if (r >= 65536 && r <= 1114111) {
+                    return r;
+                }
+            }
+        }
+        return UTF8_ERROR;
+    }
+
+    int at_byte() const { return _byte; }
+    int symbol_size() const { return _index - _byte; }
+
+private:
+    int get() {
+        if (_index >= _length) {
+            return UTF8_END;
+        }
+        return _input[_index++] & 0xFF;
+    }
+
+    int cont() {
+        const int c = get();
+        return ((c & 0xC0) == 0x80) ? (c & 0x3F) : UTF8_ERROR;
+    }
+
+    int _index = 0;
+    int _byte = 0;
+    int _length;
+    const char* _input;
+};
+
+// Decodes the first character of a string with both decoders and compares the results
+static void checkFirst(const char* s, int len) {
+    Utf8Decoder d(s, len);
+    LegacyUtf8Decoder legacy(s, len);
+    const int c = d.next();
+    const int expected = legacy.next();
+    TEST_ASSERT_EQUAL(expected, c);
+    if (c >= 0) {
+        TEST_ASSERT_EQUAL(legacy.symbol_size(), d.symbol_size());
+    }
+}
+
+// Offset of the first character the legacy decoder rejects
+static int legacyValidPrefix(const std::string& s) {
+    LegacyUtf8Decoder legacy(s.data(), s.size());
+    int c;
+    while ((c = legacy.next()) >= 0) {
+    }
+    return (c == UTF8_END) ? s.size() : legacy.at_byte();
+}
+
+static std::string randomString(std::mt19937& rnd) {
+    static const char* const PIECES[] = {
+        "a", "Blynk HaLow ", "0123456789abcdef", "\xc3\xa9", "\xd0\xbc", "\xe2\x82\xac", "\xf0\x9f\x98\x81",
+        "\xc3", "\xe2\x82", "\xf0\x9f\x98", "\x80", "\xbf", "\xc0\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+        "\xf8\x88\x80\x80\x80", "\xff"
+    };
+    std::string s;
+    const unsigned n = rnd() % 30;
+    for (unsigned i = 0; i < n; ++i) {
+        s += PIECES[rnd() % (rnd() % 3 ? 7 : sizeof(PIECES) / sizeof(PIECES[0]))];
+    }
+    return s;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_decode() {
+    // All sequences of up to 3 bytes, and 4-byte ones starting with a valid lead byte
+    char s[4];
+    for (unsigned b0 = 0; b0 < 256; ++b0) {
+        s[0] = b0;
+        checkFirst(s, 1);
+        for (unsigned b1 = 0; b1 < 256; ++b1) {
+            s[1] = b1;
+            checkFirst(s, 2);
+            for (unsigned b2 = 0; b2 < 256; ++b2) {
+                s[2] = b2;
+                checkFirst(s, 3);
+                if (b0 >= 0xF0 && b0 <= 0xF4 && (b1 & 0xC0) == 0x80 && (b2 & 0xC0) == 0x80) {
+                    for (unsigned b3 = 0; b3 < 256; ++b3) {
+                        s[3] = b3;
+                        checkFirst(s, 4);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void test_skip_valid() {
+    TEST_ASSERT_EQUAL(0, Utf8Decoder("", 0).skip_valid());
+    TEST_ASSERT_EQUAL(20, Utf8Decoder("ASCII text, 20 bytes").skip_valid());
+    TEST_ASSERT_EQUAL(3, Utf8Decoder("abc\xc3").skip_valid()); // Truncated
+    TEST_ASSERT_EQUAL(11, Utf8Decoder("0123456789a\xed\xa0\x80" "bc").skip_valid()); // Surrogate
+
+    std::mt19937 rnd(1);
+    for (unsigned i = 0; i < 200000; ++i) {
+        const std::string s = randomString(rnd);
+        Utf8Decoder d(s.data(), s.size());
+        const int pos = d.skip_valid();
+        TEST_ASSERT_EQUAL(legacyValidPrefix(s), pos);
+        TEST_ASSERT_EQUAL(pos, d.at_byte());
+        // Decoding continues at the offending character
+        TEST_ASSERT_EQUAL((pos == (int)s.size()) ? UTF8_END : UTF8_ERROR, d.next());
+    }
+}
+
+void bench_decode() {
+    printf("\n");
+    std::string ascii, cyrillic, mixed;
+    for (int i = 0; i < 16; ++i) {
+        ascii += "Blynk Office 5th floor, east wing AP ";
+        cyrillic += "\xd0\x9c\xd0\xbe\xd1\x8f \xd0\xbc\xd0\xb5\xd1\x80\xd0\xb5\xd0\xb6\xd0\xb0 ";
+        mixed += "Wi-Fi \xd0\xbc\xd0\xb5\xd1\x80\xd0\xb5\xd0\xb6\xd0\xb0 #5 \xf0\x9f\x98\x81 caf\xc3\xa9 ";
+    }
+    for (const std::string* s: { &ascii, &cyrillic, &mixed }) {
+        const double legacy = benchNs(ITERATIONS, [&]() {
+            LegacyUtf8Decoder d(s->data(), s->size());
+            int n = 0;
+            while (d.next() >= 0) {
+                ++n;
+            }
+            benchKeep(n);
+        });
+        const double next = benchNs(ITERATIONS, [&]() {
+            Utf8Decoder d(s->data(), s->size());
+            int n = 0;
+            while (d.next() >= 0) {
+                ++n;
+            }
+            benchKeep(n);
+        });
+        const double skip = benchNs(ITERATIONS, [&]() {
+            Utf8Decoder d(s->data(), s->size());
+            benchKeep(d.skip_valid());
+        });
+        const char* name = (s == &ascii) ? "ascii" : (s == &cyrillic) ? "cyrillic" : "mixed";
+        char buf[64];
+        snprintf(buf, sizeof(buf), "next(), %uB %s", (unsigned)s->size(), name);
+        benchReport(buf, legacy, next);
+        snprintf(buf, sizeof(buf), "skip_valid(), %uB %s", (unsigned)s->size(), name);
+        benchReport(buf, legacy, skip);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_decode);
+    RUN_TEST(test_skip_valid);
+    RUN_TEST(bench_decode);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,382 @@
+/*
+ * Fast conversion of JSON numbers, see JSONNumber.h
+ *
+ * The Eisel-Lemire algorithm is described in "Number Parsing at a Gigabyte per Second" by
+ * Daniel Lemire, and "Fast Number Parsing Without Fallback" by Noble Mushtak and Daniel Lemire.
+ */
+
+#include "JSONNumber.h"
+
+#include <stdint.h>
+#include <string.h>
+
+namespace {
+
+// Powers of ten covered by the table of powers of five. Numbers with a larger decimal exponent are
+// rare in JSON documents and are left to strtod(), which keeps the table at about 2 KB
+const int POW10_MIN = -64;
+const int POW10_MAX = 64;
+
+// Powers of five from 5^POW10_MIN to 5^POW10_MAX, as 128-bit values normalized so that the most
+// significant bit is set: { high 64 bits, low 64 bits }
+const uint64_t POW5[][2] = {
+    { 0xa87fea27a539e9a5, 0x3f2398d747b36224 }, // 5^-64
+    { 0xd29fe4b18e88640e, 0x8eec7f0d19a03aad }, // 5^-63
+    { 0x83a3eeeef9153e89, 0x1953cf68300424ac }, // 5^-62
+    { 0xa48ceaaab75a8e2b, 0x5fa8c3423c052dd7 }, // 5^-61
+    { 0xcdb02555653131b6, 0x3792f412cb06794d }, // 5^-60
+    { 0x808e17555f3ebf11, 0xe2bbd88bbee40bd0 }, // 5^-59
+    { 0xa0b19d2ab70e6ed6, 0x5b6aceaeae9d0ec4 }, // 5^-58
+    { 0xc8de047564d20a8b, 0xf245825a5a445275 }, // 5^-57
+    { 0xfb158592be068d2e, 0xeed6e2f0f0d56712 }, // 5^-56
+    { 0x9ced737bb6c4183d, 0x55464dd69685606b }, // 5^-55
+    { 0xc428d05aa4751e4c, 0xaa97e14c3c26b886 }, // 5^-54
+    { 0xf53304714d9265df, 0xd53dd99f4b3066a8 }, // 5^-53
+    { 0x993fe2c6d07b7fab, 0xe546a8038efe4029 }, // 5^-52
+    { 0xbf8fdb78849a5f96, 0xde98520472bdd033 }, // 5^-51
+    { 0xef73d256a5c0f77c, 0x963e66858f6d4440 }, // 5^-50
+    { 0x95a8637627989aad, 0xdde7001379a44aa8 }, // 5^-49
+    { 0xbb127c53b17ec159, 0x5560c018580d5d52 }, // 5^-48
+    { 0xe9d71b689dde71af, 0xaab8f01e6e10b4a6 }, // 5^-47
+    { 0x9226712162ab070d, 0xcab3961304ca70e8 }, // 5^-46
+    { 0xb6b00d69bb55c8d1, 0x3d607b97c5fd0d22 }, // 5^-45
+    { 0xe45c10c42a2b3b05, 0x8cb89a7db77c506a }, // 5^-44
+    { 0x8eb98a7a9a5b04e3, 0x77f3608e92adb242 }, // 5^-43
+    { 0xb267ed1940f1c61c, 0x55f038b237591ed3 }, // 5^-42
+    { 0xdf01e85f912e37a3, 0x6b6c46dec52f6688 }, // 5^-41
+    { 0x8b61313bbabce2c6, 0x2323ac4b3b3da015 }, // 5^-40
+    { 0xae397d8aa96c1b77, 0xabec975e0a0d081a }, // 5^-39
+    { 0xd9c7dced53c72255, 0x96e7bd358c904a21 }, // 5^-38
+    { 0x881cea14545c7575, 0x7e50d64177da2e54 }, // 5^-37
+    { 0xaa242499697392d2, 0xdde50bd1d5d0b9e9 }, // 5^-36
+    { 0xd4ad2dbfc3d07787, 0x955e4ec64b44e864 }, // 5^-35
+    { 0x84ec3c97da624ab4, 0xbd5af13bef0b113e }, // 5^-34
+    { 0xa6274bbdd0fadd61, 0xecb1ad8aeacdd58e }, // 5^-33
+    { 0xcfb11ead453994ba, 0x67de18eda5814af2 }, // 5^-32
+    { 0x81ceb32c4b43fcf4, 0x80eacf948770ced7 }, // 5^-31
+    { 0xa2425ff75e14fc31, 0xa1258379a94d028d }, // 5^-30
+    { 0xcad2f7f5359a3b3e, 0x096ee45813a04330 }, // 5^-29
+    { 0xfd87b5f28300ca0d, 0x8bca9d6e188853fc }, // 5^-28
+    { 0x9e74d1b791e07e48, 0x775ea264cf55347e }, // 5^-27
+    { 0xc612062576589dda, 0x95364afe032a819e }, // 5^-26
+    { 0xf79687aed3eec551, 0x3a83ddbd83f52205 }, // 5^-25
+    { 0x9abe14cd44753b52, 0xc4926a9672793543 }, // 5^-24
+    { 0xc16d9a0095928a27, 0x75b7053c0f178294 }, // 5^-23
+    { 0xf1c90080baf72cb1, 0x5324c68b12dd6339 }, // 5^-22
+    { 0x971da05074da7bee, 0xd3f6fc16ebca5e04 }, // 5^-21
+    { 0xbce5086492111aea, 0x88f4bb1ca6bcf585 }, // 5^-20
+    { 0xec1e4a7db69561a5, 0x2b31e9e3d06c32e6 }, // 5^-19
+    { 0x9392ee8e921d5d07, 0x3aff322e62439fd0 }, // 5^-18
+    { 0xb877aa3236a4b449, 0x09befeb9fad487c3 }, // 5^-17
+    { 0xe69594bec44de15b, 0x4c2ebe687989a9b4 }, // 5^-16
+    { 0x901d7cf73ab0acd9, 0x0f9d37014bf60a11 }, // 5^-15
+    { 0xb424dc35095cd80f, 0x538484c19ef38c95 }, // 5^-14
+    { 0xe12e13424bb40e13, 0x2865a5f206b06fba }, // 5^-13
+    { 0x8cbccc096f5088cb, 0xf93f87b7442e45d4 }, // 5^-12
+    { 0xafebff0bcb24aafe, 0xf78f69a51539d749 }, // 5^-11
+    { 0xdbe6fecebdedd5be, 0xb573440e5a884d1c }, // 5^-10
+    { 0x89705f4136b4a597, 0x31680a88f8953031 }, // 5^-9
+    { 0xabcc77118461cefc, 0xfdc20d2b36ba7c3e }, // 5^-8
+    { 0xd6bf94d5e57a42bc, 0x3d32907604691b4d }, // 5^-7
+    { 0x8637bd05af6c69b5, 0xa63f9a49c2c1b110 }, // 5^-6
+    { 0xa7c5ac471b478423, 0x0fcf80dc33721d54 }, // 5^-5
+    { 0xd1b71758e219652b, 0xd3c36113404ea4a9 }, // 5^-4
+    { 0x83126e978d4fdf3b, 0x645a1cac083126ea }, // 5^-3
+    { 0xa3d70a3d70a3d70a, 0x3d70a3d70a3d70a4 }, // 5^-2
+    { 0xcccccccccccccccc, 0xcccccccccccccccd }, // 5^-1
+    { 0x8000000000000000, 0x0000000000000000 }, // 5^0
+    { 0xa000000000000000, 0x0000000000000000 }, // 5^1
+    { 0xc800000000000000, 0x0000000000000000 }, // 5^2
+    { 0xfa00000000000000, 0x0000000000000000 }, // 5^3
+    { 0x9c40000000000000, 0x0000000000000000 }, // 5^4
+    { 0xc350000000000000, 0x0000000000000000 }, // 5^5
+    { 0xf424000000000000, 0x0000000000000000 }, // 5^6
+    { 0x9896800000000000, 0x0000000000000000 }, // 5^7
+    { 0xbebc200000000000, 0x0000000000000000 }, // 5^8
+    { 0xee6b280000000000, 0x0000000000000000 }, // 5^9
+    { 0x9502f90000000000, 0x0000000000000000 }, // 5^10
+    { 0xba43b74000000000, 0x0000000000000000 }, // 5^11
+    { 0xe8d4a51000000000, 0x0000000000000000 }, // 5^12
+    { 0x9184e72a00000000, 0x0000000000000000 }, // 5^13
+    { 0xb5e620f480000000, 0x0000000000000000 }, // 5^14
+    { 0xe35fa931a0000000, 0x0000000000000000 }, // 5^15
+    { 0x8e1bc9bf04000000, 0x0000000000000000 }, // 5^16
+    { 0xb1a2bc2ec5000000, 0x0000000000000000 }, // 5^17
+    { 0xde0b6b3a76400000, 0x0000000000000000 }, // 5^18
+    { 0x8ac7230489e80000, 0x0000000000000000 }, // 5^19
+    { 0xad78ebc5ac620000, 0x0000000000000000 }, // 5^20
+    { 0xd8d726b7177a8000, 0x0000000000000000 }, // 5^21
+    { 0x878678326eac9000, 0x0000000000000000 }, // 5^22
+    { 0xa968163f0a57b400, 0x0000000000000000 }, // 5^23
+    { 0xd3c21bcecceda100, 0x0000000000000000 }, // 5^24
+    { 0x84595161401484a0, 0x0000000000000000 }, // 5^25
+    { 0xa56fa5b99019a5c8, 0x0000000000000000 }, // 5^26
+    { 0xcecb8f27f4200f3a, 0x0000000000000000 }, // 5^27
+    { 0x813f3978f8940984, 0x4000000000000000 }, // 5^28
+    { 0xa18f07d736b90be5, 0x5000000000000000 }, // 5^29
+    { 0xc9f2c9cd04674ede, 0xa400000000000000 }, // 5^30
+    { 0xfc6f7c4045812296, 0x4d00000000000000 }, // 5^31
+    { 0x9dc5ada82b70b59d, 0xf020000000000000 }, // 5^32
+    { 0xc5371912364ce305, 0x6c28000000000000 }, // 5^33
+    { 0xf684df56c3e01bc6, 0xc732000000000000 }, // 5^34
+    { 0x9a130b963a6c115c, 0x3c7f400000000000 }, // 5^35
+    { 0xc097ce7bc90715b3, 0x4b9f100000000000 }, // 5^36
+    { 0xf0bdc21abb48db20, 0x1e86d40000000000 }, // 5^37
+    { 0x96769950b50d88f4, 0x1314448000000000 }, // 5^38
+    { 0xbc143fa4e250eb31, 0x17d955a000000000 }, // 5^39
+    { 0xeb194f8e1ae525fd, 0x5dcfab0800000000 }, // 5^40
+    { 0x92efd1b8d0cf37be, 0x5aa1cae500000000 }, // 5^41
+    { 0xb7abc627050305ad, 0xf14a3d9e40000000 }, // 5^42
+    { 0xe596b7b0c643c719, 0x6d9ccd05d0000000 }, // 5^43
+    { 0x8f7e32ce7bea5c6f, 0xe4820023a2000000 }, // 5^44
+    { 0xb35dbf821ae4f38b, 0xdda2802c8a800000 }, // 5^45
+    { 0xe0352f62a19e306e, 0xd50b2037ad200000 }, // 5^46
+    { 0x8c213d9da502de45, 0x4526f422cc340000 }, // 5^47
+    { 0xaf298d050e4395d6, 0x9670b12b7f410000 }, // 5^48
+    { 0xdaf3f04651d47b4c, 0x3c0cdd765f114000 }, // 5^49
+    { 0x88d8762bf324cd0f, 0xa5880a69fb6ac800 }, // 5^50
+    { 0xab0e93b6efee0053, 0x8eea0d047a457a00 }, // 5^51
+    { 0xd5d238a4abe98068, 0x72a4904598d6d880 }, // 5^52
+    { 0x85a36366eb71f041, 0x47a6da2b7f864750 }, // 5^53
+    { 0xa70c3c40a64e6c51, 0x999090b65f67d924 }, // 5^54
+    { 0xd0cf4b50cfe20765, 0xfff4b4e3f741cf6d }, // 5^55
+    { 0x82818f1281ed449f, 0xbff8f10e7a8921a4 }, // 5^56
+    { 0xa321f2d7226895c7, 0xaff72d52192b6a0d }, // 5^57
+    { 0xcbea6f8ceb02bb39, 0x9bf4f8a69f764490 }, // 5^58
+    { 0xfee50b7025c36a08, 0x02f236d04753d5b4 }, // 5^59
+    { 0x9f4f2726179a2245, 0x01d762422c946590 }, // 5^60
+    { 0xc722f0ef9d80aad6, 0x424d3ad2b7b97ef5 }, // 5^61
+    { 0xf8ebad2b84e0d58b, 0xd2e0898765a7deb2 }, // 5^62
+    { 0x9b934c3b330c8577, 0x63cc55f49f88eb2f }, // 5^63
+    { 0xc2781f49ffcfa6d5, 0x3cbf6b71c76b25fb }, // 5^64
+};
+
+static_assert(sizeof(POW5) / sizeof(POW5[0]) == POW10_MAX - POW10_MIN + 1, "Invalid table of powers of five");
+
+// Powers of ten that are exactly representable as double
+const double EXACT_POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const int EXACT_POW10_MAX = 22;
+
+// Largest integer below which all integers are exactly representable as double
+const uint64_t EXACT_INT_MAX = (uint64_t)1 << 53;
+
+inline bool isDigit(char c) {
+    return (unsigned char)(c - '0') < 10;
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+inline uint64_t loadEightChars(const char *s) {
+    uint64_t v;
+    memcpy(&v, s, sizeof(v)); // Unaligned load
+    return v;
+}
+
+inline bool isEightDigits(uint64_t v) {
+    return !(((v + 0x4646464646464646) | (v - 0x3030303030303030)) & 0x8080808080808080);
+}
+
+// Converts eight digits with three multiplications instead of eight
+inline uint32_t parseEightDigits(uint64_t v) {
+    v -= 0x3030303030303030;
+    v = (v * 10) + (v >> 8); // Pairs of digits
+    v = (((v & 0x000000ff000000ff) * 0x000f424000000064) +
+            (((v >> 16) & 0x000000ff000000ff) * 0x0000271000000001)) >> 32;
+    return (uint32_t)v;
+}
+
+#endif // __ORDER_LITTLE_ENDIAN__
+
+// Accumulates digits to val while there are any. Returns a pointer to the first non-digit character
+inline const char* parseDigits(const char *s, const char *end, uint64_t *val) {
+    uint64_t v = *val;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (end - s >= 8) {
+        const uint64_t chars = loadEightChars(s);
+        if (!isEightDigits(chars)) {
+            break;
+        }
+        v = v * 100000000 + parseEightDigits(chars);
+        s += 8;
+    }
+#endif
+    while (s != end && isDigit(*s)) {
+        v = v * 10 + (*s - '0');
+        ++s;
+    }
+    *val = v;
+    return s;
+}
+
+// Parses an optionally negative integer. Returns false if there are no digits or the absolute
+// value doesn't fit in 64 bits
+bool parseInteger(const char *s, const char *end, uint64_t *val, bool *neg) {
+    *neg = (s != end && *s == '-');
+    if (*neg) {
+        ++s;
+    }
+    const char *p = s;
+    while (p != end && *p == '0') {
+        ++p; // Skip leading zeros
+    }
+    const char* const digits = p;
+    uint64_t v = 0;
+    p = parseDigits(p, end, &v);
+    const ptrdiff_t n = p - digits;
+    if (p == s || n > 20) {
+        return false;
+    }
+    if (n == 20 && (digits[0] > '1' || v < 10000000000000000000u)) {
+        return false; // Overflow
+    }
+    *val = v;
+    return true;
+}
+
+// 64 by 64 bits multiplication with a 128-bit result
+inline void multiply(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo) {
+#ifdef __SIZEOF_INT128__
+    const unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (uint64_t)(r >> 64);
+    *lo = (uint64_t)r;
+#else
+    const uint64_t aLo = (uint32_t)a, aHi = a >> 32;
+    const uint64_t bLo = (uint32_t)b, bHi = b >> 32;
+    const uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    const uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    *lo = (mid << 32) | (uint32_t)ll;
+    *hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// Computes w * 10^q rounded to the nearest double, w must not be zero and q must be within the
+// range of the table
+double eiselLemire(uint64_t w, int q) {
+    const int lz = __builtin_clzll(w);
+    w <<= lz;
+    const uint64_t *pow5 = POW5[q - POW10_MIN];
+    uint64_t hi, lo;
+    multiply(w, pow5[0], &hi, &lo);
+    if ((hi & 0x1ff) == 0x1ff) {
+        // The lower bits are needed to tell how to round the result
+        uint64_t hi2, lo2;
+        multiply(w, pow5[1], &hi2, &lo2);
+        lo += hi2;
+        if (hi2 > lo) {
+            ++hi;
+        }
+    }
+    const int upperBit = (int)(hi >> 63);
+    const int shift = upperBit + 9;
+    uint64_t mantissa = hi >> shift;
+    // Binary exponent of the result: floor(q * log2(10)) + 63, biased for the double format
+    int power2 = (((152170 + 65536) * q) >> 16) + 63 + upperBit - lz + 1023;
+    // The result is halfway between two doubles: round to even
+    if (lo <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == hi) {
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    if (mantissa >= ((uint64_t)2 << 52)) {
+        mantissa = (uint64_t)1 << 52;
+        ++power2;
+    }
+    mantissa &= ~((uint64_t)1 << 52);
+    const uint64_t bits = mantissa | ((uint64_t)power2 << 52);
+    double d;
+    memcpy(&d, &bits, sizeof(d));
+    return d;
+}
+
+} // namespace
+
+bool spark::detail::parseInt64(const char *s, const char *end, long long *val) {
+    uint64_t v = 0;
+    bool neg = false;
+    if (!parseInteger(s, end, &v, &neg) || v > (uint64_t)INT64_MAX + neg) {
+        return false;
+    }
+    *val = neg ? (long long)(0 - v) : (long long)v;
+    return true;
+}
+
+bool spark::detail::parseUInt64(const char *s, const char *end, unsigned long long *val) {
+    uint64_t v = 0;
+    bool neg = false;
+    if (!parseInteger(s, end, &v, &neg) || neg) {
+        return false; // strtoull() wraps negative values around
+    }
+    *val = v;
+    return true;
+}
+
+bool spark::detail::parseDouble(const char *s, const char *end, double *val) {
+    const char *p = s;
+    const bool neg = (p != end && *p == '-');
+    if (neg) {
+        ++p;
+    }
+    const char* const intPart = p;
+    uint64_t w = 0;
+    p = parseDigits(p, end, &w);
+    ptrdiff_t digits = p - intPart;
+    if (p != end && (*p == 'x' || *p == 'X')) {
+        return false; // strtod() parses hexadecimal numbers
+    }
+    int exp = 0;
+    if (p != end && *p == '.') {
+        const char* const fracPart = ++p;
+        p = parseDigits(p, end, &w);
+        exp = (int)(fracPart - p);
+        digits += p - fracPart;
+    }
+    if (!digits) {
+        return false;
+    }
+    if (p != end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        const bool expNeg = (e != end && *e == '-');
+        if (e != end && (*e == '-' || *e == '+')) {
+            ++e;
+        }
+        if (e != end && isDigit(*e)) {
+            int n = 0;
+            do {
+                if (n < 10000) {
+                    n = n * 10 + (*e - '0');
+                }
+                ++e;
+            } while (e != end && isDigit(*e));
+            exp += expNeg ? -n : n;
+        }
+    }
+    if (digits > 19) {
+        // The significand may have overflowed, unless there are enough leading zeros
+        for (p = intPart; digits > 19 && (*p == '0' || *p == '.'); ++p) {
+            if (*p == '0') {
+                --digits;
+            }
+        }
+        if (digits > 19) {
+            return false;
+        }
+    }
+    double d = 0;
+    if (w == 0) {
+        d = 0;
+    } else if (w <= EXACT_INT_MAX && exp >= -EXACT_POW10_MAX && exp <= EXACT_POW10_MAX) {
+        // Both the significand and the power of ten are exact, so is the result of a single operation
+        d = (double)w;
+        d = (exp < 0) ? d / EXACT_POW10[-exp] : d * EXACT_POW10[exp];
+    } else if (exp >= POW10_MIN && exp <= POW10_MAX) {
+        d = eiselLemire(w, exp);
+    } else {
+        return false;
+    }
+    *val = neg ? -d : d;
+    return true;
+}
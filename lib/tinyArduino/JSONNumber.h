@@ -0,0 +1,28 @@
+/*
+ * Fast conversion of JSON numbers.
+ *
+ * The functions work on a span of characters that doesn't need to be null-terminated, and parse
+ * the longest prefix of the span that forms a decimal number, like the strto*() functions do.
+ * Input they don't handle on the fast path, such as leading whitespace, a plus sign, too many
+ * significant digits or values out of range, is rejected by returning false, in which case the
+ * caller is expected to fall back to the corresponding strto*() function.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+namespace spark {
+
+namespace detail {
+
+bool parseInt64(const char *s, const char *end, long long *val);
+bool parseUInt64(const char *s, const char *end, unsigned long long *val);
+
+// Decimal to binary conversion is exact: a plain floating-point computation is used when it
+// can't introduce rounding errors (Clinger's fast path), otherwise the Eisel-Lemire algorithm
+bool parseDouble(const char *s, const char *end, double *val);
+
+} // namespace spark::detail
+
+} // namespace spark
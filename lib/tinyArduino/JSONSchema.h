@@ -0,0 +1,393 @@
+/*
+ * Direct deserialization of JSON objects into structs.
+ *
+ * A schema binds property names to struct members. JSONSchemaReader takes the
+ * values reported by JSONStreamParser and stores them straight to the members,
+ * so no token tree or intermediate strings are built:
+ *
+ *   struct Point { int x, y; String label; };
+ *
+ *   static constexpr JSONField<Point> POINT_FIELDS[] = {
+ *       jsonField("x", &Point::x),
+ *       jsonField("y", &Point::y),
+ *       jsonField("label", &Point::label),
+ *   };
+ *   static constexpr auto POINT_SCHEMA = makeJSONSchema(POINT_FIELDS);
+ *   static_assert(POINT_SCHEMA.isValid(), "Invalid schema");
+ *
+ *   Point p = {};
+ *   bool ok = POINT_SCHEMA.read(p, json, size);
+ *
+ * Properties that are not in the document leave their members untouched.
+ */
+
+#pragma once
+
+#include "wiring_json.h"
+#include "JSONNumber.h"
+#include "PerfectHash.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <utility>
+
+template<typename T>
+struct JSONField {
+    enum Type {
+        IGNORE, // Known property that is not stored
+        STRING, // Any primitive value, as text. Nulls and compound values are stored as empty strings
+        BOOL,
+        INT,
+        DOUBLE,
+        PRESENCE // Set to true if the property is present, regardless of its value
+    };
+
+    const char *name;
+    Type type;
+    String T::*str;
+    bool T::*flag;
+    int T::*num;
+    double T::*dbl;
+};
+
+template<typename T>
+constexpr JSONField<T> jsonField(const char *name, String T::*member) {
+    return { name, JSONField<T>::STRING, member, nullptr, nullptr, nullptr };
+}
+
+template<typename T>
+constexpr JSONField<T> jsonField(const char *name, bool T::*member) {
+    return { name, JSONField<T>::BOOL, nullptr, member, nullptr, nullptr };
+}
+
+template<typename T>
+constexpr JSONField<T> jsonField(const char *name, int T::*member) {
+    return { name, JSONField<T>::INT, nullptr, nullptr, member, nullptr };
+}
+
+template<typename T>
+constexpr JSONField<T> jsonField(const char *name, double T::*member) {
+    return { name, JSONField<T>::DOUBLE, nullptr, nullptr, nullptr, member };
+}
+
+template<typename T>
+constexpr JSONField<T> jsonPresence(const char *name, bool T::*member) {
+    return { name, JSONField<T>::PRESENCE, nullptr, member, nullptr, nullptr };
+}
+
+template<typename T>
+constexpr JSONField<T> jsonIgnore(const char *name) {
+    return { name, JSONField<T>::IGNORE, nullptr, nullptr, nullptr, nullptr };
+}
+
+template<typename T, size_t N>
+class JSONSchema {
+public:
+    typedef JSONField<T> Field;
+
+    constexpr explicit JSONSchema(const Field (&fields)[N]) :
+            fields_(),
+            hash_(fields, &Field::name) {
+        for (size_t i = 0; i < N; ++i) {
+            fields_[i] = fields[i];
+        }
+    }
+
+    // Returns false if property names are not unique
+    constexpr bool isValid() const {
+        return hash_.isValid();
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    constexpr const Field& field(size_t index) const {
+        return fields_[index];
+    }
+
+    // Returns the index of the field, or -1 if there's no such field
+    int find(const char *name, size_t size) const {
+        return hash_.find(name, size);
+    }
+
+    // Stores a null-terminated value to the field. Returns false if the value's type doesn't
+    // match the field's type
+    bool assign(T &obj, int index, spark::JSONType type, const char *val, size_t size) const;
+
+    // Appends a part of a string value to the field. Parts are ignored by fields of other types.
+    // Returns false if there's not enough memory for it
+    bool append(T &obj, int index, const char *part, size_t size) const;
+
+    // Moves the value of the field from one struct to another
+    void move(T &to, T &from, int index) const;
+
+    // Parses a JSON object and stores its properties to obj. Returns false if the document
+    // is not a valid JSON object
+    bool read(T &obj, const char *json, size_t size) const;
+
+private:
+    Field fields_[N];
+    PerfectHash<N> hash_;
+};
+
+template<typename T, size_t N>
+constexpr JSONSchema<T, N> makeJSONSchema(const JSONField<T> (&fields)[N]) {
+    return JSONSchema<T, N>(fields);
+}
+
+// Stores properties of a JSON object to a struct as they are parsed. Compound values
+// of the object's properties are skipped
+template<typename T, size_t N>
+class JSONSchemaReader: public spark::JSONStreamHandler {
+public:
+    // Longest property name in the schema, and the size of parts in which long string values are
+    // stored. Longer names in a document are counted as unknown
+    static const size_t BUFFER_SIZE = 64;
+
+    JSONSchemaReader(const JSONSchema<T, N> &schema, T &obj);
+
+    // Parses a complete document. Returns false if it's not a valid JSON object, or if there's
+    // not enough memory for a string value
+    bool parse(const char *json, size_t size);
+
+    unsigned unknownKeys() const;
+    unsigned invalidValues() const;
+
+    virtual bool beginArray() override;
+    virtual bool endArray() override;
+    virtual bool beginObject() override;
+    virtual bool endObject() override;
+    virtual bool name(const char *name, size_t size) override;
+    virtual bool value(spark::JSONType type, const char *val, size_t size) override;
+    virtual bool valuePart(const char *data, size_t size) override;
+    virtual bool namePart(const char *data, size_t size) override;
+
+protected:
+    // Called before a value is stored to a field. For values that are passed in parts, only
+    // the first part is passed, as a string. Returning false skips the value
+    virtual bool accept(int field, spark::JSONType type, const char *val, size_t size);
+
+private:
+    const JSONSchema<T, N> &schema_;
+    T &obj_;
+    char buf_[BUFFER_SIZE];
+    unsigned depth_;
+    unsigned unknown_;
+    unsigned invalid_;
+    int field_; // Field of the current property
+    bool partial_; // Parts of a string value are being stored
+    bool skip_; // Parts of a value are being skipped
+    bool longName_; // Parts of a name have been skipped
+
+    void store(spark::JSONType type, const char *val, size_t size);
+};
+
+// JSONSchema
+template<typename T, size_t N>
+inline bool JSONSchema<T, N>::assign(T &obj, int index, spark::JSONType type, const char *val, size_t size) const {
+    const Field &f = fields_[index];
+    switch (f.type) {
+    case Field::STRING:
+        if (type == spark::JSON_TYPE_OBJECT || type == spark::JSON_TYPE_ARRAY || type == spark::JSON_TYPE_NULL) {
+            val = "";
+        }
+        obj.*f.str = val;
+        return true;
+    case Field::BOOL:
+        if (type != spark::JSON_TYPE_BOOL) {
+            return false;
+        }
+        obj.*f.flag = (val[0] == 't');
+        return true;
+    case Field::INT: {
+        if (type != spark::JSON_TYPE_NUMBER) {
+            return false;
+        }
+        long long num = 0;
+        if (spark::detail::parseInt64(val, val + size, &num) && num >= LONG_MIN && num <= LONG_MAX) {
+            obj.*f.num = (int)num;
+        } else {
+            obj.*f.num = (int)strtol(val, nullptr, 10);
+        }
+        return true;
+    }
+    case Field::DOUBLE:
+        if (type != spark::JSON_TYPE_NUMBER) {
+            return false;
+        }
+        if (!spark::detail::parseDouble(val, val + size, &(obj.*f.dbl))) {
+            obj.*f.dbl = strtod(val, nullptr);
+        }
+        return true;
+    case Field::PRESENCE:
+        obj.*f.flag = true;
+        return true;
+    default: // IGNORE
+        return true;
+    }
+}
+
+template<typename T, size_t N>
+inline bool JSONSchema<T, N>::append(T &obj, int index, const char *part, size_t size) const {
+    const Field &f = fields_[index];
+    if (f.type != Field::STRING) {
+        return true;
+    }
+    return (obj.*f.str).concat(part, size);
+}
+
+template<typename T, size_t N>
+inline void JSONSchema<T, N>::move(T &to, T &from, int index) const {
+    const Field &f = fields_[index];
+    switch (f.type) {
+    case Field::STRING:
+        to.*f.str = std::move(from.*f.str);
+        break;
+    case Field::BOOL:
+    case Field::PRESENCE:
+        to.*f.flag = from.*f.flag;
+        break;
+    case Field::INT:
+        to.*f.num = from.*f.num;
+        break;
+    case Field::DOUBLE:
+        to.*f.dbl = from.*f.dbl;
+        break;
+    default: // IGNORE
+        break;
+    }
+}
+
+template<typename T, size_t N>
+inline bool JSONSchema<T, N>::read(T &obj, const char *json, size_t size) const {
+    JSONSchemaReader<T, N> reader(*this, obj);
+    return reader.parse(json, size);
+}
+
+// JSONSchemaReader
+template<typename T, size_t N>
+inline JSONSchemaReader<T, N>::JSONSchemaReader(const JSONSchema<T, N> &schema, T &obj) :
+        schema_(schema),
+        obj_(obj),
+        depth_(0),
+        unknown_(0),
+        invalid_(0),
+        field_(-1),
+        partial_(false),
+        skip_(false),
+        longName_(false) {
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::parse(const char *json, size_t size) {
+    spark::JSONStreamParser parser(*this, buf_, sizeof(buf_));
+    return parser.write((const uint8_t*)json, size) == size && parser.end();
+}
+
+template<typename T, size_t N>
+inline unsigned JSONSchemaReader<T, N>::unknownKeys() const {
+    return unknown_;
+}
+
+template<typename T, size_t N>
+inline unsigned JSONSchemaReader<T, N>::invalidValues() const {
+    return invalid_;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::beginArray() {
+    if (depth_ == 0) {
+        return false; // Not an object
+    }
+    if (depth_++ == 1) {
+        store(spark::JSON_TYPE_ARRAY, "", 0);
+    }
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::endArray() {
+    --depth_;
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::beginObject() {
+    if (depth_++ == 1) {
+        store(spark::JSON_TYPE_OBJECT, "", 0);
+    }
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::endObject() {
+    --depth_;
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::name(const char *name, size_t size) {
+    if (depth_ == 1) {
+        field_ = longName_ ? -1 : schema_.find(name, size);
+        if (field_ < 0) {
+            ++unknown_;
+        }
+    }
+    longName_ = false;
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::value(spark::JSONType type, const char *val, size_t size) {
+    if (depth_ == 0) {
+        return false; // Not an object
+    }
+    if (depth_ == 1) {
+        if (partial_ && !schema_.append(obj_, field_, val, size)) {
+            return false; // Out of memory
+        }
+        if (!partial_ && !skip_) {
+            store(type, val, size);
+        }
+        partial_ = false;
+        skip_ = false;
+    }
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::valuePart(const char *data, size_t size) {
+    if (depth_ == 1 && field_ >= 0) {
+        if (partial_) {
+            return schema_.append(obj_, field_, data, size); // False if out of memory
+        } else if (!skip_ && schema_.field(field_).type == JSONField<T>::STRING) {
+            skip_ = !accept(field_, spark::JSON_TYPE_STRING, data, size);
+            partial_ = !skip_ && schema_.assign(obj_, field_, spark::JSON_TYPE_STRING, data, size);
+        } else if (!skip_) {
+            // Only strings are stored in parts. Other fields get the value, or find it invalid,
+            // by its first part, and the remaining parts are skipped
+            store(spark::JSON_TYPE_STRING, data, size);
+            skip_ = true;
+        }
+    }
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::namePart(const char*, size_t) {
+    longName_ = true; // Not in the schema
+    return true;
+}
+
+template<typename T, size_t N>
+inline bool JSONSchemaReader<T, N>::accept(int, spark::JSONType, const char*, size_t) {
+    return true;
+}
+
+template<typename T, size_t N>
+inline void JSONSchemaReader<T, N>::store(spark::JSONType type, const char *val, size_t size) {
+    if (field_ >= 0 && accept(field_, type, val, size) && !schema_.assign(obj_, field_, type, val, size)) {
+        ++invalid_;
+    }
+}
@@ -0,0 +1,160 @@
+/*
+ * Compile-time perfect hashing of a fixed set of string keys.
+ *
+ * The table is built by the compiler: it searches for a seed that maps every key
+ * to a distinct slot, so a lookup takes one hash, one slot read and one compare.
+ *
+ *   static constexpr const char* const COLORS[] = { "red", "green", "blue" };
+ *   static constexpr auto COLOR_KEYS = makePerfectHash(COLORS);
+ *   static_assert(COLOR_KEYS.isValid(), "no perfect hash seed found");
+ *
+ *   int i = COLOR_KEYS.find(str, len); // Index in COLORS, or -1 if not found
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+template<size_t N>
+class PerfectHash {
+public:
+    static_assert(N > 0 && N <= 127, "Unsupported number of keys");
+
+    // Number of slots, a power of two at least twice the number of keys
+    static constexpr size_t SIZE = (N <= 2) ? 4 : (N <= 4) ? 8 : (N <= 8) ? 16 : (N <= 16) ? 32 :
+            (N <= 32) ? 64 : (N <= 64) ? 128 : 256;
+
+    static constexpr uint32_t MAX_SEED = 100000;
+
+    constexpr explicit PerfectHash(const char* const (&keys)[N]) :
+            keys_(),
+            lens_(),
+            slots_(),
+            seed_(MAX_SEED) {
+        for (size_t i = 0; i < N; ++i) {
+            keys_[i] = keys[i];
+            lens_[i] = length(keys[i]);
+        }
+        build();
+    }
+
+    // Builds the table for the name member of each item, e.g. a field descriptor
+    template<typename ItemT>
+    constexpr PerfectHash(const ItemT (&items)[N], const char* const ItemT::*name) :
+            keys_(),
+            lens_(),
+            slots_(),
+            seed_(MAX_SEED) {
+        for (size_t i = 0; i < N; ++i) {
+            keys_[i] = items[i].*name;
+            lens_[i] = length(keys_[i]);
+        }
+        build();
+    }
+
+    // Returns the index of the key, or -1 if it's not in the set
+    int find(const char *key, size_t len) const {
+        const int i = slots_[hash(key, len, seed_) & (SIZE - 1)];
+        if (i < 0 || lens_[i] != len || memcmp(keys_[i], key, len) != 0) {
+            return -1;
+        }
+        return i;
+    }
+
+    int find(const char *key) const {
+        return find(key, strlen(key));
+    }
+
+    // Returns false if the keys contain duplicates or no seed has been found
+    constexpr bool isValid() const {
+        return seed_ < MAX_SEED;
+    }
+
+    constexpr uint32_t seed() const {
+        return seed_;
+    }
+
+    constexpr size_t size() const {
+        return N;
+    }
+
+    // FNV-1a with a seeded offset basis
+    static constexpr uint32_t hash(const char *key, size_t len, uint32_t seed) {
+        uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (size_t i = 0; i < len; ++i) {
+            h = (h ^ (uint8_t)key[i]) * 16777619u;
+        }
+        return h ^ (h >> 16);
+    }
+
+private:
+    const char *keys_[N];
+    size_t lens_[N];
+    int8_t slots_[SIZE];
+    uint32_t seed_;
+
+    static constexpr size_t length(const char *s) {
+        size_t n = 0;
+        while (s[n]) {
+            ++n;
+        }
+        return n;
+    }
+
+    constexpr void build() {
+        if (hasDuplicates()) {
+            return;
+        }
+        for (uint32_t seed = 0; seed < MAX_SEED; ++seed) {
+            if (tryFill(seed)) {
+                seed_ = seed;
+                break;
+            }
+        }
+    }
+
+    constexpr bool hasDuplicates() const {
+        for (size_t i = 0; i < N; ++i) {
+            for (size_t j = i + 1; j < N; ++j) {
+                if (lens_[i] != lens_[j]) {
+                    continue;
+                }
+                size_t k = 0;
+                while (k < lens_[i] && keys_[i][k] == keys_[j][k]) {
+                    ++k;
+                }
+                if (k == lens_[i]) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    constexpr bool tryFill(uint32_t seed) {
+        for (size_t i = 0; i < SIZE; ++i) {
+            slots_[i] = -1;
+        }
+        for (size_t i = 0; i < N; ++i) {
+            const size_t slot = hash(keys_[i], lens_[i], seed) & (SIZE - 1);
+            if (slots_[slot] >= 0) {
+                return false;
+            }
+            slots_[slot] = (int8_t)i;
+        }
+        return true;
+    }
+};
+
+template<size_t N>
+constexpr size_t PerfectHash<N>::SIZE;
+
+template<size_t N>
+constexpr uint32_t PerfectHash<N>::MAX_SEED;
+
+template<size_t N>
+constexpr PerfectHash<N> makePerfectHash(const char* const (&keys)[N]) {
+    return PerfectHash<N>(keys);
+}
@@ -123,25 +123,13 @@ String::String(double value, unsigned char decimalPlaces)
   *this = dtostrf(value, (decimalPlaces + 2), decimalPlaces, buf);
 }
 
-String::~String()
-{
-  free(buffer);
-}
-
 /*********************************************/
 /*  Memory Management                        */
 /*********************************************/
 
-inline void String::init(void)
-{
-  buffer = NULL;
-  capacity = 0;
-  len = 0;
-}
-
 void String::invalidate(void)
 {
-  if (buffer) {
+  if (buffer && !isSSO()) {
     free(buffer);
   }
   buffer = NULL;
@@ -162,10 +150,53 @@ unsigned char String::reserve(unsigned int size)
   return 0;
 }
 
+unsigned char String::grow(unsigned int size)
+{
+  if (buffer && capacity >= size) {
+    return 1;
+  }
+  // grow geometrically, so that appending takes amortized constant time.
+  // if there's not enough memory for that, try the exact size
+  const unsigned int geometric = capacity + capacity / 2;
+  if (buffer && geometric > size && changeBuffer(geometric)) {
+    return 1;
+  }
+  return reserve(size);
+}
+
+unsigned char String::shrink_to_fit(void)
+{
+  if (!buffer || isSSO() || capacity == len) {
+    return 1;
+  }
+  if (len <= SSO_CAPACITY) {
+    memcpy(sso, buffer, len + 1);
+    free(buffer);
+    buffer = sso;
+    capacity = SSO_CAPACITY;
+    return 1;
+  }
+  char *newbuffer = (char *)realloc(buffer, len + 1);
+  if (!newbuffer) {
+    return 0;
+  }
+  buffer = newbuffer;
+  capacity = len;
+  return 1;
+}
+
 unsigned char String::changeBuffer(unsigned int maxStrLen)
 {
-  char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+  if (!buffer && maxStrLen <= SSO_CAPACITY) {
+    buffer = sso;
+    capacity = SSO_CAPACITY;
+    return 1;
+  }
+  char *newbuffer = (char *)realloc(isSSO() ? NULL : buffer, maxStrLen + 1);
   if (newbuffer) {
+    if (isSSO()) {
+      memcpy(newbuffer, sso, len + 1);
+    }
     buffer = newbuffer;
     capacity = maxStrLen;
     return 1;
@@ -208,12 +239,19 @@ void String::move(String &rhs)
       len = rhs.len;
       rhs.len = 0;
       return;
-    } else {
+    } else if (!isSSO()) {
       free(buffer);
     }
   }
-  buffer = rhs.buffer;
-  capacity = rhs.capacity;
+  if (rhs.isSSO()) {
+    // short strings can't be taken over, but fit into the array of this one
+    memcpy(sso, rhs.sso, rhs.len + 1);
+    buffer = sso;
+    capacity = SSO_CAPACITY;
+  } else {
+    buffer = rhs.buffer;
+    capacity = rhs.capacity;
+  }
   len = rhs.len;
   rhs.buffer = NULL;
   rhs.capacity = 0;
@@ -294,10 +332,11 @@ unsigned char String::concat(const char *cstr, unsigned int length)
   if (length == 0) {
     return 1;
   }
-  if (!reserve(newlen)) {
+  if (!grow(newlen)) {
     return 0;
   }
-  strcpy(buffer + len, cstr);
+  memcpy(buffer + len, cstr, length);
+  buffer[newlen] = 0;
   len = newlen;
   return 1;
 }
@@ -377,7 +416,7 @@ unsigned char String::concat(const __FlashStringHelper *str)
     return 1;
   }
   unsigned int newlen = len + length;
-  if (!reserve(newlen)) {
+  if (!grow(newlen)) {
     return 0;
   }
   strcpy_P(buffer + len, (const char *) str);
@@ -389,103 +428,51 @@ unsigned char String::concat(const __FlashStringHelper *str)
 /*  Concatenate                              */
 /*********************************************/
 
-StringSumHelper &operator + (const StringSumHelper &lhs, const String &rhs)
-{
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(rhs.buffer, rhs.len)) {
-    a.invalidate();
-  }
-  return a;
-}
-
-StringSumHelper &operator + (const StringSumHelper &lhs, const char *cstr)
+StringSumNumber::StringSumNumber(char c)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!cstr || !a.concat(cstr, strlen(cstr))) {
-    a.invalidate();
-  }
-  return a;
-}
-
-StringSumHelper &operator + (const StringSumHelper &lhs, char c)
-{
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(c)) {
-    a.invalidate();
-  }
-  return a;
-}
-
-StringSumHelper &operator + (const StringSumHelper &lhs, unsigned char num)
-{
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  buf[0] = c;
+  buf[1] = 0;
+  len = 1;
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, int num)
+StringSumNumber::StringSumNumber(unsigned char num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  itoa(num, buf, 10);
+  len = strlen(buf);
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, unsigned int num)
+StringSumNumber::StringSumNumber(int num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  itoa(num, buf, 10);
+  len = strlen(buf);
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, long num)
+StringSumNumber::StringSumNumber(unsigned int num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  utoa(num, buf, 10);
+  len = strlen(buf);
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, unsigned long num)
+StringSumNumber::StringSumNumber(long num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  ltoa(num, buf, 10);
+  len = strlen(buf);
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, float num)
+StringSumNumber::StringSumNumber(unsigned long num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  ultoa(num, buf, 10);
+  len = strlen(buf);
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, double num)
+StringSumNumber::StringSumNumber(float num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(num)) {
-    a.invalidate();
-  }
-  return a;
+  len = strlen(dtostrf(num, 4, 2, buf));
 }
 
-StringSumHelper &operator + (const StringSumHelper &lhs, const __FlashStringHelper *rhs)
+StringSumNumber::StringSumNumber(double num)
 {
-  StringSumHelper &a = const_cast<StringSumHelper &>(lhs);
-  if (!a.concat(rhs)) {
-    a.invalidate();
-  }
-  return a;
+  len = strlen(dtostrf(num, 4, 2, buf));
 }
 
 /*********************************************/
@@ -522,24 +509,24 @@ unsigned char String::equals(const char *cstr) const
   return strcmp(buffer, cstr) == 0;
 }
 
-unsigned char String::operator<(const String &rhs) const
+unsigned char operator<(const String &lhs, const String &rhs)
 {
-  return compareTo(rhs) < 0;
+  return lhs.compareTo(rhs) < 0;
 }
 
-unsigned char String::operator>(const String &rhs) const
+unsigned char operator>(const String &lhs, const String &rhs)
 {
-  return compareTo(rhs) > 0;
+  return lhs.compareTo(rhs) > 0;
 }
 
-unsigned char String::operator<=(const String &rhs) const
+unsigned char operator<=(const String &lhs, const String &rhs)
 {
-  return compareTo(rhs) <= 0;
+  return lhs.compareTo(rhs) <= 0;
 }
 
-unsigned char String::operator>=(const String &rhs) const
+unsigned char operator>=(const String &lhs, const String &rhs)
 {
-  return compareTo(rhs) >= 0;
+  return lhs.compareTo(rhs) >= 0;
 }
 
 unsigned char String::equalsIgnoreCase(const String &s2) const
@@ -793,7 +780,7 @@ void String::replace(const String &find, const String &replace)
     if (size == len) {
       return;
     }
-    if (size > capacity && !changeBuffer(size)) {
+    if (size > capacity && !grow(size)) {
       return;  // XXX: tell user!
     }
     int index = len - 1;
@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <type_traits>
+#include <utility>
 #include <avr/pgmspace.h>
 
 // When compiling programs with this class, the following gcc parameters
@@ -41,6 +43,9 @@ class __FlashStringHelper;
 // result objects are assumed to be writable by subsequent concatenations.
 class StringSumHelper;
 
+// A concatenation that is yet to be evaluated, see operator + below
+template <typename L, typename R> class StringSum;
+
 // The string class
 class String {
     // use a function pointer to allow for "if (s)" without the
@@ -50,12 +55,25 @@ class String {
     void StringIfHelper() const {}
 
   public:
+    // strings of up to SSO_CAPACITY characters are stored in the object
+    // itself, without allocating memory on the heap. that covers names,
+    // statuses, MAC and IP addresses, auth tokens and most SSIDs
+    static const unsigned int SSO_CAPACITY = 35;
+
     // constructors
     // creates a copy of the initial value.
     // if the initial value is null or invalid, or if memory allocation
     // fails, the string will be marked as invalid (i.e. "if (s)" will
     // be false).
-    String(const char *cstr = "");
+    // an empty string is set up in place, without copying ""
+    String(void)
+    {
+      buffer = sso;
+      capacity = SSO_CAPACITY;
+      len = 0;
+      sso[0] = 0;
+    }
+    String(const char *cstr);
 
     // Construct from a char buffer with explicit length
     String(const char* cstr, size_t length)
@@ -74,6 +92,8 @@ class String {
     String(String &&rval);
     String(StringSumHelper &&rval);
 #endif
+    template <typename L, typename R>
+    String(const StringSum<L, R> &sum);
     explicit String(char c);
     explicit String(unsigned char, unsigned char base = 10);
     explicit String(int, unsigned char base = 10);
@@ -82,13 +102,23 @@ class String {
     explicit String(unsigned long, unsigned char base = 10);
     explicit String(float, unsigned char decimalPlaces = 2);
     explicit String(double, unsigned char decimalPlaces = 2);
-    ~String(void);
+    ~String(void)
+    {
+      if (!isSSO()) {
+        free(buffer);
+      }
+    }
 
     // memory management
     // return true on success, false on failure (in which case, the string
     // is left unchanged).  reserve(0), if successful, will validate an
     // invalid string (i.e., "if (s)" will be true afterwards)
     unsigned char reserve(unsigned int size);
+    // concatenation grows the buffer by at least half of its capacity, so
+    // that strings built piece by piece aren't reallocated on every step.
+    // shrink_to_fit() releases the unused part, moving short strings back
+    // into the object.  returns true on success
+    unsigned char shrink_to_fit(void);
     inline unsigned int length(void) const
     {
       return len;
@@ -112,6 +142,9 @@ class String {
     // concatenation is considered unsuccessful.
     unsigned char concat(const String &str);
     unsigned char concat(const char *cstr);
+    // appends the given number of characters, which don't need to be
+    // null-terminated
+    unsigned char concat(const char *cstr, unsigned int length);
     unsigned char concat(char c);
     unsigned char concat(unsigned char c);
     unsigned char concat(int num);
@@ -180,18 +213,6 @@ class String {
       return (*this);
     }
 
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, const String &rhs);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, const char *cstr);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, char c);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, unsigned char num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, int num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, unsigned int num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, long num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, unsigned long num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, float num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, double num);
-    friend StringSumHelper &operator + (const StringSumHelper &lhs, const __FlashStringHelper *rhs);
-
     // comparison (only works w/ Strings and "strings")
     operator StringIfHelperType() const
     {
@@ -200,26 +221,6 @@ class String {
     int compareTo(const String &s) const;
     unsigned char equals(const String &s) const;
     unsigned char equals(const char *cstr) const;
-    unsigned char operator == (const String &rhs) const
-    {
-      return equals(rhs);
-    }
-    unsigned char operator == (const char *cstr) const
-    {
-      return equals(cstr);
-    }
-    unsigned char operator != (const String &rhs) const
-    {
-      return !equals(rhs);
-    }
-    unsigned char operator != (const char *cstr) const
-    {
-      return !equals(cstr);
-    }
-    unsigned char operator < (const String &rhs) const;
-    unsigned char operator > (const String &rhs) const;
-    unsigned char operator <= (const String &rhs) const;
-    unsigned char operator >= (const String &rhs) const;
     unsigned char equalsIgnoreCase(const String &s) const;
     unsigned char startsWith(const String &prefix) const;
     unsigned char startsWith(const String &prefix, unsigned int offset) const;
@@ -289,11 +290,21 @@ class String {
     char *buffer;         // the actual char array
     unsigned int capacity;  // the array length minus one (for the '\0')
     unsigned int len;       // the String length (not counting the '\0')
+    char sso[SSO_CAPACITY + 1]; // the array used for short strings
   protected:
-    void init(void);
+    void init(void)
+    {
+      buffer = NULL;
+      capacity = 0;
+      len = 0;
+    }
+    bool isSSO(void) const
+    {
+      return buffer == sso;
+    }
     void invalidate(void);
     unsigned char changeBuffer(unsigned int maxStrLen);
-    unsigned char concat(const char *cstr, unsigned int length);
+    unsigned char grow(unsigned int size);
 
     // copy and move
     String &copy(const char *cstr, unsigned int length);
@@ -303,6 +314,29 @@ class String {
 #endif
 };
 
+// the comparison operators are not members, so that either operand can be
+// converted to a String, e.g. the result of operator +
+inline unsigned char operator == (const String &lhs, const String &rhs)
+{
+  return lhs.equals(rhs);
+}
+inline unsigned char operator == (const String &lhs, const char *cstr)
+{
+  return lhs.equals(cstr);
+}
+inline unsigned char operator != (const String &lhs, const String &rhs)
+{
+  return !lhs.equals(rhs);
+}
+inline unsigned char operator != (const String &lhs, const char *cstr)
+{
+  return !lhs.equals(cstr);
+}
+unsigned char operator < (const String &lhs, const String &rhs);
+unsigned char operator > (const String &lhs, const String &rhs);
+unsigned char operator <= (const String &lhs, const String &rhs);
+unsigned char operator >= (const String &lhs, const String &rhs);
+
 class StringSumHelper : public String {
   public:
     StringSumHelper(const String &s) : String(s) {}
@@ -317,5 +351,236 @@ class StringSumHelper : public String {
     StringSumHelper(double num) : String(num) {}
 };
 
+// Operands of a concatenation.  strings are referenced, numbers are
+// formatted the same way concat() does it
+class StringSumText {
+  public:
+    StringSumText(const char *cstr, unsigned int length) : data(cstr), len(length) {}
+    unsigned int length(void) const
+    {
+      return len;
+    }
+    bool valid(void) const
+    {
+      return data != NULL;
+    }
+    char *write(char *p) const
+    {
+      memcpy(p, data, len);
+      return p + len;
+    }
+
+  private:
+    const char *data;
+    unsigned int len;
+};
+
+class StringSumNumber {
+  public:
+    explicit StringSumNumber(char c);
+    explicit StringSumNumber(unsigned char num);
+    explicit StringSumNumber(int num);
+    explicit StringSumNumber(unsigned int num);
+    explicit StringSumNumber(long num);
+    explicit StringSumNumber(unsigned long num);
+    explicit StringSumNumber(float num);
+    explicit StringSumNumber(double num);
+    unsigned int length(void) const
+    {
+      return len;
+    }
+    bool valid(void) const
+    {
+      return true;
+    }
+    char *write(char *p) const
+    {
+      memcpy(p, buf, len);
+      return p + len;
+    }
+
+  private:
+    char buf[33];
+    unsigned int len;
+};
+
+inline StringSumText stringSumOperand(const String &str)
+{
+  return StringSumText(str.c_str(), str.length());
+}
+inline StringSumText stringSumOperand(const char *cstr)
+{
+  return StringSumText(cstr, cstr ? strlen(cstr) : 0);
+}
+inline StringSumText stringSumOperand(const __FlashStringHelper *str)
+{
+  return StringSumText((PGM_P)str, str ? strlen_P((PGM_P)str) : 0);
+}
+inline StringSumNumber stringSumOperand(char c)
+{
+  return StringSumNumber(c);
+}
+inline StringSumNumber stringSumOperand(unsigned char num)
+{
+  return StringSumNumber(num);
+}
+inline StringSumNumber stringSumOperand(int num)
+{
+  return StringSumNumber(num);
+}
+inline StringSumNumber stringSumOperand(unsigned int num)
+{
+  return StringSumNumber(num);
+}
+inline StringSumNumber stringSumOperand(long num)
+{
+  return StringSumNumber(num);
+}
+inline StringSumNumber stringSumOperand(unsigned long num)
+{
+  return StringSumNumber(num);
+}
+inline StringSumNumber stringSumOperand(float num)
+{
+  return StringSumNumber(num);
+}
+inline StringSumNumber stringSumOperand(double num)
+{
+  return StringSumNumber(num);
+}
+template <typename L, typename R>
+inline const StringSum<L, R> &stringSumOperand(const StringSum<L, R> &sum)
+{
+  return sum;
+}
+
+// Operand type for a value
+template <typename T>
+using StringSumOperandType = typename std::decay<decltype(stringSumOperand(std::declval<const T &>()))>::type;
+
+// Operands are stored by value, except for nested concatenations, which
+// are referenced
+template <typename T>
+struct StringSumStorage {
+  typedef const T type;
+};
+template <typename L, typename R>
+struct StringSumStorage<StringSum<L, R> > {
+  typedef const StringSum<L, R> &type;
+};
+
+template <typename T>
+struct IsStringSum : std::false_type {};
+template <typename L, typename R>
+struct IsStringSum<StringSum<L, R> > : std::true_type {};
+
+// The result of operator +.  concatenations only record their operands,
+// and the whole chain is written into a String with a single allocation
+// when it's converted to one.  the operands are referenced, so the result
+// must be converted before the end of the expression rather than stored,
+// e.g. in an auto variable
+template <typename L, typename R>
+class StringSum {
+  public:
+    StringSum(const L &lhs, const R &rhs) : lhs(lhs), rhs(rhs), value(NULL) {}
+    StringSum(const StringSum &sum) : lhs(sum.lhs), rhs(sum.rhs), value(NULL) {}
+    ~StringSum(void)
+    {
+      free(value);
+    }
+    StringSum &operator = (const StringSum &) = delete;
+    unsigned int length(void) const
+    {
+      return lhs.length() + rhs.length();
+    }
+    bool valid(void) const
+    {
+      return lhs.valid() && rhs.valid();
+    }
+    char *write(char *p) const
+    {
+      return rhs.write(lhs.write(p));
+    }
+    // the result is kept until the end of the expression
+    const char *c_str(void) const
+    {
+      if (!value && valid()) {
+        value = (char *)malloc(length() + 1);
+        if (value) {
+          *write(value) = 0;
+        }
+      }
+      return value;
+    }
+    // true unless one of the operands is an invalid String, like "if (s)"
+    explicit operator bool(void) const
+    {
+      return valid();
+    }
+
+    // the String methods that don't modify the string are evaluated on a
+    // temporary String, e.g. (a + b).indexOf(c).  comparisons are done by
+    // the String operators, which convert the sum implicitly
+    int compareTo(const String &s) const { return String(*this).compareTo(s); }
+    unsigned char equals(const String &s) const { return String(*this).equals(s); }
+    unsigned char equals(const char *cstr) const { return String(*this).equals(cstr); }
+    unsigned char equalsIgnoreCase(const String &s) const { return String(*this).equalsIgnoreCase(s); }
+    unsigned char startsWith(const String &prefix) const { return String(*this).startsWith(prefix); }
+    unsigned char startsWith(const String &prefix, unsigned int offset) const { return String(*this).startsWith(prefix, offset); }
+    unsigned char endsWith(const String &suffix) const { return String(*this).endsWith(suffix); }
+    char charAt(unsigned int index) const { return String(*this).charAt(index); }
+    char operator [](unsigned int index) const { return String(*this)[index]; }
+    void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const { String(*this).getBytes(buf, bufsize, index); }
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const { String(*this).toCharArray(buf, bufsize, index); }
+    int indexOf(char ch) const { return String(*this).indexOf(ch); }
+    int indexOf(char ch, unsigned int fromIndex) const { return String(*this).indexOf(ch, fromIndex); }
+    int indexOf(const String &str) const { return String(*this).indexOf(str); }
+    int indexOf(const String &str, unsigned int fromIndex) const { return String(*this).indexOf(str, fromIndex); }
+    int lastIndexOf(char ch) const { return String(*this).lastIndexOf(ch); }
+    int lastIndexOf(char ch, unsigned int fromIndex) const { return String(*this).lastIndexOf(ch, fromIndex); }
+    int lastIndexOf(const String &str) const { return String(*this).lastIndexOf(str); }
+    int lastIndexOf(const String &str, unsigned int fromIndex) const { return String(*this).lastIndexOf(str, fromIndex); }
+    String substring(unsigned int beginIndex) const { return String(*this).substring(beginIndex); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const { return String(*this).substring(beginIndex, endIndex); }
+    long toInt(void) const { return String(*this).toInt(); }
+    float toFloat(void) const { return String(*this).toFloat(); }
+    double toDouble(void) const { return String(*this).toDouble(); }
+
+  private:
+    typename StringSumStorage<L>::type lhs;
+    typename StringSumStorage<R>::type rhs;
+    mutable char *value;
+};
+
+template <typename L, typename R>
+String::String(const StringSum<L, R> &sum)
+{
+  init();
+  if (!sum.valid() || !reserve(sum.length())) {
+    invalidate();
+    return;
+  }
+  len = sum.write(buffer) - buffer;
+  buffer[len] = 0;
+}
+
+template <typename T>
+inline StringSum<StringSumText, StringSumOperandType<T> > operator + (const String &lhs, const T &rhs)
+{
+  return StringSum<StringSumText, StringSumOperandType<T> >(stringSumOperand(lhs), stringSumOperand(rhs));
+}
+
+template <typename L, typename R, typename T>
+inline StringSum<StringSum<L, R>, StringSumOperandType<T> > operator + (const StringSum<L, R> &lhs, const T &rhs)
+{
+  return StringSum<StringSum<L, R>, StringSumOperandType<T> >(lhs, stringSumOperand(rhs));
+}
+
+template <typename T, typename = typename std::enable_if<!std::is_base_of<String, T>::value && !IsStringSum<T>::value>::type>
+inline StringSum<StringSumOperandType<T>, StringSumText> operator + (const T &lhs, const String &rhs)
+{
+  return StringSum<StringSumOperandType<T>, StringSumText>(stringSumOperand(lhs), stringSumOperand(rhs));
+}
+
 #endif  // __cplusplus
 #endif  // String_class_h
\ No newline at end of file
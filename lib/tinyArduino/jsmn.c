@@ -21,9 +21,87 @@ THE SOFTWARE.
 */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 
 #include "jsmn.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#ifdef JSMN_COMPACT_TOKENS
+/* Position of a token that is not known yet */
+#define JSMN_UNSET 0xffff
+#else
+#define JSMN_UNSET -1
+#endif
+
+/**
+ * Characters are tested a machine word (or an SSE2/AVX2 register) at a time,
+ * so long strings without escaped symbols are skipped in bulk. Control
+ * characters include the null character.
+ */
+size_t jsmn_scan_string(const char *js, size_t pos, size_t len) {
+#if defined(__AVX2__)
+    const __m256i quote32 = _mm256_set1_epi8('\"');
+    const __m256i bslash32 = _mm256_set1_epi8('\\');
+    const __m256i ctrl32 = _mm256_set1_epi8(0x1f);
+    while (pos + 32 <= len) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *)(js + pos));
+        const __m256i m = _mm256_or_si256(_mm256_or_si256(
+                _mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, bslash32)),
+                _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctrl32), v)); /* v <= 0x1f */
+        const unsigned mask = (unsigned)_mm256_movemask_epi8(m);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('\"');
+    const __m128i bslash = _mm_set1_epi8('\\');
+    const __m128i ctrl = _mm_set1_epi8(0x1f);
+    while (pos + 16 <= len) {
+        const __m128i v = _mm_loadu_si128((const __m128i *)(js + pos));
+        const __m128i m = _mm_or_si128(_mm_or_si128(
+                _mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, bslash)),
+                _mm_cmpeq_epi8(_mm_min_epu8(v, ctrl), v)); /* v <= 0x1f */
+        const unsigned mask = (unsigned)_mm_movemask_epi8(m);
+        if (mask != 0) {
+            return pos + __builtin_ctz(mask);
+        }
+        pos += 16;
+    }
+#else
+    /* SWAR: some byte of x is below n (n <= 0x80) if (x - n) & ~x has a high bit set */
+    typedef uintptr_t word_t;
+    const word_t ones = (word_t)-1 / 0xff;
+    const word_t highs = ones * 0x80;
+    while (pos + sizeof(word_t) <= len) {
+        word_t v, q, b;
+        memcpy(&v, js + pos, sizeof(v)); /* Unaligned load */
+        q = v ^ (ones * '\"');
+        b = v ^ (ones * '\\');
+        if ((((v - ones * 0x20) & ~v) | ((q - ones) & ~q) | ((b - ones) & ~b)) & highs) {
+            break; /* The byte loop below finds its exact position */
+        }
+        pos += sizeof(word_t);
+    }
+#endif
+    for (; pos < len; pos++) {
+        const char c = js[pos];
+        if (c == '\"' || c == '\\' || (unsigned char)c < 0x20) {
+            break;
+        }
+    }
+    return pos;
+}
+
 /**
  * Allocates a fresh unused token from the token pull.
  */
@@ -34,14 +112,28 @@ static jsmntok_t *jsmn_alloc_token(jsmn_parser *parser,
         return NULL;
     }
     tok = &tokens[parser->toknext++];
-    tok->start = tok->end = -1;
+    tok->start = tok->end = JSMN_UNSET;
     tok->size = 0;
+    tok->skip = 1;
 #ifdef JSMN_PARENT_LINKS
     tok->parent = -1;
 #endif
     return tok;
 }
 
+/**
+ * Counts a new child of the superior token.
+ */
+static int jsmn_add_child(jsmn_parser *parser, jsmntok_t *tokens) {
+#ifdef JSMN_COMPACT_TOKENS
+    if (tokens[parser->toksuper].size == JSMN_COMPACT_MAX_SIZE) {
+        return JSMN_ERROR_INVAL;
+    }
+#endif
+    tokens[parser->toksuper].size++;
+    return 0;
+}
+
 /**
  * Fills token type and boundaries.
  */
@@ -114,8 +206,15 @@ static int jsmn_parse_string(jsmn_parser *parser, const char *js,
     parser->pos++;
 
     /* Skip starting quote */
-    for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
-        char c = js[parser->pos];
+    for (; parser->pos < len; parser->pos++) {
+        char c;
+
+        /* Skip regular characters */
+        parser->pos = (unsigned int)jsmn_scan_string(js, parser->pos, len);
+        if (parser->pos == len || js[parser->pos] == '\0') {
+            break;
+        }
+        c = js[parser->pos];
 
         /* Quote: end of string */
         if (c == '\"') {
@@ -179,6 +278,12 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
     jsmntok_t *token;
     int count = 0;
 
+#ifdef JSMN_COMPACT_TOKENS
+    if (tokens != NULL && len > JSMN_COMPACT_MAX_LEN) {
+        return JSMN_ERROR_INVAL;
+    }
+#endif
+
     for (; parser->pos < len && js[parser->pos] != '\0'; parser->pos++) {
         char c;
         jsmntype_t type;
@@ -194,7 +299,8 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
                 if (token == NULL)
                     return JSMN_ERROR_NOMEM;
                 if (parser->toksuper != -1) {
-                    tokens[parser->toksuper].size++;
+                    r = jsmn_add_child(parser, tokens);
+                    if (r < 0) return r;
 #ifdef JSMN_PARENT_LINKS
                     token->parent = parser->toksuper;
 #endif
@@ -213,11 +319,12 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
                 }
                 token = &tokens[parser->toknext - 1];
                 for (;;) {
-                    if (token->start != -1 && token->end == -1) {
+                    if (token->start != JSMN_UNSET && token->end == JSMN_UNSET) {
                         if (token->type != type) {
                             return JSMN_ERROR_INVAL;
                         }
                         token->end = parser->pos + 1;
+                        token->skip = parser->toknext - (int)(token - tokens);
                         parser->toksuper = token->parent;
                         break;
                     }
@@ -229,12 +336,13 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 #else
                 for (i = parser->toknext - 1; i >= 0; i--) {
                     token = &tokens[i];
-                    if (token->start != -1 && token->end == -1) {
+                    if (token->start != JSMN_UNSET && token->end == JSMN_UNSET) {
                         if (token->type != type) {
                             return JSMN_ERROR_INVAL;
                         }
                         parser->toksuper = -1;
                         token->end = parser->pos + 1;
+                        token->skip = parser->toknext - i;
                         break;
                     }
                 }
@@ -242,7 +350,7 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
                 if (i == -1) return JSMN_ERROR_INVAL;
                 for (; i >= 0; i--) {
                     token = &tokens[i];
-                    if (token->start != -1 && token->end == -1) {
+                    if (token->start != JSMN_UNSET && token->end == JSMN_UNSET) {
                         parser->toksuper = i;
                         break;
                     }
@@ -253,8 +361,10 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
                 r = jsmn_parse_string(parser, js, len, tokens, num_tokens);
                 if (r < 0) return r;
                 count++;
-                if (parser->toksuper != -1 && tokens != NULL)
-                    tokens[parser->toksuper].size++;
+                if (parser->toksuper != -1 && tokens != NULL) {
+                    r = jsmn_add_child(parser, tokens);
+                    if (r < 0) return r;
+                }
                 break;
             case '\t' : case '\r' : case '\n' : case ' ':
                 break;
@@ -262,7 +372,7 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
                 parser->toksuper = parser->toknext - 1;
                 break;
             case ',':
-                if (tokens != NULL &&
+                if (tokens != NULL && parser->toksuper != -1 &&
                         tokens[parser->toksuper].type != JSMN_ARRAY &&
                         tokens[parser->toksuper].type != JSMN_OBJECT) {
 #ifdef JSMN_PARENT_LINKS
@@ -270,7 +380,7 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 #else
                     for (i = parser->toknext - 1; i >= 0; i--) {
                         if (tokens[i].type == JSMN_ARRAY || tokens[i].type == JSMN_OBJECT) {
-                            if (tokens[i].start != -1 && tokens[i].end == -1) {
+                            if (tokens[i].start != JSMN_UNSET && tokens[i].end == JSMN_UNSET) {
                                 parser->toksuper = i;
                                 break;
                             }
@@ -299,8 +409,10 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
                 r = jsmn_parse_primitive(parser, js, len, tokens, num_tokens);
                 if (r < 0) return r;
                 count++;
-                if (parser->toksuper != -1 && tokens != NULL)
-                    tokens[parser->toksuper].size++;
+                if (parser->toksuper != -1 && tokens != NULL) {
+                    r = jsmn_add_child(parser, tokens);
+                    if (r < 0) return r;
+                }
                 break;
 
 #ifdef JSMN_STRICT
@@ -313,7 +425,7 @@ int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
 
     for (i = parser->toknext - 1; i >= 0; i--) {
         /* Unmatched opened object or array */
-        if (tokens[i].start != -1 && tokens[i].end == -1) {
+        if (tokens[i].start != JSMN_UNSET && tokens[i].end == JSMN_UNSET) {
             return JSMN_ERROR_PART;
         }
     }
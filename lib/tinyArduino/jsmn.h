@@ -56,16 +56,42 @@ typedef enum {
  * @param       type    type (object, array, string etc.)
  * @param       start   start position in JSON data string
  * @param       end     end position in JSON data string
+ * @param       size    number of child tokens (properties of an object)
+ * @param       skip    number of tokens taken by the value, including all its
+ *                      descendants; the next sibling is at this token + skip
+ *
+ * With JSMN_COMPACT_TOKENS defined, a token takes 8 bytes instead of 20: all
+ * fields are 16 bits wide and the type is packed together with the size. The
+ * parsed data is then limited to JSMN_COMPACT_MAX_LEN bytes and containers to
+ * JSMN_COMPACT_MAX_SIZE children, longer input fails with JSMN_ERROR_INVAL.
  */
+#ifdef JSMN_COMPACT_TOKENS
+#ifdef JSMN_PARENT_LINKS
+#error "JSMN_PARENT_LINKS is not supported with JSMN_COMPACT_TOKENS"
+#endif
+
+#define JSMN_COMPACT_MAX_LEN 0xfffe
+#define JSMN_COMPACT_MAX_SIZE 0x3fff
+
+typedef struct {
+    unsigned short start;
+    unsigned short end;
+    unsigned short skip;
+    unsigned short size : 14;
+    unsigned short type : 2;
+} jsmntok_t;
+#else
 typedef struct {
     jsmntype_t type;
     int start;
     int end;
     int size;
+    int skip;
 #ifdef JSMN_PARENT_LINKS
     int parent;
 #endif
 } jsmntok_t;
+#endif
 
 /**
  * JSON parser. Contains an array of token blocks available. Also stores
@@ -90,6 +116,12 @@ void jsmn_init(jsmn_parser *parser, void* reserved);
 int jsmn_parse(jsmn_parser *parser, const char *js, size_t len,
         jsmntok_t *tokens, unsigned int num_tokens, void* reserved);
 
+/**
+ * Returns position of the first quote, backslash or control character in the range
+ * [pos, len) of a JSON string, or len if there is none
+ */
+size_t jsmn_scan_string(const char *js, size_t pos, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -7,6 +7,10 @@
 using JSONValue         = spark::JSONValue;
 using JSONString        = spark::JSONString;
 using JSONObjectIterator= spark::JSONObjectIterator;
+using JSONStreamHandler = spark::JSONStreamHandler;
+using JSONStreamParser  = spark::JSONStreamParser;
+template <size_t N>
+using StaticJSONDocument= spark::StaticJSONDocument<N>;
 
 // If your code uses these symbols, alias them too.
 // (Adjust if your wiring_json uses a different enum/type name.)
@@ -0,0 +1,219 @@
+/*
+ * Fuzz target for the JSON parsers of tinyArduino.
+ *
+ * Every input goes through JSONValue::parse(), parseCopy(), StaticJSONDocument and
+ * JSONStreamParser. The parsers are checked against each other, and the fast number
+ * conversions against the strto*() functions.
+ *
+ * libFuzzer (from this directory):
+ *   clang -g -O1 -fsanitize=fuzzer-no-link,address,undefined -I../include -I../.. -c \
+ *       ../../jsmn.c ../../itoa.c ../../avr/dtostrf.c
+ *   clang++ -std=gnu++17 -g -O1 -fsanitize=fuzzer,address,undefined -fpermissive -I../include -I../.. \
+ *       fuzz_json.cpp ../../wiring_json.cpp ../../JSONNumber.cpp ../../WString.cpp ../../print.cpp \
+ *       jsmn.o itoa.o dtostrf.o -o fuzz_json
+ *   ./fuzz_json -dict=json.dict corpus
+ *
+ * AFL++, or replaying a corpus without libFuzzer: build the same sources with fuzz_main.cpp and
+ * without -fsanitize=fuzzer, then run e.g.
+ *   afl-fuzz -i corpus -o findings -x json.dict -- ./fuzz_json @@
+ */
+
+#include "wiring_json.h"
+#include "JSONNumber.h"
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+namespace {
+
+// Deeper values are not walked, to keep the recursion bounded
+const int MAX_WALK_DEPTH = 64;
+
+void check(bool cond, const char *msg) {
+    if (!cond) {
+        fprintf(stderr, "Check failed: %s\n", msg);
+        abort();
+    }
+}
+
+bool isSameDouble(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+void checkNumber(const char *s, size_t size) {
+    double d = 0;
+    if (detail::parseDouble(s, s + size, &d)) {
+        check(isSameDouble(d, strtod(s, nullptr)), "parseDouble() doesn't match strtod()");
+    }
+    long long i = 0;
+    if (detail::parseInt64(s, s + size, &i)) {
+        check(i == strtoll(s, nullptr, 10), "parseInt64() doesn't match strtoll()");
+    }
+    unsigned long long u = 0;
+    if (detail::parseUInt64(s, s + size, &u)) {
+        check(u == strtoull(s, nullptr, 10), "parseUInt64() doesn't match strtoull()");
+    }
+}
+
+// Checks that get() finds the first property with the given name
+void checkGet(const JSONValue &obj, const JSONString &name) {
+    JSONObjectIterator it(obj);
+    while (it.next() && it.name() != name) {
+    }
+    const JSONValue v = obj.get(name.data(), name.size());
+    check(v.type() == it.value().type() && v.toString() == it.value().toString(), "get() result differs");
+}
+
+// Compares two parsed values, and exercises the accessors of the first one. Property lookup is
+// only checked in strictly valid documents, since the tokenizer is lenient about malformed ones
+bool isSameValue(const JSONValue &a, const JSONValue &b, bool valid, int depth = 0) {
+    if (a.type() != b.type()) {
+        return false;
+    }
+    if (depth > MAX_WALK_DEPTH) {
+        return true;
+    }
+    if (a.isArray()) {
+        JSONArrayIterator ia(a), ib(b);
+        check(ia.count() == ib.count(), "Array sizes differ");
+        while (ia.next()) {
+            if (!ib.next() || !isSameValue(ia.value(), ib.value(), valid, depth + 1)) {
+                return false;
+            }
+        }
+        return !ib.next();
+    }
+    if (a.isObject()) {
+        JSONObjectIterator ia(a), ib(b);
+        while (ia.next()) {
+            if (!ib.next() || ia.name() != ib.name() || !isSameValue(ia.value(), ib.value(), valid, depth + 1)) {
+                return false;
+            }
+            if (valid) {
+                checkGet(a, ia.name());
+            }
+        }
+        return !ib.next();
+    }
+    const JSONString s = a.toString();
+    check(strlen(s.data()) <= s.size(), "String is not null-terminated");
+    checkNumber(s.data(), s.size());
+    a.toBool();
+    a.toInt();
+    a.toUInt();
+    a.toInt64();
+    a.toUInt64();
+    const double d = a.toDouble();
+    check(isSameDouble(d, b.toDouble()) || (std::isnan(d) && std::isnan(b.toDouble())), "Numbers differ");
+    return s == b.toString();
+}
+
+// Records parser events as text, with parts of long values joined together
+class EventRecorder: public JSONStreamHandler {
+public:
+    std::string events;
+    bool skipped = false; // A value was nested too deeply to be parsed
+
+    bool beginArray() override {
+        events += '[';
+        return true;
+    }
+
+    bool endArray() override {
+        events += ']';
+        return true;
+    }
+
+    bool beginObject() override {
+        events += '{';
+        return true;
+    }
+
+    bool endObject() override {
+        events += '}';
+        return true;
+    }
+
+    bool name(const char *name, size_t size) override {
+        check(name[size] == '\0', "Name is not null-terminated");
+        events += 'n';
+        events.append(name, size);
+        events += '\0';
+        return true;
+    }
+
+    bool value(JSONType type, const char *val, size_t size) override {
+        check(val[size] == '\0', "Value is not null-terminated");
+        events += 'v';
+        events += (char)('0' + type);
+        events += part_;
+        events.append(val, size);
+        events += '\0';
+        part_.clear();
+        if (type == JSON_TYPE_NUMBER) {
+            checkNumber(val, size);
+        } else if (type == JSON_TYPE_OBJECT || type == JSON_TYPE_ARRAY) {
+            skipped = true;
+        }
+        return true;
+    }
+
+    bool valuePart(const char *data, size_t size) override {
+        part_.append(data, size);
+        return true;
+    }
+
+private:
+    std::string part_;
+};
+
+// Returns true if the input is a valid JSON document. Deeply nested values are only checked
+// for balanced brackets, so documents that contain them are not known to be valid
+bool checkStreamParser(const uint8_t *data, size_t size) {
+    char buf1[16], buf2[16];
+    EventRecorder r1, r2;
+    JSONStreamParser p1(r1, buf1, sizeof(buf1));
+    JSONStreamParser p2(r2, buf2, sizeof(buf2));
+    p1.write(data, size);
+    const bool ok1 = p1.end();
+    // Same input in chunks of varying size
+    size_t pos = 0;
+    for (size_t n = 1; pos < size; n = n % 7 + 1) {
+        const size_t chunk = std::min(n, size - pos);
+        p2.write(data + pos, chunk);
+        pos += chunk;
+    }
+    const bool ok2 = p2.end();
+    check(ok1 == ok2, "Result depends on chunking");
+    check(r1.events == r2.events, "Events depend on chunking");
+    return ok1 && !r1.skipped;
+}
+
+} // namespace
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    const char* const json = (const char*)data;
+    const bool valid = checkStreamParser(data, size);
+    JSONValue copy = JSONValue::parseCopy(json, size);
+
+    // In-place parsing needs a spare character for the terminating null of a primitive root value
+    std::vector<char> buf(json, json + size);
+    buf.push_back(' ');
+    JSONValue inPlace = JSONValue::parse(buf.data(), size);
+    check(copy.isValid() == inPlace.isValid(), "parse() and parseCopy() disagree");
+    check(copy.isValid() || !valid, "Valid document is rejected");
+    if (copy.isValid()) {
+        check(isSameValue(copy, inPlace, valid), "parse() and parseCopy() results differ");
+    }
+
+    std::vector<char> buf2(json, json + size);
+    buf2.push_back(' ');
+    StaticJSONDocument<16> doc;
+    if (doc.parse(buf2.data(), size)) {
+        check(copy.isValid() && isSameValue(doc.value(), copy, valid), "StaticJSONDocument result differs");
+    }
+    return 0;
+}
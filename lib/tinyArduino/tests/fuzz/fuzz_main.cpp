@@ -0,0 +1,80 @@
+/*
+ * Runs a fuzz target without libFuzzer, e.g. under AFL or to replay a corpus. Inputs are read
+ * from the files and directories given on the command line, or from the standard input
+ */
+
+#include <dirent.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+
+bool readFile(FILE *f, std::vector<uint8_t> *data) {
+    data->clear();
+    uint8_t buf[4096];
+    size_t n = 0;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        data->insert(data->end(), buf, buf + n);
+    }
+    return !ferror(f);
+}
+
+unsigned runPath(const std::string &path) {
+    struct stat st = {};
+    if (stat(path.c_str(), &st) != 0) {
+        fprintf(stderr, "Can't open %s\n", path.c_str());
+        return 0;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        unsigned count = 0;
+        DIR *dir = opendir(path.c_str());
+        while (dir) {
+            const dirent *e = readdir(dir);
+            if (!e) {
+                closedir(dir);
+                break;
+            }
+            if (e->d_name[0] != '.') {
+                count += runPath(path + "/" + e->d_name);
+            }
+        }
+        return count;
+    }
+    FILE *f = fopen(path.c_str(), "rb");
+    std::vector<uint8_t> data;
+    const bool ok = f && readFile(f, &data);
+    if (f) {
+        fclose(f);
+    }
+    if (!ok) {
+        fprintf(stderr, "Can't read %s\n", path.c_str());
+        return 0;
+    }
+    LLVMFuzzerTestOneInput(data.data(), data.size());
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        std::vector<uint8_t> data;
+        if (!readFile(stdin, &data)) {
+            return 1;
+        }
+        LLVMFuzzerTestOneInput(data.data(), data.size());
+        return 0;
+    }
+    unsigned count = 0;
+    for (int i = 1; i < argc; ++i) {
+        count += runPath(argv[i]);
+    }
+    fprintf(stderr, "Ran %u inputs\n", count);
+    return 0;
+}
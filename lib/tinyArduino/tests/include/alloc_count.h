@@ -0,0 +1,78 @@
+/*
+ * Heap allocation counter for host tests. Replaces malloc() and realloc() of glibc, so it must be
+ * included by one file of a test program. Elsewhere ALLOC_COUNT_SUPPORTED is 0 and nothing is
+ * counted. Allocations can also be made to fail, to test out of memory handling
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+
+#define ALLOC_COUNT_SUPPORTED 1
+
+// Number of malloc(), calloc() and realloc() calls
+static unsigned long allocCount = 0;
+
+// If not negative, the number of allocations that succeed before the following ones fail
+static long allocFailAfter = -1;
+
+static inline bool allocShouldFail() {
+    if (allocFailAfter == 0) {
+        return true;
+    }
+    if (allocFailAfter > 0) {
+        --allocFailAfter;
+    }
+    return false;
+}
+
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    ++allocCount;
+    if (allocShouldFail()) {
+        return nullptr;
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    ++allocCount;
+    if (allocShouldFail()) {
+        return nullptr;
+    }
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    ++allocCount;
+    if (allocShouldFail()) {
+        return nullptr;
+    }
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+#else
+
+#define ALLOC_COUNT_SUPPORTED 0
+
+static unsigned long allocCount = 0;
+static long allocFailAfter = -1;
+
+#endif
+
+// Returns the number of allocations made by fn()
+template <typename F>
+unsigned long countAllocs(F fn) {
+    const unsigned long start = allocCount;
+    fn();
+    return allocCount - start;
+}
@@ -0,0 +1,30 @@
+/*
+ * Minimal helpers for host benchmarks
+ */
+
+#pragma once
+
+#include <chrono>
+#include <stdio.h>
+
+// Runs fn() the given number of times and returns the average time of a run in nanoseconds
+template <typename F>
+double benchNs(unsigned iterations, F fn) {
+    fn(); // Warm up
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < iterations; ++i) {
+        fn();
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+static inline void benchReport(const char* name, double before, double after) {
+    printf("%-28s %10.1f ns -> %10.1f ns  (x%.2f)\n", name, before, after, before / after);
+}
+
+// Prevents the compiler from optimizing away a computed value
+template <typename T>
+inline void benchKeep(const T& val) {
+    asm volatile("" : : "g"(&val) : "memory");
+}
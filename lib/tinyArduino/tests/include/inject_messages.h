@@ -0,0 +1,18 @@
+/*
+ * Typical Blynk.Inject provisioning messages, as sent by the Blynk app. They are also part of
+ * the seed corpus of the fuzz targets, see fuzz/corpus
+ */
+
+#pragma once
+
+static const char* const INJECT_MESSAGES[] = {
+    R"json({"t":"info"})json",
+    R"json({"t":"ifs"})json",
+    R"json({"t":"scan"})json",
+    R"json({"t":"set","if":"wifi","ssid":"Blynk Office","pass":"Sup3r$ecret\"Pa55","blynk":"Uj5kVnR0cW1hT3p1Y2ZxWkxRUFNkVgQz","host":"fra1.blynk.cloud","port":443,"save":true})json",
+    R"json({"t":"set","if":"wifi","ssid":"Home","pass":"12345678","blynk":"xOpnVQ4LvyTuCUWg2bT1Sv8QOt5eBYgc","host":"blynk.cloud","port":80,"ip":"192.168.1.50","mask":"255.255.255.0","gw":"192.168.1.1","dns":"8.8.8.8","dns2":"1.1.1.1","save":true})json",
+    R"json({"t":"connect"})json",
+    R"json({"t":"reset"})json",
+};
+
+static const size_t INJECT_MESSAGES_COUNT = sizeof(INJECT_MESSAGES) / sizeof(INJECT_MESSAGES[0]);
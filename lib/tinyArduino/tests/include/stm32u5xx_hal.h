@@ -0,0 +1,20 @@
+/*
+ * Host replacement for the STM32 HAL, so that tinyArduino can be built
+ * and tested natively.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint32_t HAL_GetTick(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static inline void HAL_Delay(uint32_t ms) {
+    const uint32_t start = HAL_GetTick();
+    while (HAL_GetTick() - start < ms) {}
+}
@@ -0,0 +1,283 @@
+#include "unity.h"
+#include "bench.h"
+#include "inject_messages.h"
+
+#include "wiring_json.h"
+
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+static size_t allocCount = 0;
+
+void* operator new(size_t size) {
+    ++allocCount;
+    if (void* p = malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    ++allocCount;
+    return malloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    free(p);
+}
+
+static const unsigned ITERATIONS = 200000;
+
+// Tokenizer used by JSONValue::parse() before it switched to a single pass
+static bool tokenizeTwoPass(const char *json, size_t size, jsmntok_t **tokens, size_t *count) {
+    jsmn_parser parser;
+    jsmn_init(&parser, nullptr);
+    const int n = jsmn_parse(&parser, json, size, nullptr, 0, nullptr);
+    if (n <= 0) {
+        return false;
+    }
+    std::unique_ptr<jsmntok_t[]> t(new jsmntok_t[n]);
+    jsmn_init(&parser, nullptr);
+    if (jsmn_parse(&parser, json, size, t.get(), n, nullptr) <= 0) {
+        return false;
+    }
+    *tokens = t.release();
+    *count = n;
+    return true;
+}
+
+// Same approach as JSONValue::tokenize(): a single pass into a stack arena, then an exact copy
+static bool tokenizeSinglePass(const char *json, size_t size, jsmntok_t **tokens, size_t *count) {
+    jsmntok_t arena[32];
+    jsmn_parser parser;
+    jsmn_init(&parser, nullptr);
+    if (jsmn_parse(&parser, json, size, arena, 32, nullptr) <= 0) {
+        return false;
+    }
+    const size_t n = parser.toknext;
+    jsmntok_t *t = new jsmntok_t[n];
+    memcpy(t, arena, n * sizeof(jsmntok_t));
+    *tokens = t;
+    *count = n;
+    return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_parse_messages() {
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        std::string msg = INJECT_MESSAGES[i];
+        JSONValue v = JSONValue::parse(&msg[0], msg.size());
+        TEST_ASSERT_TRUE(v.isObject());
+        JSONObjectIterator it(v);
+        TEST_ASSERT_TRUE(it.next());
+        TEST_ASSERT_TRUE(it.name() == "t");
+    }
+}
+
+void test_parse_large_document() {
+    // Exceeds the initial token arena, so the tokenizer has to grow it while parsing
+    std::string json = "[";
+    for (int i = 0; i < 1000; ++i) {
+        json += (i ? ",{\"n\":" : "{\"n\":") + std::to_string(i) + ",\"s\":\"v" + std::to_string(i) + "\"}";
+    }
+    json += "]";
+    JSONValue v = JSONValue::parse(&json[0], json.size());
+    TEST_ASSERT_TRUE(v.isArray());
+    JSONArrayIterator it(v);
+    TEST_ASSERT_EQUAL_INT(1000, it.count());
+    int i = 0;
+    while (it.next()) {
+        JSONObjectIterator obj(it.value());
+        TEST_ASSERT_TRUE(obj.next());
+        TEST_ASSERT_EQUAL_INT(i, obj.value().toInt());
+        TEST_ASSERT_TRUE(obj.next());
+        TEST_ASSERT_TRUE(obj.value().toString() == String("v") + i);
+        ++i;
+    }
+    TEST_ASSERT_EQUAL_INT(1000, i);
+}
+
+void test_parse_invalid() {
+    const char* const invalid[] = { "", "   ", "{\"t\":\"set\"", "{\"t\":\"set\"]", "[1,2", "\"abc" };
+    for (const char* s : invalid) {
+        std::string json = s;
+        TEST_ASSERT_FALSE(JSONValue::parse(&json[0], json.size()).isValid());
+    }
+}
+
+void test_static_document() {
+    char json[] = R"json({"t":"set","ssid":"Home\tWiFi","port":443,"save":true,"ips":[1,2,{"a":null}],"x":"\u0041"} )json";
+    const size_t allocs = allocCount;
+    StaticJSONDocument<24> doc;
+    TEST_ASSERT_TRUE(doc.parse(json, strlen(json)));
+    JSONObjectIterator it(doc.value());
+    TEST_ASSERT_EQUAL_INT(6, it.count());
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_TRUE(it.name() == "t");
+    TEST_ASSERT_TRUE(it.value().toString() == "set");
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_TRUE(it.value().toString() == "Home\tWiFi");
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_EQUAL_INT(443, it.value().toInt());
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_TRUE(it.value().toBool());
+    TEST_ASSERT_TRUE(it.next());
+    JSONArrayIterator arr(it.value());
+    TEST_ASSERT_EQUAL_INT(3, arr.count());
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_TRUE(it.name() == "x");
+    TEST_ASSERT_TRUE(it.value().toString() == "A");
+    TEST_ASSERT_FALSE(it.next());
+    TEST_ASSERT_EQUAL_INT(allocs, allocCount);
+
+    // Not enough tokens
+    char json2[] = R"json({"a":1,"b":2})json";
+    StaticJSONDocument<4> small;
+    TEST_ASSERT_FALSE(small.parse(json2, strlen(json2)));
+    TEST_ASSERT_FALSE(small.value().isValid());
+
+    // No room for the terminating null character
+    char json3[] = "42 ";
+    StaticJSONDocument<4> prim;
+    TEST_ASSERT_FALSE(prim.parse(json3, 2));
+    TEST_ASSERT_TRUE(prim.parse(json3, 3));
+    TEST_ASSERT_EQUAL_INT(42, prim.value().toInt());
+}
+
+void bench_static_document() {
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const char* const msg = INJECT_MESSAGES[i];
+        const size_t size = strlen(msg);
+        std::vector<char> buf(size);
+        size_t allocs = allocCount;
+        const double before = benchNs(ITERATIONS, [&]() {
+            memcpy(buf.data(), msg, size);
+            JSONValue v = JSONValue::parse(buf.data(), size);
+            JSONObjectIterator it(v);
+            while (it.next()) {
+                benchKeep(it.name());
+                benchKeep(it.value());
+            }
+        });
+        const double allocsBefore = double(allocCount - allocs) / (ITERATIONS + 1);
+        allocs = allocCount;
+        const double after = benchNs(ITERATIONS, [&]() {
+            memcpy(buf.data(), msg, size);
+            StaticJSONDocument<32> doc;
+            doc.parse(buf.data(), size);
+            JSONObjectIterator it(doc.value());
+            while (it.next()) {
+                benchKeep(it.name());
+                benchKeep(it.value());
+            }
+        });
+        const double allocsAfter = double(allocCount - allocs) / (ITERATIONS + 1);
+        char name[32];
+        snprintf(name, sizeof(name), "static doc #%u (%uB)", (unsigned)i, (unsigned)size);
+        benchReport(name, before, after);
+        printf("%-28s %10.1f    -> %10.1f allocs\n", "", allocsBefore, allocsAfter);
+    }
+}
+
+void bench_tokenize() {
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const char* const msg = INJECT_MESSAGES[i];
+        const size_t size = strlen(msg);
+        const double before = benchNs(ITERATIONS, [&]() {
+            jsmntok_t *t = nullptr;
+            size_t n = 0;
+            tokenizeTwoPass(msg, size, &t, &n);
+            benchKeep(n);
+            delete[] t;
+        });
+        const double after = benchNs(ITERATIONS, [&]() {
+            jsmntok_t *t = nullptr;
+            size_t n = 0;
+            tokenizeSinglePass(msg, size, &t, &n);
+            benchKeep(n);
+            delete[] t;
+        });
+        char name[32];
+        snprintf(name, sizeof(name), "tokenize #%u (%uB)", (unsigned)i, (unsigned)size);
+        benchReport(name, before, after);
+    }
+}
+
+void bench_parse() {
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const char* const msg = INJECT_MESSAGES[i];
+        const size_t size = strlen(msg);
+        std::vector<char> buf(size);
+        const double ns = benchNs(ITERATIONS, [&]() {
+            memcpy(buf.data(), msg, size);
+            JSONValue v = JSONValue::parse(buf.data(), size);
+            benchKeep(v);
+        });
+        printf("JSONValue::parse #%u (%uB)    %10.1f ns\n", (unsigned)i, (unsigned)size, ns);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_messages);
+    RUN_TEST(test_parse_large_document);
+    RUN_TEST(test_parse_invalid);
+    RUN_TEST(test_static_document);
+    RUN_TEST(bench_tokenize);
+    RUN_TEST(bench_parse);
+    RUN_TEST(bench_static_document);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,192 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "wiring_json.h"
+
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+static const unsigned ITERATIONS = 20000;
+
+// Sibling lookup used by the iterators before tokens stored the size of their subtree
+static const jsmntok_t* legacySkipToken(const jsmntok_t *t) {
+    size_t n = 1;
+    do {
+        if (t->type == JSMN_OBJECT) {
+            n += t->size * 2; // Number of name and value tokens
+        } else if (t->type == JSMN_ARRAY) {
+            n += t->size; // Number of value tokens
+        }
+        ++t;
+        --n;
+    } while (n);
+    return t;
+}
+
+// Object with the given number of properties, each holding a nested object
+static std::string makeObject(int props, int nested) {
+    std::string json = "{";
+    for (int i = 0; i < props; ++i) {
+        json += (i ? ",\"k" : "\"k") + std::to_string(i) + "\":{\"id\":" + std::to_string(i) + ",\"v\":[";
+        for (int j = 0; j < nested; ++j) {
+            json += (j ? ",[" : "[") + std::to_string(j) + ",{\"x\":null}]";
+        }
+        json += "]}";
+    }
+    json += "}";
+    return json;
+}
+
+// Counts properties of an object by walking it with the given skip function
+template<typename F>
+static size_t countProperties(const jsmntok_t *obj, F skip) {
+    const jsmntok_t *k = obj + 1;
+    size_t n = 0;
+    for (int i = 0; i < obj->size; ++i) {
+        k = skip(k + 1);
+        ++n;
+    }
+    benchKeep(k);
+    return n;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_subtree_sizes() {
+    const std::string json = makeObject(10, 5);
+    std::vector<jsmntok_t> tokens(1000);
+    jsmn_parser parser;
+    jsmn_init(&parser, nullptr);
+    const int n = jsmn_parse(&parser, json.data(), json.size(), tokens.data(), tokens.size(), nullptr);
+    TEST_ASSERT_TRUE(n > 0);
+    TEST_ASSERT_EQUAL(n, tokens[0].skip);
+    for (int i = 0; i < n; ++i) {
+        const jsmntok_t *t = &tokens[i];
+        TEST_ASSERT_TRUE(t + t->skip == legacySkipToken(t));
+    }
+}
+
+void test_get() {
+    const std::string json = makeObject(50, 3);
+    JSONValue obj = JSONValue::parseCopy(json.data(), json.size());
+    TEST_ASSERT_TRUE(obj.isObject());
+    for (int i = 0; i < 50; ++i) {
+        const std::string key = "k" + std::to_string(i);
+        JSONValue v = obj.get(key.c_str());
+        TEST_ASSERT_TRUE(v.isObject());
+        TEST_ASSERT_EQUAL(i, v.get("id").toInt());
+        TEST_ASSERT_TRUE(v.get("v").isArray());
+    }
+    TEST_ASSERT_FALSE(obj.get("k50").isValid());
+    TEST_ASSERT_FALSE(obj.get("k").isValid());
+    TEST_ASSERT_FALSE(obj.get("").isValid());
+    TEST_ASSERT_FALSE(obj.get("id").isValid()); // Nested properties are not matched
+    TEST_ASSERT_TRUE(obj.get("k10", 2).get("id").toInt() == 1); // Names are compared by length
+
+    // Escaped names are matched by their unescaped value
+    const char* esc = "{\"a\\\"b\":1,\"a\\u0041\":[2],\"\":3,\"c\":null}";
+    obj = JSONValue::parseCopy(esc);
+    TEST_ASSERT_EQUAL(1, obj.get("a\"b").toInt());
+    TEST_ASSERT_TRUE(obj.get("aA").isArray());
+    TEST_ASSERT_EQUAL(3, obj.get("").toInt());
+    TEST_ASSERT_TRUE(obj.get("c").isNull());
+
+    // Only objects have properties
+    TEST_ASSERT_FALSE(JSONValue::parseCopy("[\"a\",1]").get("a").isValid());
+    TEST_ASSERT_FALSE(JSONValue::parseCopy("\"a\"").get("a").isValid());
+    TEST_ASSERT_FALSE(JSONValue().get("a").isValid());
+    TEST_ASSERT_FALSE(JSONValue::parseCopy("{}").get("a").isValid());
+}
+
+void test_malformed_documents() {
+    // The tokenizer is lenient, so these are parsed, but walking them must stay within their tokens
+    const char* const docs[] = { "{\"a\" \"b\" \"c\":1}", "{1}", "{\"a\"}", "[1:2,3]", "{\"a\":1 \"b\"}" };
+    for (const char* doc: docs) {
+        JSONValue v = JSONValue::parseCopy(doc);
+        TEST_ASSERT_TRUE(v.isValid());
+        JSONObjectIterator obj(v);
+        while (obj.next()) {
+            obj.value().type();
+        }
+        JSONArrayIterator arr(v);
+        while (arr.next()) {
+            arr.value().type();
+        }
+        v.get("c");
+        v.get("x");
+    }
+    // A comma after a root value
+    for (const char* json: { "1,", "\"a\",1", "true , false" }) {
+        std::string buf = json;
+        StaticJSONDocument<4> doc;
+        doc.parse(&buf[0], buf.size());
+    }
+}
+
+void bench_lookup() {
+    printf("\n");
+    for (int nested: { 0, 4, 32 }) {
+        const std::string json = makeObject(100, nested);
+        std::vector<jsmntok_t> tokens(20000);
+        jsmn_parser parser;
+        jsmn_init(&parser, nullptr);
+        TEST_ASSERT_TRUE(jsmn_parse(&parser, json.data(), json.size(), tokens.data(), tokens.size(), nullptr) > 0);
+        const jsmntok_t *obj = tokens.data();
+        const double before = benchNs(ITERATIONS, [&]() {
+            benchKeep(countProperties(obj, legacySkipToken));
+        });
+        const double after = benchNs(ITERATIONS, [&]() {
+            benchKeep(countProperties(obj, [](const jsmntok_t *t) { return t + t->skip; }));
+        });
+        char name[32];
+        snprintf(name, sizeof(name), "iterate, %d tokens", (int)parser.toknext);
+        benchReport(name, before, after);
+    }
+    // Looking up the last property of an object
+    const std::string json = makeObject(100, 4);
+    JSONValue obj = JSONValue::parseCopy(json.data(), json.size());
+    const double before = benchNs(ITERATIONS, [&]() {
+        JSONObjectIterator it(obj);
+        while (it.next()) {
+            if (it.name() == "k99") {
+                benchKeep(it.value());
+                break;
+            }
+        }
+    });
+    const double after = benchNs(ITERATIONS, [&]() {
+        benchKeep(obj.get("k99"));
+    });
+    benchReport("get(\"k99\") vs iterator", before, after);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_subtree_sizes);
+    RUN_TEST(test_get);
+    RUN_TEST(test_malformed_documents);
+    RUN_TEST(bench_lookup);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "wiring_json.h"
+#include "JSONNumber.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+static const unsigned ITERATIONS = 20000;
+
+static bool isSameDouble(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+// Checks the fast path against strtod(). Returns true if the fast path handled the input
+static bool checkDouble(const std::string& str) {
+    double v = 0;
+    if (!detail::parseDouble(str.data(), str.data() + str.size(), &v)) {
+        return false;
+    }
+    const double expected = strtod(str.c_str(), nullptr);
+    if (!isSameDouble(v, expected)) {
+        printf("%s: %.17g != %.17g\n", str.c_str(), v, expected);
+        TEST_FAIL_MESSAGE("Mismatch");
+    }
+    return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_parse_integers() {
+    const char* const nums[] = {
+        "0", "-0", "7", "-7", "123", "12345678", "123456789", "-1234567890123456", "12345678901234567",
+        "9223372036854775807", "-9223372036854775808", "9223372036854775808", "-9223372036854775809",
+        "18446744073709551615", "18446744073709551616", "99999999999999999999", "000000000000000000000042",
+        "2147483647", "2147483648", "-2147483649", "4294967296", "12.5", "-3.9", "1e3", "12abc", "1234567a9",
+        "", "-", "abc", " 1", "+1", "--1", "0x10"
+    };
+    for (const char* s: nums) {
+        const char* const end = s + strlen(s);
+        long long i = 0;
+        if (detail::parseInt64(s, end, &i)) {
+            TEST_ASSERT_TRUE(i == strtoll(s, nullptr, 10));
+        }
+        unsigned long long u = 0;
+        if (detail::parseUInt64(s, end, &u)) {
+            TEST_ASSERT_TRUE(u == strtoull(s, nullptr, 10));
+        }
+        // Same results as before through JSONValue, whether the fast path is taken or not
+        for (const std::string& json: { std::string(s) + " ", "\"" + std::string(s) + "\"" }) {
+            JSONValue v = JSONValue::parseCopy(json.data(), json.size());
+            if (!v.isNumber() && !v.isString()) {
+                continue;
+            }
+            TEST_ASSERT_TRUE(v.toInt() == (int)strtol(s, nullptr, 10));
+            TEST_ASSERT_TRUE(v.toUInt() == (unsigned)strtoul(s, nullptr, 10));
+            TEST_ASSERT_TRUE(v.toInt64() == strtoll(s, nullptr, 10));
+            TEST_ASSERT_TRUE(v.toUInt64() == strtoull(s, nullptr, 10));
+            TEST_ASSERT_TRUE(isSameDouble(v.toDouble(), strtod(s, nullptr)));
+        }
+    }
+    // Input doesn't need to be null-terminated
+    const char* s = "12345678901234567890";
+    long long i = 0;
+    TEST_ASSERT_TRUE(detail::parseInt64(s, s + 3, &i) && i == 123);
+    TEST_ASSERT_TRUE(detail::parseInt64(s, s + 9, &i) && i == 123456789);
+    TEST_ASSERT_TRUE(detail::parseInt64(s, s + 16, &i) && i == 1234567890123456);
+    TEST_ASSERT_FALSE(detail::parseInt64(s, s, &i));
+}
+
+void test_parse_doubles() {
+    const char* const nums[] = {
+        "0", "-0", "0.0", "-0.0", "1", "1.5", "-1.5", "0.1", "0.2", "0.3", ".5", "-.5", "5.", "1e0", "1E+2",
+        "1e-2", "1e", "1e+", "2.5e-3x", "3.141592653589793", "2.718281828459045", "1e22", "1e23", "9e22",
+        "9007199254740992", "9007199254740993", "9007199254740995", "18446744073709551615",
+        "12345678901234567890", "0.000000000000000000000000000001", "00000000000000000000000000.5",
+        "1.00000000000000011102230246251565404236316680908203125", "1.7976931348623157e308", "4.9e-324",
+        "2.2250738585072014e-308", "1e64", "1e-64", "1e65", "1e-65", "123.456e-40", "0x1p3", "inf", "nan",
+        "", "-", ".", "e5", " 1", "+1"
+    };
+    for (const char* s: nums) {
+        checkDouble(s);
+        const std::string json = std::string(s) + " ";
+        JSONValue v = JSONValue::parseCopy(json.data(), json.size());
+        if (v.isNumber()) {
+            TEST_ASSERT_TRUE(isSameDouble(v.toDouble(), strtod(s, nullptr)));
+        }
+    }
+    TEST_ASSERT_TRUE(checkDouble("1e23"));
+    TEST_ASSERT_TRUE(checkDouble("9007199254740993"));
+    TEST_ASSERT_TRUE(checkDouble("1.5e-63"));
+    TEST_ASSERT_FALSE(checkDouble("1e300"));
+
+    // Shortest and fixed representations of random doubles, and random decimal numbers
+    std::mt19937_64 rnd(1);
+    unsigned total = 0, handled = 0;
+    char buf[64];
+    for (int i = 0; i < 200000; ++i) {
+        double d;
+        const uint64_t bits = rnd();
+        memcpy(&d, &bits, sizeof(d));
+        if (!std::isfinite(d)) {
+            continue;
+        }
+        for (const char* fmt: { "%.17g", "%.16g", "%.15g", "%.6g", "%.3e" }) {
+            snprintf(buf, sizeof(buf), fmt, d);
+            handled += checkDouble(buf);
+            ++total;
+        }
+        const int digits = 1 + rnd() % 19;
+        std::string num = std::to_string(rnd() % 10000000000000000000u).substr(0, digits);
+        const int point = rnd() % (num.size() + 1);
+        num.insert(point, ".");
+        num += "e" + std::to_string((int)(rnd() % 140) - 70);
+        handled += checkDouble(num);
+        ++total;
+    }
+    printf("\nfast path: %u of %u numbers\n", handled, total);
+}
+
+void bench_numbers() {
+    printf("\n");
+    const std::vector<std::string> ints = {
+        "0", "7", "42", "443", "-15", "8080", "65535", "123456", "-2147483648", "1700000000", "9876543210123"
+    };
+    const std::vector<std::string> doubles = {
+        "0.5", "23.456", "-0.000123", "1234567.891", "3.141592653589793", "1e-7", "-273.15", "6.02214076e23",
+        "0.1", "99.99", "52.520008", "13.404954"
+    };
+    const double intBefore = benchNs(ITERATIONS, [&]() {
+        for (const std::string& s: ints) {
+            benchKeep(strtoll(s.c_str(), nullptr, 10));
+        }
+    }) / ints.size();
+    const double intAfter = benchNs(ITERATIONS, [&]() {
+        for (const std::string& s: ints) {
+            long long v = 0;
+            if (!detail::parseInt64(s.data(), s.data() + s.size(), &v)) {
+                v = strtoll(s.c_str(), nullptr, 10);
+            }
+            benchKeep(v);
+        }
+    }) / ints.size();
+    benchReport("integer, per number", intBefore, intAfter);
+    const double dblBefore = benchNs(ITERATIONS, [&]() {
+        for (const std::string& s: doubles) {
+            benchKeep(strtod(s.c_str(), nullptr));
+        }
+    }) / doubles.size();
+    const double dblAfter = benchNs(ITERATIONS, [&]() {
+        for (const std::string& s: doubles) {
+            double v = 0;
+            if (!detail::parseDouble(s.data(), s.data() + s.size(), &v)) {
+                v = strtod(s.c_str(), nullptr);
+            }
+            benchKeep(v);
+        }
+    }) / doubles.size();
+    benchReport("double, per number", dblBefore, dblAfter);
+
+    // Through the JSON API
+    std::string json = "[";
+    for (int i = 0; i < 10; ++i) {
+        for (const std::string& s: doubles) {
+            json += (json.size() > 1 ? "," : "") + s;
+        }
+    }
+    json += "]";
+    JSONValue arr = JSONValue::parseCopy(json.data(), json.size());
+    std::vector<JSONValue> values;
+    JSONArrayIterator it(arr);
+    while (it.next()) {
+        values.push_back(it.value());
+    }
+    const double apiBefore = benchNs(ITERATIONS / 10, [&]() {
+        for (const JSONValue& v: values) {
+            benchKeep(strtod(v.toString().data(), nullptr));
+        }
+    }) / values.size();
+    const double apiAfter = benchNs(ITERATIONS / 10, [&]() {
+        for (const JSONValue& v: values) {
+            benchKeep(v.toDouble());
+        }
+    }) / values.size();
+    benchReport("JSONValue::toDouble()", apiBefore, apiAfter);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_parse_integers);
+    RUN_TEST(test_parse_doubles);
+    RUN_TEST(bench_numbers);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,158 @@
+#include "unity.h"
+#include "alloc_count.h"
+
+#include "JSONSchema.h"
+
+#include <string>
+
+struct Settings {
+    String name;
+    int port;
+    double ratio;
+    bool enabled;
+    bool save;
+};
+
+static constexpr JSONField<Settings> SETTINGS_FIELDS[] = {
+    jsonField("name", &Settings::name),
+    jsonField("port", &Settings::port),
+    jsonField("ratio", &Settings::ratio),
+    jsonField("enabled", &Settings::enabled),
+    jsonPresence("save", &Settings::save),
+    jsonIgnore<Settings>("comment"),
+};
+
+static constexpr auto SETTINGS_SCHEMA = makeJSONSchema(SETTINGS_FIELDS);
+static_assert(SETTINGS_SCHEMA.isValid(), "Invalid schema");
+
+static bool read(Settings& s, const std::string& json, unsigned* unknown = nullptr, unsigned* invalid = nullptr) {
+    JSONSchemaReader<Settings, 6> reader(SETTINGS_SCHEMA, s);
+    const bool ok = reader.parse(json.data(), json.size());
+    if (unknown) {
+        *unknown = reader.unknownKeys();
+    }
+    if (invalid) {
+        *invalid = reader.invalidValues();
+    }
+    return ok;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_schema_read() {
+    Settings s = {};
+    const char* json = "{\"name\":\"dev\\u00e9\",\"port\":8080,\"ratio\":0.25,"
+            "\"enabled\":true,\"save\":null,\"comment\":\"x\"}";
+    TEST_ASSERT_TRUE(SETTINGS_SCHEMA.read(s, json, strlen(json)));
+    TEST_ASSERT_EQUAL_STRING("dev\xc3\xa9", s.name.c_str());
+    TEST_ASSERT_EQUAL(8080, s.port);
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, s.ratio);
+    TEST_ASSERT_TRUE(s.enabled);
+    TEST_ASSERT_TRUE(s.save);
+
+    // Missing properties leave members untouched
+    TEST_ASSERT_TRUE(read(s, "{\"enabled\":false}"));
+    TEST_ASSERT_FALSE(s.enabled);
+    TEST_ASSERT_EQUAL_STRING("dev\xc3\xa9", s.name.c_str());
+    TEST_ASSERT_EQUAL(8080, s.port);
+
+    // Fields are moved one by one
+    Settings copy = {};
+    for (size_t i = 0; i < SETTINGS_SCHEMA.size(); ++i) {
+        SETTINGS_SCHEMA.move(copy, s, i);
+    }
+    TEST_ASSERT_EQUAL_STRING("dev\xc3\xa9", copy.name.c_str());
+    TEST_ASSERT_EQUAL(8080, copy.port);
+    TEST_ASSERT_EQUAL_DOUBLE(0.25, copy.ratio);
+    TEST_ASSERT_FALSE(copy.enabled);
+    TEST_ASSERT_TRUE(copy.save);
+}
+
+void test_schema_unknown_and_invalid() {
+    Settings s = {};
+    s.port = 1;
+    unsigned unknown = 0, invalid = 0;
+    TEST_ASSERT_TRUE(read(s, "{\"nam\":1,\"port\":\"80\",\"extra\":{\"port\":2},\"enabled\":1,\"name\":5}",
+            &unknown, &invalid));
+    TEST_ASSERT_EQUAL(2, unknown);
+    TEST_ASSERT_EQUAL(2, invalid);
+    TEST_ASSERT_EQUAL(1, s.port); // Nested properties are not stored
+    TEST_ASSERT_EQUAL_STRING("5", s.name.c_str()); // Primitive values are stored as text
+
+    TEST_ASSERT_TRUE(read(s, "{\"name\":{\"a\":[1,2]},\"port\":3}"));
+    TEST_ASSERT_EQUAL_STRING("", s.name.c_str());
+    TEST_ASSERT_EQUAL(3, s.port);
+
+    // Names that don't fit into the buffer are unknown, numbers are skipped in parts, and deeply
+    // nested values are skipped without being parsed
+    const std::string longName(JSONSchemaReader<Settings, 6>::BUFFER_SIZE, 'n');
+    const std::string deep = std::string(40, '[') + std::string(40, ']');
+    TEST_ASSERT_TRUE(read(s, "{\"" + longName + "\":{\"port\":4},\"comment\":" + std::string(70, '9') +
+            ",\"comment\":" + deep + ",\"name\":" + std::string(70, '1') + ",\"port\":5}", &unknown, &invalid));
+    TEST_ASSERT_EQUAL(1, unknown);
+    TEST_ASSERT_EQUAL(0, invalid);
+    TEST_ASSERT_EQUAL_STRING(std::string(70, '1').c_str(), s.name.c_str());
+    TEST_ASSERT_EQUAL(5, s.port);
+
+    // Only objects can be read
+    TEST_ASSERT_FALSE(read(s, "[1]"));
+    TEST_ASSERT_FALSE(read(s, "\"name\""));
+    TEST_ASSERT_FALSE(read(s, "{\"port\":1"));
+}
+
+void test_schema_long_values() {
+    Settings s = {};
+    const std::string name(1000, 'n');
+    TEST_ASSERT_TRUE(read(s, "{\"name\":\"" + name + "\",\"port\":7}"));
+    TEST_ASSERT_EQUAL_STRING(name.c_str(), s.name.c_str());
+    TEST_ASSERT_EQUAL(7, s.port);
+
+    // Long values of other fields are not stored in parts
+    unsigned invalid = 0;
+    const std::string str = "\"" + std::string(100, 'x') + "\"";
+    TEST_ASSERT_TRUE(read(s, "{\"save\":" + str + ",\"comment\":" + str + ",\"port\":" + str + "}", nullptr, &invalid));
+    TEST_ASSERT_TRUE(s.save);
+    TEST_ASSERT_EQUAL(7, s.port);
+    TEST_ASSERT_EQUAL(1, invalid);
+
+    // A value that doesn't fit in memory fails the parsing rather than being truncated
+    if (ALLOC_COUNT_SUPPORTED) {
+        const std::string json = "{\"name\":\"" + std::string(1000, 'm') + "\",\"port\":8}";
+        for (long n = 0; n < 2; ++n) {
+            Settings t = {};
+            allocFailAfter = n;
+            const bool ok = read(t, json);
+            allocFailAfter = -1;
+            TEST_ASSERT_FALSE(ok);
+            TEST_ASSERT_EQUAL(0, t.port);
+        }
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_schema_read);
+    RUN_TEST(test_schema_unknown_and_invalid);
+    RUN_TEST(test_schema_long_values);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,352 @@
+#include "unity.h"
+#include "bench.h"
+#include "inject_messages.h"
+
+#include "wiring_json.h"
+
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+// Records parser events as a compact string, e.g. {name:"value",list:[1,true,]}
+class RecordingHandler: public JSONStreamHandler {
+public:
+    std::string events;
+    std::string part;
+    unsigned parts = 0;
+
+    virtual bool beginArray() override {
+        events += '[';
+        return true;
+    }
+
+    virtual bool endArray() override {
+        events += ']';
+        return true;
+    }
+
+    virtual bool beginObject() override {
+        events += '{';
+        return true;
+    }
+
+    virtual bool endObject() override {
+        events += '}';
+        return true;
+    }
+
+    virtual bool name(const char *name, size_t size) override {
+        TEST_ASSERT_EQUAL(strlen(name), size);
+        events.append(name, size);
+        events += ':';
+        return true;
+    }
+
+    virtual bool value(JSONType type, const char *val, size_t size) override {
+        TEST_ASSERT_EQUAL(strlen(val), size);
+        if (type == JSON_TYPE_STRING) {
+            events += '"';
+            events += part;
+            events.append(val, size);
+            events += '"';
+        } else {
+            events += part;
+            events.append(val, size);
+        }
+        events += ',';
+        part.clear();
+        return true;
+    }
+
+    virtual bool valuePart(const char *data, size_t size) override {
+        part.append(data, size);
+        ++parts;
+        return true;
+    }
+};
+
+class MockStream {
+public:
+    explicit MockStream(const char *data) :
+            data_(data),
+            pos_(0) {
+    }
+
+    int available() {
+        return (int)(strlen(data_) - pos_);
+    }
+
+    int read() {
+        return data_[pos_] ? (unsigned char)data_[pos_++] : -1;
+    }
+
+private:
+    const char *data_;
+    size_t pos_;
+};
+
+static std::string parseChunked(const char *json, size_t chunk, size_t bufSize = 64, bool *ok = nullptr) {
+    RecordingHandler h;
+    std::vector<char> buf(bufSize);
+    JSONStreamParser p(h, buf.data(), buf.size());
+    const size_t size = strlen(json);
+    bool res = true;
+    for (size_t i = 0; i < size && res; i += chunk) {
+        const size_t n = std::min(chunk, size - i);
+        res = p.write((const uint8_t*)json + i, n) == n;
+    }
+    res = res && p.end();
+    if (ok) {
+        *ok = res;
+    }
+    return res ? h.events : std::string();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_stream_events(void) {
+    const char *json = "{\"t\":\"set\", \"blynk\": {\"host\":\"blynk.cloud\",\"port\":443},"
+            " \"list\": [1, -2.5e3, true, false, null, [], {}, \"\"]}";
+    const std::string expected = "{t:\"set\",blynk:{host:\"blynk.cloud\",port:443,}"
+            "list:[1,-2.5e3,true,false,null,[]{}\"\",]}";
+    for (size_t chunk: { 1, 2, 7, 1000 }) {
+        TEST_ASSERT_EQUAL_STRING(expected.c_str(), parseChunked(json, chunk).c_str());
+    }
+    // Primitive values at the top level
+    TEST_ASSERT_EQUAL_STRING("42,", parseChunked("42", 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("true,", parseChunked(" true ", 3).c_str());
+    TEST_ASSERT_EQUAL_STRING("\"abc\",", parseChunked("\"abc\"", 1).c_str());
+}
+
+void test_stream_inject_messages(void) {
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        bool ok = false;
+        parseChunked(INJECT_MESSAGES[i], 5, 64, &ok);
+        TEST_ASSERT_TRUE(ok);
+    }
+}
+
+void test_stream_escapes(void) {
+    TEST_ASSERT_EQUAL_STRING("[\"a\"b\\c/d\be\ff\ng\rh\ti\",]",
+            parseChunked("[\"a\\\"b\\\\c\\/d\\be\\ff\\ng\\rh\\ti\"]", 1).c_str());
+    // Code points encoded in UTF-8
+    TEST_ASSERT_EQUAL_STRING("[\"\x1f\xc3\xa9\xe2\x82\xac\",]",
+            parseChunked("[\"\\u001f\\u00E9\\u20ac\"]", 1).c_str());
+    // Surrogate pair
+    TEST_ASSERT_EQUAL_STRING("[\"\xf0\x9f\x98\x80\",]", parseChunked("[\"\\ud83d\\ude00\"]", 1).c_str());
+    // Unpaired surrogates are replaced with U+FFFD
+    TEST_ASSERT_EQUAL_STRING("[\"\xef\xbf\xbd" "a\",]", parseChunked("[\"\\ud83da\"]", 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("[\"\xef\xbf\xbd\",]", parseChunked("[\"\\ud83d\"]", 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("[\"\xef\xbf\xbd\\\",]", parseChunked("[\"\\ud83d\\\\\"]", 1).c_str());
+    TEST_ASSERT_EQUAL_STRING("[\"\xef\xbf\xbd\",]", parseChunked("[\"\\ude00\"]", 1).c_str());
+}
+
+void test_stream_long_values(void) {
+    RecordingHandler h;
+    char buf[8];
+    JSONStreamParser p(h, buf, sizeof(buf));
+    std::string val(100, 'x');
+    val[50] = 'y';
+    const std::string json = "{\"key\":\"" + val + "\"}";
+    TEST_ASSERT_EQUAL(json.size(), p.write((const uint8_t*)json.data(), json.size()));
+    TEST_ASSERT_TRUE(p.end());
+    TEST_ASSERT_EQUAL_STRING(("{key:\"" + val + "\",}").c_str(), h.events.c_str());
+    TEST_ASSERT_EQUAL(14, h.parts);
+
+    // Numbers are passed in parts as well, literal names must fit into the buffer
+    bool ok = false;
+    TEST_ASSERT_EQUAL_STRING("[123456789,-1.5e+300,]", parseChunked("[123456789,-1.5e+300]", 1, 8, &ok).c_str());
+    TEST_ASSERT_TRUE(ok);
+    TEST_ASSERT_EQUAL_STRING("{name:1234567,}", parseChunked("{\"name\":1234567}", 1, 8, &ok).c_str());
+    TEST_ASSERT_TRUE(ok);
+    parseChunked("[true]", 1, 4, &ok);
+    TEST_ASSERT_FALSE(ok);
+
+    // Buffers too small for a character and the term. null character are rejected
+    for (size_t bufSize: { 0, 1 }) {
+        for (const char *json: { "1", "true", "\"a\"", "[1]", "{\"a\":\"b\"}", "[[]]" }) {
+            ok = true;
+            parseChunked(json, 1, bufSize, &ok);
+            TEST_ASSERT_FALSE_MESSAGE(ok, json);
+        }
+        JSONStreamParser tiny(h, buf, bufSize);
+        TEST_ASSERT_TRUE(tiny.hasError());
+        tiny.reset();
+        TEST_ASSERT_TRUE(tiny.hasError());
+    }
+
+    // Names are passed in parts if the handler accepts them
+    parseChunked("{\"long_name\":1}", 1, 8, &ok);
+    TEST_ASSERT_FALSE(ok);
+    class NamePartHandler: public RecordingHandler {
+    public:
+        virtual bool namePart(const char *data, size_t size) override {
+            events.append(data, size);
+            return true;
+        }
+    } nh;
+    JSONStreamParser np(nh, buf, sizeof(buf));
+    const std::string name(20, 'n');
+    const std::string obj = "{\"" + name + "\":\"" + val + "\"}";
+    TEST_ASSERT_EQUAL(obj.size(), np.write((const uint8_t*)obj.data(), obj.size()));
+    TEST_ASSERT_TRUE(np.end());
+    TEST_ASSERT_EQUAL_STRING(("{" + name + ":\"" + val + "\",}").c_str(), nh.events.c_str());
+}
+
+void test_stream_invalid(void) {
+    const char *invalid[] = {
+        "", "{", "[1,", "{\"a\"}", "{\"a\":}", "{\"a\" 1}", "[1 2]", "[1,]", "{,}", "{\"a\":1,}",
+        "[}", "{]", "]", "[1]]", "[1] 2", "\"abc", "\"a\nb\"", "\"\\x\"", "\"\\u12g4\"", "tru",
+        "truex", "nul", "[abc]", "{a:1}", "'a'"
+    };
+    for (const char *json: invalid) {
+        bool ok = true;
+        parseChunked(json, 1, 64, &ok);
+        TEST_ASSERT_FALSE_MESSAGE(ok, json);
+    }
+    // Values nested deeper than the limit are reported as empty and skipped
+    const std::string open(JSONStreamParser::MAX_DEPTH, '['), close(JSONStreamParser::MAX_DEPTH, ']');
+    bool ok = false;
+    TEST_ASSERT_EQUAL_STRING((open + close).c_str(), parseChunked((open + close).c_str(), 16, 64, &ok).c_str());
+    TEST_ASSERT_TRUE(ok);
+    const std::string skipped = "{\"a\":[\"]}\\\"[\",{\"b\":[[[]]]}]}";
+    for (size_t chunk: { 1, 16 }) {
+        const std::string json = open + skipped + ",[" + skipped + "],2" + close;
+        TEST_ASSERT_EQUAL_STRING((open + ",,2," + close).c_str(), parseChunked(json.c_str(), chunk, 64, &ok).c_str());
+        TEST_ASSERT_TRUE(ok);
+    }
+    for (const char* json: { "[", "[[]", "[\"]\"", "[\"\\\"]" }) {
+        parseChunked((open + json + close).c_str(), 16, 64, &ok);
+        TEST_ASSERT_FALSE_MESSAGE(ok, json);
+    }
+}
+
+void test_stream_handler_abort(void) {
+    class AbortingHandler: public JSONStreamHandler {
+    public:
+        unsigned values = 0;
+
+        virtual bool value(JSONType, const char*, size_t) override {
+            return ++values < 2;
+        }
+    };
+    AbortingHandler h;
+    char buf[16];
+    JSONStreamParser p(h, buf, sizeof(buf));
+    const char *json = "[1,2,3]";
+    TEST_ASSERT_EQUAL(4, p.write((const uint8_t*)json, strlen(json)));
+    TEST_ASSERT_TRUE(p.hasError());
+    TEST_ASSERT_FALSE(p.end());
+    TEST_ASSERT_EQUAL(2, h.values);
+
+    // Parser can be reused after a reset
+    p.reset();
+    h.values = 0;
+    TEST_ASSERT_EQUAL(1, p.write((const uint8_t*)"1", 1));
+    TEST_ASSERT_TRUE(p.end());
+}
+
+void test_stream_read_from(void) {
+    RecordingHandler h;
+    char buf[16];
+    JSONStreamParser p(h, buf, sizeof(buf));
+    MockStream s("{\"ssid\":\"net\",\"rssi\":-60}");
+    TEST_ASSERT_EQUAL(25, p.readFrom(s));
+    TEST_ASSERT_TRUE(p.isDone());
+    TEST_ASSERT_TRUE(p.end());
+    TEST_ASSERT_EQUAL_STRING("{ssid:\"net\",rssi:-60,}", h.events.c_str());
+
+    // Print interface
+    RecordingHandler h2;
+    JSONStreamParser p2(h2, buf, sizeof(buf));
+    p2.print("[\"a\",");
+    p2.print(1);
+    p2.print("]");
+    TEST_ASSERT_TRUE(p2.end());
+    TEST_ASSERT_EQUAL_STRING("[\"a\",1,]", h2.events.c_str());
+}
+
+void test_stream_large_document(void) {
+    // Documents of any size can be parsed with a small buffer
+    class CountingHandler: public JSONStreamHandler {
+    public:
+        unsigned values = 0;
+        double sum = 0;
+
+        virtual bool value(JSONType, const char *val, size_t) override {
+            ++values;
+            sum += atof(val);
+            return true;
+        }
+    };
+    std::string json = "[";
+    for (unsigned i = 0; i < 10000; ++i) {
+        json += std::to_string(i) + ",";
+    }
+    json.back() = ']';
+    CountingHandler h;
+    char buf[8];
+    JSONStreamParser p(h, buf, sizeof(buf));
+    TEST_ASSERT_EQUAL(json.size(), p.write((const uint8_t*)json.data(), json.size()));
+    TEST_ASSERT_TRUE(p.end());
+    TEST_ASSERT_EQUAL(10000, h.values);
+    TEST_ASSERT_EQUAL(49995000.0, h.sum);
+}
+
+void bench_stream_parser(void) {
+    printf("\n");
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const char *msg = INJECT_MESSAGES[i];
+        const size_t size = strlen(msg);
+        JSONStreamHandler h;
+        char buf[64];
+        const double stream = benchNs(200000, [&]() {
+            JSONStreamParser p(h, buf, sizeof(buf));
+            p.write((const uint8_t*)msg, size);
+            benchKeep(p.end());
+        });
+        std::vector<char> copy(size);
+        const double dom = benchNs(200000, [&]() {
+            memcpy(copy.data(), msg, size);
+            JSONValue v = JSONValue::parse(copy.data(), size);
+            benchKeep(v);
+        });
+        printf("JSONStreamParser #%u (%uB)    %10.1f ns   JSONValue::parse %10.1f ns\n",
+                (unsigned)i, (unsigned)size, stream, dom);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_events);
+    RUN_TEST(test_stream_inject_messages);
+    RUN_TEST(test_stream_escapes);
+    RUN_TEST(test_stream_long_values);
+    RUN_TEST(test_stream_invalid);
+    RUN_TEST(test_stream_handler_abort);
+    RUN_TEST(test_stream_read_from);
+    RUN_TEST(test_stream_large_document);
+    RUN_TEST(bench_stream_parser);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
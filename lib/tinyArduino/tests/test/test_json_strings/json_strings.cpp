@@ -0,0 +1,253 @@
+#include "unity.h"
+#include "bench.h"
+
+#include "wiring_json.h"
+
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+static const unsigned ITERATIONS = 100000;
+
+// Parses a document and returns the string value at the root
+static bool parseString(const std::string& json, std::string* val) {
+    std::vector<char> buf(json.begin(), json.end());
+    StaticJSONDocument<4> doc;
+    if (!doc.parse(buf.data(), buf.size()) || !doc.value().isString()) {
+        return false;
+    }
+    const JSONString s = doc.value().toString();
+    val->assign(s.data(), s.size());
+    return true;
+}
+
+// Reassembles string values reported by JSONStreamParser
+class StringCollector: public JSONStreamHandler {
+public:
+    std::vector<std::string> values;
+
+    virtual bool value(JSONType type, const char *val, size_t size) override {
+        if (type == JSON_TYPE_STRING) {
+            part_.append(val, size);
+            values.push_back(part_);
+        }
+        part_.clear();
+        return true;
+    }
+
+    virtual bool valuePart(const char *data, size_t size) override {
+        part_.append(data, size);
+        return true;
+    }
+
+private:
+    std::string part_;
+};
+
+// Streams a document in one write, or a byte at a time
+static bool streamStrings(const std::string& json, size_t bufSize, bool bytewise, std::vector<std::string>* vals) {
+    StringCollector h;
+    std::vector<char> buf(bufSize);
+    JSONStreamParser p(h, buf.data(), buf.size());
+    bool ok = true;
+    if (bytewise) {
+        for (char c: json) {
+            ok = ok && p.write((uint8_t)c) == 1;
+        }
+    } else {
+        ok = p.write((const uint8_t*)json.data(), json.size()) == json.size();
+    }
+    *vals = h.values;
+    return ok && p.end();
+}
+
+// Payload of a "set" message with long values, optionally containing escaped characters
+static std::string makePayload(bool escapes) {
+    const char* pass = escapes ? "p\\\"a\\\\s\\/s\\tw\\u0041rd-with-escapes-0123456789abcdefghijklmnop" :
+            "password-without-escapes-0123456789abcdefghijklmnopqrstuvwxyzABCDE";
+    std::string json = "{\"t\":\"set\",\"ssid\":\"";
+    json += escapes ? "Blynk \\\"Office\\\" 5th floor, east wing" : "Blynk Office 5th floor, east wing AP";
+    json += "\",\"pass\":\"";
+    json += pass;
+    json += "\",\"blynk\":\"Uj5kVnR0cW1hT3p1Y2ZxWkxRUFNkVgQz\",\"host\":\"fra1.blynk.cloud\",\"certs\":[";
+    for (int i = 0; i < 8; ++i) {
+        json += i ? ",\"" : "\"";
+        for (int j = 0; j < 6; ++j) {
+            json += escapes ? "MIIBIjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEA\\n" :
+                    "MIIBIjANBgkqhkiG9w0BAQEFAAOCAQ8AMIIBCgKCAQEAxx";
+        }
+        json += "\"";
+    }
+    json += "]}";
+    return json;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_scan_special_characters() {
+    // Quotes and backslashes at every offset within and across words
+    for (size_t len = 0; len < 80; ++len) {
+        for (size_t pos = 0; pos < len; ++pos) {
+            std::string str(len, 'a');
+            std::string json = "[\"" + str.substr(0, pos) + "\",\"" + str.substr(pos) + "\"]";
+            JSONValue arr = JSONValue::parseCopy(json.data(), json.size());
+            JSONArrayIterator it(arr);
+            TEST_ASSERT_EQUAL(2, it.count());
+            TEST_ASSERT_TRUE(it.next() && it.value().toString().size() == pos);
+            TEST_ASSERT_TRUE(it.next() && it.value().toString().size() == len - pos);
+
+            std::string val;
+            str[pos] = '\\';
+            str.insert(pos + 1, "\\");
+            TEST_ASSERT_TRUE(parseString("\"" + str + "\"", &val));
+            TEST_ASSERT_EQUAL(len, val.size());
+            TEST_ASSERT_EQUAL('\\', val[pos]);
+        }
+        // Unterminated string
+        std::string val;
+        TEST_ASSERT_FALSE(parseString("\"" + std::string(len, 'a'), &val));
+    }
+    // Strings end at a null character
+    std::string json = "[\"" + std::string(40, 'a') + "\"]";
+    json[20] = '\0';
+    std::string val;
+    TEST_ASSERT_FALSE(parseString(json, &val));
+    // High bytes are not mistaken for special characters
+    TEST_ASSERT_TRUE(parseString("\"" + std::string(40, '\xa2') + "\xdc\xa2\xa2\"", &val));
+    TEST_ASSERT_EQUAL(43, val.size());
+}
+
+void test_unescape() {
+    for (size_t pos = 0; pos < 40; ++pos) {
+        std::string str(40, 'x');
+        std::string expected = str;
+        str.replace(pos, 1, "\\n");
+        expected[pos] = '\n';
+        std::string val;
+        TEST_ASSERT_TRUE(parseString("\"" + str + "\"", &val));
+        TEST_ASSERT_TRUE(val == expected);
+    }
+    std::string val;
+    TEST_ASSERT_TRUE(parseString(R"json("a\"b\\c\/d\u0041\u00e9e")json", &val));
+    TEST_ASSERT_TRUE(val == "a\"b\\c/dA\\u00e9e");
+
+    for (bool escapes: { false, true }) {
+        std::string json = makePayload(escapes);
+        JSONValue v = JSONValue::parseCopy(json.data(), json.size());
+        TEST_ASSERT_TRUE(v.isObject());
+        JSONObjectIterator it(v);
+        size_t n = 0;
+        while (it.next()) {
+            ++n;
+        }
+        TEST_ASSERT_EQUAL(6, n);
+    }
+}
+
+void test_stream_strings() {
+    // Special characters at every offset, with parts of various sizes
+    for (size_t len = 0; len < 70; ++len) {
+        for (size_t pos = 0; pos <= len; ++pos) {
+            std::string str(len, 'a');
+            std::string expected = str;
+            if (pos < len) {
+                str.replace(pos, 1, "\\\"\\u00e9");
+                expected.replace(pos, 1, "\"\xc3\xa9");
+            }
+            const std::string json = "[\"" + str + "\",\"" + str + "\"]";
+            for (size_t bufSize: { 2, 5, 17, 64 }) {
+                std::vector<std::string> vals;
+                TEST_ASSERT_TRUE(streamStrings(json, bufSize, false, &vals));
+                TEST_ASSERT_EQUAL(2, vals.size());
+                TEST_ASSERT_TRUE(vals[0] == expected && vals[1] == expected);
+            }
+        }
+    }
+    // Bulk and bytewise parsing produce the same values
+    for (bool escapes: { false, true }) {
+        const std::string json = makePayload(escapes);
+        std::vector<std::string> bulk, bytewise;
+        TEST_ASSERT_TRUE(streamStrings(json, 64, false, &bulk));
+        TEST_ASSERT_TRUE(streamStrings(json, 64, true, &bytewise));
+        TEST_ASSERT_EQUAL(13, bulk.size());
+        TEST_ASSERT_TRUE(bulk == bytewise);
+    }
+    // Control characters must be escaped
+    for (size_t pos = 0; pos < 40; ++pos) {
+        std::string json = "\"" + std::string(40, 'c') + "\"";
+        json[pos + 1] = '\n';
+        std::vector<std::string> vals;
+        TEST_ASSERT_FALSE(streamStrings(json, 64, false, &vals));
+        json[pos + 1] = '\0';
+        TEST_ASSERT_FALSE(streamStrings(json, 64, false, &vals));
+    }
+    // Characters following an unpaired surrogate
+    std::vector<std::string> vals;
+    TEST_ASSERT_TRUE(streamStrings("\"\\ud800" + std::string(40, 's') + "\"", 64, false, &vals));
+    TEST_ASSERT_EQUAL(1, vals.size());
+    TEST_ASSERT_TRUE(vals[0] == "\xef\xbf\xbd" + std::string(40, 's'));
+}
+
+void bench_strings() {
+    printf("\n");
+    for (bool escapes: { false, true }) {
+        const std::string json = makePayload(escapes);
+        std::vector<char> buf(json.size());
+        const double ns = benchNs(ITERATIONS, [&]() {
+            memcpy(buf.data(), json.data(), json.size());
+            StaticJSONDocument<32> doc;
+            benchKeep(doc.parse(buf.data(), buf.size()));
+        });
+        printf("parse, %-12s (%uB)  %10.1f ns  %7.1f MB/s\n", escapes ? "escapes" : "no escapes",
+                (unsigned)json.size(), ns, json.size() * 1000.0 / ns);
+    }
+    // The stream parser, fed a byte at a time and in one write
+    for (bool escapes: { false, true }) {
+        const std::string json = makePayload(escapes);
+        JSONStreamHandler h;
+        char buf[64];
+        const double before = benchNs(ITERATIONS, [&]() {
+            JSONStreamParser p(h, buf, sizeof(buf));
+            for (char c: json) {
+                p.write((uint8_t)c);
+            }
+            benchKeep(p.end());
+        });
+        const double after = benchNs(ITERATIONS, [&]() {
+            JSONStreamParser p(h, buf, sizeof(buf));
+            p.write((const uint8_t*)json.data(), json.size());
+            benchKeep(p.end());
+        });
+        benchReport(escapes ? "stream, escapes" : "stream, no escapes", before, after);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_scan_special_characters);
+    RUN_TEST(test_unescape);
+    RUN_TEST(test_stream_strings);
+    RUN_TEST(bench_strings);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include "unity.h"
+#include "bench.h"
+#include "inject_messages.h"
+
+#include "wiring_json.h"
+
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+static const unsigned ITERATIONS = 20000;
+
+static size_t corpusSize() {
+    size_t size = 0;
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        size += strlen(INJECT_MESSAGES[i]);
+    }
+    return size;
+}
+
+// Runs fn() over every message of the corpus and reports the throughput
+template<typename F>
+static void benchCorpus(const char* name, F fn) {
+    std::vector<std::string> msgs(INJECT_MESSAGES, INJECT_MESSAGES + INJECT_MESSAGES_COUNT);
+    std::vector<std::vector<char>> bufs;
+    for (const std::string& msg: msgs) {
+        bufs.emplace_back(msg.size() + 1);
+    }
+    const double ns = benchNs(ITERATIONS, [&]() {
+        for (size_t i = 0; i < msgs.size(); ++i) {
+            memcpy(bufs[i].data(), msgs[i].data(), msgs[i].size()); // Restore data parsed in place
+            fn(bufs[i].data(), msgs[i].size());
+        }
+    });
+    printf("%-28s %10.1f ns  %7.1f MB/s\n", name, ns, corpusSize() * 1000.0 / ns);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_corpus() {
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const std::string msg = INJECT_MESSAGES[i];
+        TEST_ASSERT_TRUE(JSONValue::parseCopy(msg.data(), msg.size()).isObject());
+        char buf[64];
+        JSONStreamHandler handler;
+        JSONStreamParser parser(handler, buf, sizeof(buf));
+        TEST_ASSERT_EQUAL(msg.size(), parser.write((const uint8_t*)msg.data(), msg.size()));
+        TEST_ASSERT_TRUE(parser.end());
+    }
+}
+
+void bench_throughput() {
+    printf("\n%u messages, %u bytes\n", (unsigned)INJECT_MESSAGES_COUNT, (unsigned)corpusSize());
+    benchCorpus("JSONValue::parse()", [](char* json, size_t size) {
+        benchKeep(JSONValue::parse(json, size));
+    });
+    benchCorpus("JSONValue::parseCopy()", [](char* json, size_t size) {
+        benchKeep(JSONValue::parseCopy(json, size));
+    });
+    benchCorpus("StaticJSONDocument<32>", [](char* json, size_t size) {
+        StaticJSONDocument<32> doc;
+        benchKeep(doc.parse(json, size));
+    });
+    benchCorpus("JSONStreamParser", [](char* json, size_t size) {
+        char buf[64];
+        JSONStreamHandler handler;
+        JSONStreamParser parser(handler, buf, sizeof(buf));
+        parser.write((const uint8_t*)json, size);
+        benchKeep(parser.end());
+    });
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_corpus);
+    RUN_TEST(bench_throughput);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
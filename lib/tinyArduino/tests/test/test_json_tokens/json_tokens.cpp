@@ -0,0 +1,258 @@
+#include "unity.h"
+#include "inject_messages.h"
+
+#include "wiring_json.h"
+
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace spark;
+
+// Token arena that JSONValue::parse() keeps on the stack
+static const size_t TOKEN_ARENA_SIZE = 32;
+
+static size_t heapBytes = 0;
+static size_t peakHeapBytes = 0;
+
+// All forms of operator new go through this, since operator delete expects the size header
+static void* allocate(size_t size) {
+    // Block size is stored in front of the block so that deallocation can account for it
+    size_t* p = (size_t*)malloc(size + sizeof(size_t));
+    if (!p) {
+        return nullptr;
+    }
+    *p = size;
+    heapBytes += size;
+    if (heapBytes > peakHeapBytes) {
+        peakHeapBytes = heapBytes;
+    }
+    return p + 1;
+}
+
+void* operator new(size_t size) {
+    if (void* p = allocate(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    if (p) {
+        size_t* block = (size_t*)((uintptr_t)p - sizeof(size_t));
+        heapBytes -= *block;
+        free(block);
+    }
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    operator delete(p);
+}
+
+static int tokenize(const std::string& json, std::vector<jsmntok_t>* tokens) {
+    jsmn_parser parser;
+    jsmn_init(&parser, nullptr);
+    return jsmn_parse(&parser, json.data(), json.size(), tokens->data(), tokens->size(), nullptr);
+}
+
+// Returns true if both values have the same structure and contents
+static bool isSameValue(const JSONValue& a, const JSONValue& b) {
+    if (a.type() != b.type()) {
+        return false;
+    }
+    if (a.isArray()) {
+        JSONArrayIterator ia(a), ib(b);
+        while (ia.next()) {
+            if (!ib.next() || !isSameValue(ia.value(), ib.value())) {
+                return false;
+            }
+        }
+        return !ib.next();
+    }
+    if (a.isObject()) {
+        JSONObjectIterator ia(a), ib(b);
+        while (ia.next()) {
+            if (!ib.next() || ia.name() != ib.name() || !isSameValue(ia.value(), ib.value())) {
+                return false;
+            }
+        }
+        return !ib.next();
+    }
+    return a.toString() == b.toString();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_token_layout() {
+#ifdef JSMN_COMPACT_TOKENS
+    TEST_ASSERT_EQUAL(8, sizeof(jsmntok_t));
+#endif
+    // All types survive packing
+    JSONValue v = JSONValue::parseCopy("{\"a\":[1,\"s\",null,true,{}]}");
+    JSONArrayIterator it(v.get("a"));
+    const JSONType types[] = { JSON_TYPE_NUMBER, JSON_TYPE_STRING, JSON_TYPE_NULL, JSON_TYPE_BOOL, JSON_TYPE_OBJECT };
+    for (JSONType type: types) {
+        TEST_ASSERT_TRUE(it.next());
+        TEST_ASSERT_EQUAL(type, it.value().type());
+    }
+    TEST_ASSERT_FALSE(it.next());
+}
+
+void test_large_documents() {
+    // Positions and sizes close to the limits of the compact layout
+    std::string json = "[\"" + std::string(40000, 'a') + "\",";
+    for (int i = 0; i < 12500; ++i) {
+        json += "1,";
+    }
+    json += "{\"k\":\"" + std::string(521, 'b') + "\"}]";
+    TEST_ASSERT_EQUAL(0xfffe, json.size()); // Longest document with compact tokens
+    JSONValue v = JSONValue::parseCopy(json.data(), json.size());
+    TEST_ASSERT_TRUE(v.isArray());
+    JSONArrayIterator it(v);
+    TEST_ASSERT_EQUAL(1 + 12500 + 1, it.count());
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_EQUAL(40000, it.value().toString().size());
+    for (int i = 0; i < 12500; ++i) {
+        TEST_ASSERT_TRUE(it.next());
+        TEST_ASSERT_EQUAL(1, it.value().toInt());
+    }
+    TEST_ASSERT_TRUE(it.next());
+    TEST_ASSERT_EQUAL(521, it.value().get("k").toString().size());
+
+    std::vector<jsmntok_t> tokens(40000);
+    std::string arr = "[";
+    for (int i = 0; i < 0x3fff; ++i) {
+        arr += "0,";
+    }
+    arr += "0]";
+#ifdef JSMN_COMPACT_TOKENS
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL, tokenize(arr, &tokens)); // Too many children
+    TEST_ASSERT_EQUAL(JSMN_ERROR_INVAL, tokenize(json + " ", &tokens)); // Too long
+#else
+    TEST_ASSERT_EQUAL(0x4001, tokenize(arr, &tokens));
+    TEST_ASSERT_TRUE(tokenize(json + " ", &tokens) > 0);
+#endif
+    arr.erase(arr.size() - 3, 2);
+    TEST_ASSERT_EQUAL(0x4000, tokenize(arr, &tokens));
+    TEST_ASSERT_EQUAL(0x3fff, tokens[0].size);
+    TEST_ASSERT_EQUAL(0x4000, tokens[0].skip);
+}
+
+void test_parse_copy() {
+    std::vector<std::string> docs(INJECT_MESSAGES, INJECT_MESSAGES + INJECT_MESSAGES_COUNT);
+    docs.push_back("{\n  \"a\" : [ 1, -2.5e3 , true,false, null ],\n  \"b\\n\" : { \"\" : \"\\u0041\\\"\" },\n  \"c\":{}, \"d\":[[]]\n}");
+    docs.push_back("[]");
+    docs.push_back("\"\"");
+    docs.push_back("  123  ");
+    docs.push_back("-1");
+    for (const std::string& doc: docs) {
+        std::string buf = doc + " ";
+        JSONValue a = JSONValue::parse(&buf[0], doc.size());
+        JSONValue b = JSONValue::parseCopy(doc.data(), doc.size());
+        TEST_ASSERT_TRUE(a.isValid());
+        TEST_ASSERT_TRUE(isSameValue(a, b));
+    }
+
+    // The original data can be released right after parsing
+    std::string* doc = new std::string("{ \"key\" : \"value\", \"list\" : [ 1, 2, 3 ] }");
+    JSONValue v = JSONValue::parseCopy(doc->data(), doc->size());
+    memset(&(*doc)[0], ' ', doc->size());
+    delete doc;
+    TEST_ASSERT_TRUE(v.get("key").toString() == "value");
+    JSONArrayIterator it(v.get("list"));
+    TEST_ASSERT_EQUAL(3, it.count());
+    TEST_ASSERT_TRUE(it.next() && it.value().toInt() == 1);
+
+    // Only the contents of strings and primitives are kept, so formatting takes no memory
+    const std::string pretty = "{\n    \"t\": \"set\",\n    \"port\": 443,\n    \"save\": true\n}\n";
+    const std::string compact = "{\"t\":\"set\",\"port\":443,\"save\":true}";
+    v = JSONValue();
+    heapBytes = 0;
+    v = JSONValue::parseCopy(pretty.data(), pretty.size());
+    const size_t prettyBytes = heapBytes;
+    v = JSONValue();
+    heapBytes = 0;
+    v = JSONValue::parseCopy(compact.data(), compact.size());
+    TEST_ASSERT_EQUAL(prettyBytes, heapBytes);
+}
+
+void bench_peak_ram() {
+    printf("\n%u-byte tokens\n", (unsigned)sizeof(jsmntok_t));
+    size_t total = 0;
+    for (size_t i = 0; i < INJECT_MESSAGES_COUNT; ++i) {
+        const std::string msg = INJECT_MESSAGES[i];
+        heapBytes = 0;
+        peakHeapBytes = 0;
+        size_t tokens = 0;
+        {
+            JSONValue v = JSONValue::parseCopy(msg.data(), msg.size());
+            TEST_ASSERT_TRUE(v.isObject());
+            TEST_ASSERT_TRUE(v.get("t").isString());
+            JSONObjectIterator it(v);
+            tokens = 1 + it.count() * 2;
+        }
+        const size_t peak = peakHeapBytes + TOKEN_ARENA_SIZE * sizeof(jsmntok_t);
+        total += peak;
+        printf("message #%u (%uB, %u tokens): %u B heap + %u B stack arena = %u B\n", (unsigned)i,
+                (unsigned)msg.size(), (unsigned)tokens, (unsigned)peakHeapBytes,
+                (unsigned)(TOKEN_ARENA_SIZE * sizeof(jsmntok_t)), (unsigned)peak);
+    }
+    printf("total: %u B\n", (unsigned)total);
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_token_layout);
+    RUN_TEST(test_large_documents);
+    RUN_TEST(test_parse_copy);
+    RUN_TEST(bench_peak_ram);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
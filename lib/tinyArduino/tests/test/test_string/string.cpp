@@ -0,0 +1,361 @@
+#include "unity.h"
+#include "bench.h"
+#include "alloc_count.h"
+
+#include "WString.h"
+
+#include <string>
+#include <utility>
+
+static const unsigned ITERATIONS = 10000;
+
+// Number of characters that fit into a String without allocating memory
+static const unsigned SSO = String::SSO_CAPACITY;
+
+// Exposes the capacity of a String
+class StringProbe: public String {
+public:
+    static unsigned capacityOf(const String& s) {
+        return s.*(&StringProbe::capacity);
+    }
+};
+
+static void assertString(const char* expected, const String& s) {
+    TEST_ASSERT_TRUE((bool)s);
+    TEST_ASSERT_EQUAL(strlen(expected), s.length());
+    TEST_ASSERT_EQUAL_STRING(expected, s.c_str());
+}
+
+static void assertString(const std::string& expected, const String& s) {
+    assertString(expected.c_str(), s);
+}
+
+static void assertNoAllocs(unsigned long allocs) {
+    if (ALLOC_COUNT_SUPPORTED) {
+        TEST_ASSERT_EQUAL(0, allocs);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_short_strings() {
+    // Typical values, up to a 32-character auth token, are stored in the object
+    const std::string values[] = {
+        "", "wifi", "ready", "AA:BB:CC:DD:EE:FF", "192.168.100.200", "Uj5kVnR0cW1hT3p1Y2ZxWkxRUFNkVgQz",
+        std::string(SSO, 's')
+    };
+    for (const std::string& val: values) {
+        assertNoAllocs(countAllocs([&]() {
+            String s = val.c_str();
+            assertString(val, s);
+            String copy = s;
+            assertString(val, copy);
+            String moved = std::move(s);
+            assertString(val, moved);
+            copy = moved;
+            copy += "";
+            assertString(val, copy);
+        }));
+    }
+    assertNoAllocs(countAllocs([]() {
+        String s;
+        s = "a";
+        s += 'b';
+        s += 123;
+        s += String("-suffix");
+        assertString("ab123-suffix", s);
+        s.replace("123", "0123456789");
+        assertString("ab0123456789-suffix", s);
+        s.remove(2, 10);
+        s.toUpperCase();
+        assertString("AB-SUFFIX", s);
+        assertString("SUFFIX", s.substring(3));
+    }));
+}
+
+void test_long_strings() {
+    const std::string val(SSO + 1, 'l');
+    String s = val.c_str();
+    assertString(val, s);
+
+    // Moving a long string takes over its buffer
+    const char* buffer = s.c_str();
+    String moved = std::move(s);
+    assertString(val, moved);
+    TEST_ASSERT_EQUAL_PTR(buffer, moved.c_str());
+
+    // Moving a short string into a long one reuses the buffer of the latter
+    String shortStr = "short";
+    moved = std::move(shortStr);
+    assertString("short", moved);
+    TEST_ASSERT_EQUAL_PTR(buffer, moved.c_str());
+
+    // And vice versa
+    String longStr = val.c_str();
+    String target = "target";
+    target = std::move(longStr);
+    assertString(val, target);
+}
+
+void test_growth() {
+    // Appending moves a short string to the heap when it no longer fits
+    std::string expected;
+    String s;
+    for (unsigned i = 0; i < SSO * 3; ++i) {
+        const char c = 'a' + i % 26;
+        s += c;
+        expected += c;
+        assertString(expected, s);
+    }
+    String a = "0123456789";
+    a.replace("5", std::string(SSO, 'x').c_str());
+    assertString("01234" + std::string(SSO, 'x') + "6789", a);
+    String b = "short";
+    TEST_ASSERT_TRUE(b.reserve(SSO * 2));
+    assertString("short", b);
+    b += std::string(SSO, 'y').c_str();
+    assertString("short" + std::string(SSO, 'y'), b);
+}
+
+void test_geometric_growth() {
+    // Appending character by character reallocates a logarithmic number of times
+    const unsigned long allocs = countAllocs([]() {
+        String s;
+        for (int i = 0; i < 10000; ++i) {
+            s += (char)('a' + i % 26);
+        }
+        TEST_ASSERT_EQUAL(10000, s.length());
+        TEST_ASSERT_TRUE(StringProbe::capacityOf(s) < 15000);
+    });
+    if (ALLOC_COUNT_SUPPORTED) {
+        TEST_ASSERT_TRUE(allocs <= 20);
+    }
+    // reserve() allocates exactly what is asked for
+    String s;
+    TEST_ASSERT_TRUE(s.reserve(100));
+    TEST_ASSERT_EQUAL(100, StringProbe::capacityOf(s));
+    s = std::string(100, 'r').c_str();
+    s += 'r';
+    TEST_ASSERT_EQUAL(150, StringProbe::capacityOf(s));
+    assertString(std::string(101, 'r'), s);
+}
+
+void test_shrink_to_fit() {
+    String s = std::string(100, 's').c_str();
+    s += "tail";
+    TEST_ASSERT_TRUE(StringProbe::capacityOf(s) > s.length());
+    TEST_ASSERT_TRUE(s.shrink_to_fit());
+    TEST_ASSERT_EQUAL(s.length(), StringProbe::capacityOf(s));
+    assertString(std::string(100, 's') + "tail", s);
+    // Short strings move back into the object
+    s.remove(10);
+    TEST_ASSERT_TRUE(s.shrink_to_fit());
+    TEST_ASSERT_EQUAL(SSO, StringProbe::capacityOf(s));
+    assertString(std::string(10, 's'), s);
+    assertNoAllocs(countAllocs([&]() {
+        TEST_ASSERT_TRUE(s.shrink_to_fit());
+        s += "more";
+    }));
+    assertString(std::string(10, 's') + "more", s);
+    // Invalid strings stay invalid
+    String invalid((const char*)nullptr, 0);
+    TEST_ASSERT_TRUE(invalid.shrink_to_fit());
+    TEST_ASSERT_FALSE((bool)invalid);
+}
+
+static String join(const String& s) {
+    return s;
+}
+
+static String deviceName(const String& prefix, const String& name, const String& unique) {
+    return prefix + " " + name + "-" + unique;
+}
+
+void test_concatenation() {
+    const String prefix = "Blynk", name = "Smart Irrigation Controller", unique = "X7Q2";
+    const char* fw = "0.1.0";
+    assertString("Blynk Smart Irrigation Controller-X7Q2", deviceName(prefix, name, unique));
+    assertString("Firmware updated from 0.1.0 to 0.2.0", String("Firmware updated from ") + fw + " to " + "0.2.0");
+
+    // Operands of all types, on either side
+    assertString("a:1,2,3,4,5,-6,1.50,2.25", prefix.substring(0, 0) + "a" + ':' + (unsigned char)1 + ',' + 2 +
+            ',' + 3u + ',' + 4l + ',' + 5ul + ',' + (-6) + ',' + 1.5f + ',' + 2.25);
+    assertString("1Blynk", 1 + prefix);
+    assertString("xBlynk", 'x' + prefix);
+    assertString("pre-Blynk", "pre-" + prefix);
+    assertString("BlynkBlynk", prefix + prefix);
+    assertString("Blynk X7Q2-X7Q2", prefix + (" " + unique + "-" + unique));
+    assertString("Blynk1", StringSumHelper(prefix) + 1);
+    assertString("Blynk", join(prefix + ""));
+
+    // Expressions can be used like the strings they produce
+    TEST_ASSERT_EQUAL(10, (prefix + "-" + unique).length());
+    TEST_ASSERT_EQUAL_STRING("Blynk-X7Q2", (prefix + "-" + unique).c_str());
+    String s = "s";
+    s = s + s + "-" + s;
+    assertString("ss-s", s);
+    s += prefix + unique;
+    assertString("ss-sBlynkX7Q2", s);
+
+    // Comparisons and the String methods that don't modify the string
+    TEST_ASSERT_TRUE((prefix + unique) == "BlynkX7Q2");
+    TEST_ASSERT_TRUE((prefix + unique) == String("BlynkX7Q2"));
+    TEST_ASSERT_TRUE("BlynkX7Q2" == prefix + unique);
+    TEST_ASSERT_TRUE((prefix + unique) != "Blynk");
+    TEST_ASSERT_TRUE((prefix + "-" + unique) == (prefix + "-" + unique));
+    TEST_ASSERT_TRUE(prefix < prefix + "a" && prefix + "a" > prefix);
+    TEST_ASSERT_TRUE(prefix + "a" <= prefix + "a" && prefix + "a" >= prefix + "a");
+    TEST_ASSERT_TRUE(prefix + "a" != prefix + "b" && prefix + "a" < prefix + "b");
+    TEST_ASSERT_EQUAL(5, (prefix + "-" + unique).indexOf('-'));
+    TEST_ASSERT_EQUAL(8, (prefix + "-" + unique).indexOf("Q", 2));
+    TEST_ASSERT_EQUAL(7, (unique + "-" + unique).lastIndexOf('Q'));
+    TEST_ASSERT_TRUE((prefix + unique).equals("BlynkX7Q2"));
+    TEST_ASSERT_TRUE((prefix + unique).equalsIgnoreCase("blynkx7q2"));
+    TEST_ASSERT_TRUE((prefix + unique).startsWith(prefix) && (prefix + unique).endsWith(unique));
+    TEST_ASSERT_EQUAL('X', (prefix + unique).charAt(5));
+    TEST_ASSERT_EQUAL('7', (prefix + unique)[6]);
+    assertString("X7", (prefix + unique).substring(5, 7));
+    TEST_ASSERT_EQUAL(-42, (String("-") + 42).toInt());
+    TEST_ASSERT_TRUE((String("1.") + 5).toFloat() == 1.5f);
+    TEST_ASSERT_TRUE(prefix + unique);
+    TEST_ASSERT_FALSE(prefix + (const char*)nullptr);
+
+    // Invalid operands make the result invalid
+    TEST_ASSERT_FALSE((bool)String(prefix + (const char*)nullptr));
+    TEST_ASSERT_FALSE((bool)String(String((const char*)nullptr, 0) + "a"));
+
+    // The result is allocated once, even if it doesn't fit into the object
+    const std::string part(SSO, 'p');
+    const std::string expected = part + "-" + part + "-123-" + part;
+    const String longPart = part.c_str();
+    const unsigned long allocs = countAllocs([&]() {
+        String r = longPart + "-" + longPart + "-" + 123 + "-" + longPart;
+        assertString(expected.c_str(), r);
+    });
+    if (ALLOC_COUNT_SUPPORTED) {
+        TEST_ASSERT_EQUAL(1, allocs);
+    }
+}
+
+void test_invalid() {
+    String s((const char*)nullptr, 0);
+    TEST_ASSERT_FALSE((bool)s);
+    s = "valid";
+    assertString("valid", s);
+    s = (const char*)nullptr;
+    TEST_ASSERT_FALSE((bool)s);
+    String t = std::move(s);
+    TEST_ASSERT_FALSE((bool)t);
+    TEST_ASSERT_TRUE(t.reserve(0));
+    assertString("", t);
+}
+
+// Builds a log line of about 1.5 KB out of small pieces
+static void buildLine(String& s, bool exact) {
+    for (int i = 0; i < 100; ++i) {
+        if (exact) {
+            s.reserve(s.length() + 6); // Exact size, as concatenation used to allocate
+        }
+        s += "value=";
+        if (exact) {
+            s.reserve(s.length() + 5);
+        }
+        s += i * 37;
+        if (exact) {
+            s.reserve(s.length() + 2);
+        }
+        s += "; ";
+    }
+}
+
+void bench_append() {
+    printf("\n");
+    unsigned long beforeAllocs = 0, afterAllocs = 0;
+    const double before = benchNs(ITERATIONS, [&]() {
+        String s;
+        beforeAllocs = countAllocs([&]() { buildLine(s, true); });
+        benchKeep(s);
+    });
+    const double after = benchNs(ITERATIONS, [&]() {
+        String s;
+        afterAllocs = countAllocs([&]() { buildLine(s, false); });
+        benchKeep(s);
+    });
+    benchReport("300 appends, exact -> x1.5", before, after);
+    if (ALLOC_COUNT_SUPPORTED) {
+        printf("300 appends, allocations      %10lu    -> %10lu\n", beforeAllocs, afterAllocs);
+    }
+}
+
+// Concatenates a device name the way operator + used to, by appending to a copy of the first operand
+static String eagerDeviceName(const String& prefix, const String& name, const String& unique) {
+    StringSumHelper s(prefix);
+    s.concat(" ");
+    s.concat(name);
+    s.concat("-");
+    s.concat(unique);
+    return s;
+}
+
+void bench_concatenation() {
+    printf("\n");
+    const String prefix = "Blynk", name = "Smart Irrigation Controller", unique = "X7Q2";
+    unsigned long beforeAllocs = 0, afterAllocs = 0;
+    const double before = benchNs(ITERATIONS * 10, [&]() {
+        beforeAllocs = countAllocs([&]() { benchKeep(eagerDeviceName(prefix, name, unique)); });
+    });
+    const double after = benchNs(ITERATIONS * 10, [&]() {
+        afterAllocs = countAllocs([&]() { benchKeep(deviceName(prefix, name, unique)); });
+    });
+    benchReport("a + \" \" + b + \"-\" + c, 38B", before, after);
+    if (ALLOC_COUNT_SUPPORTED) {
+        printf("a + \" \" + b + \"-\" + c, allocs %10lu    -> %10lu\n", beforeAllocs, afterAllocs);
+    }
+
+    // A longer message outgrows the first operand several times
+    const String longName = std::string(60, 'n').c_str();
+    const double beforeLong = benchNs(ITERATIONS * 10, [&]() {
+        beforeAllocs = countAllocs([&]() { benchKeep(eagerDeviceName(longName, longName, longName)); });
+    });
+    const double afterLong = benchNs(ITERATIONS * 10, [&]() {
+        afterAllocs = countAllocs([&]() { benchKeep(deviceName(longName, longName, longName)); });
+    });
+    benchReport("a + \" \" + b + \"-\" + c, 182B", beforeLong, afterLong);
+    if (ALLOC_COUNT_SUPPORTED) {
+        printf("a + \" \" + b + \"-\" + c, allocs %10lu    -> %10lu\n", beforeAllocs, afterAllocs);
+    }
+}
+
+int runUnityTests(void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_short_strings);
+    RUN_TEST(test_long_strings);
+    RUN_TEST(test_growth);
+    RUN_TEST(test_geometric_growth);
+    RUN_TEST(test_shrink_to_fit);
+    RUN_TEST(test_concatenation);
+    RUN_TEST(test_invalid);
+    RUN_TEST(bench_append);
+    RUN_TEST(bench_concatenation);
+    return UNITY_END();
+}
+
+#ifdef ARDUINO
+
+void setup() {
+    delay(1000);
+
+    runUnityTests();
+}
+
+void loop() {
+}
+
+#else
+
+int main() {
+    return runUnityTests();
+}
+
+#endif
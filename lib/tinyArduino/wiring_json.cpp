@@ -16,10 +16,12 @@
  */
 
 #include "wiring_json.h"
+#include "JSONNumber.h"
 
 #include <algorithm>
 #include <limits>
 
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 #include <cstdarg>
@@ -30,17 +32,7 @@ namespace {
 
 // Skips token and all its children tokens if any
 const jsmntok_t* skipToken(const jsmntok_t *t) {
-    size_t n = 1;
-    do {
-        if (t->type == JSMN_OBJECT) {
-            n += t->size * 2; // Number of name and value tokens
-        } else if (t->type == JSMN_ARRAY) {
-            n += t->size; // Number of value tokens
-        }
-        ++t;
-        --n;
-    } while (n);
-    return t;
+    return t + t->skip;
 }
 
 bool hexToInt(const char *s, size_t size, uint32_t *val) {
@@ -75,6 +67,40 @@ double toFinite(double val) {
     return val;
 }
 
+// Number of tokens the tokenizer can store on the stack before falling back to the heap. This is
+// enough for any provisioning message, e.g. a "set" message with all keys takes 27 tokens
+const size_t TOKEN_ARENA_SIZE = 32;
+
+// Copies contents of string and primitive tokens to a newly allocated buffer, packed one after
+// another, and updates the tokens to point into it. Every value is followed by a spare character
+// for the term. null character (see stringize() method)
+char* copyTokenData(jsmntok_t *tokens, size_t count, const char *json) {
+    const jsmntok_t* const end = tokens + count;
+    size_t size = 0;
+    for (const jsmntok_t *t = tokens; t != end; ++t) {
+        if (t->type == JSMN_STRING || t->type == JSMN_PRIMITIVE) {
+            size += t->end - t->start + 1;
+        }
+    }
+    char* const data = new(std::nothrow) char[size ? size : 1];
+    if (!data) {
+        return nullptr;
+    }
+    size_t pos = 0;
+    for (jsmntok_t *t = tokens; t != end; ++t) {
+        if (t->type == JSMN_STRING || t->type == JSMN_PRIMITIVE) {
+            const size_t n = t->end - t->start;
+            memcpy(data + pos, json + t->start, n);
+            t->start = pos;
+            t->end = pos + n;
+            pos += n + 1;
+        } else {
+            t->start = t->end = pos; // Arrays and objects have no contents of their own
+        }
+    }
+    return data;
+}
+
 } // namespace
 
 // spark::detail::JSONData
@@ -98,26 +124,27 @@ struct spark::detail::JSONData {
 };
 
 // spark::JSONValue
-spark::JSONValue::JSONValue(const jsmntok_t *t, detail::JSONDataPtr d) :
+spark::JSONValue::JSONValue(const jsmntok_t *t, const char *json, detail::JSONDataPtr d) :
         JSONValue() {
     if (t) {
         t_ = t;
-        d_ = d;
+        j_ = json;
+        d_ = std::move(d);
     }
 }
 
 bool spark::JSONValue::toBool() const {
     switch (type()) {
     case JSON_TYPE_BOOL: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return *s == 't';
     }
     case JSON_TYPE_NUMBER: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return strcmp(s, "0") != 0 && strcmp(s, "0.0") != 0;
     }
     case JSON_TYPE_STRING: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         if (*s == '\0' || strcmp(s, "false") == 0 || strcmp(s, "0") == 0 || strcmp(s, "0.0") == 0) {
             return false; // Empty string, "false", "0" or "0.0"
         }
@@ -131,14 +158,18 @@ bool spark::JSONValue::toBool() const {
 int spark::JSONValue::toInt() const {
     switch (type()) {
     case JSON_TYPE_BOOL: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return *s == 't';
     }
     case JSON_TYPE_NUMBER:
     case JSON_TYPE_STRING: {
         // toInt() may produce incorrect results for floating point numbers, since we want to keep
         // compile-time dependency on strtod() optional
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
+        long long v = 0;
+        if (detail::parseInt64(s, j_ + t_->end, &v) && v >= LONG_MIN && v <= LONG_MAX) {
+            return (long)v;
+        }
         return strtol(s, nullptr, 10);
     }
     default:
@@ -149,14 +180,18 @@ int spark::JSONValue::toInt() const {
 unsigned spark::JSONValue::toUInt() const {
     switch (type()) {
     case JSON_TYPE_BOOL: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return *s == 't';
     }
     case JSON_TYPE_NUMBER:
     case JSON_TYPE_STRING: {
         // toInt() may produce incorrect results for floating point numbers, since we want to keep
         // compile-time dependency on strtod() optional
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
+        unsigned long long v = 0;
+        if (detail::parseUInt64(s, j_ + t_->end, &v) && v <= ULONG_MAX) {
+            return (unsigned long)v;
+        }
         return strtoul(s, nullptr, 10);
     }
     default:
@@ -167,14 +202,18 @@ unsigned spark::JSONValue::toUInt() const {
 long long spark::JSONValue::toInt64() const {
     switch (type()) {
     case JSON_TYPE_BOOL: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return *s == 't';
     }
     case JSON_TYPE_NUMBER:
     case JSON_TYPE_STRING: {
         // toInt() may produce incorrect results for floating point numbers, since we want to keep
         // compile-time dependency on strtod() optional
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
+        long long v = 0;
+        if (detail::parseInt64(s, j_ + t_->end, &v)) {
+            return v;
+        }
         return strtoll(s, nullptr, 10);
     }
     default:
@@ -185,14 +224,18 @@ long long spark::JSONValue::toInt64() const {
 unsigned long long spark::JSONValue::toUInt64() const {
     switch (type()) {
     case JSON_TYPE_BOOL: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return *s == 't';
     }
     case JSON_TYPE_NUMBER:
     case JSON_TYPE_STRING: {
         // toInt() may produce incorrect results for floating point numbers, since we want to keep
         // compile-time dependency on strtod() optional
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
+        unsigned long long v = 0;
+        if (detail::parseUInt64(s, j_ + t_->end, &v)) {
+            return v;
+        }
         return strtoull(s, nullptr, 10);
     }
     default:
@@ -203,12 +246,16 @@ unsigned long long spark::JSONValue::toUInt64() const {
 double spark::JSONValue::toDouble() const {
     switch (type()) {
     case JSON_TYPE_BOOL: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
         return *s == 't';
     }
     case JSON_TYPE_NUMBER:
     case JSON_TYPE_STRING: {
-        const char* const s = d_->json + t_->start;
+        const char* const s = j_ + t_->start;
+        double v = 0;
+        if (detail::parseDouble(s, j_ + t_->end, &v)) {
+            return v;
+        }
         return strtod(s, nullptr);
     }
     default:
@@ -222,7 +269,7 @@ spark::JSONType spark::JSONValue::type() const {
     }
     switch (t_->type) {
     case JSMN_PRIMITIVE: {
-        const char c = d_->json[t_->start];
+        const char c = j_[t_->start];
         if (c == '-' || (c >= '0' && c <= '9')) {
             return JSON_TYPE_NUMBER;
         } else if (c == 't' || c == 'f') { // Literal names are always in lower case
@@ -243,6 +290,26 @@ spark::JSONType spark::JSONValue::type() const {
     }
 }
 
+spark::JSONValue spark::JSONValue::get(const char *name) const {
+    return get(name, strlen(name));
+}
+
+spark::JSONValue spark::JSONValue::get(const char *name, size_t size) const {
+    if (!t_ || t_->type != JSMN_OBJECT) {
+        return JSONValue();
+    }
+    const jsmntok_t *k = t_ + 1; // Name of the first property
+    const jsmntok_t* const end = skipToken(t_);
+    for (int i = 0; i < t_->size && k + 1 < end; ++i) {
+        const jsmntok_t *v = k + 1;
+        if ((size_t)(k->end - k->start) == size && memcmp(j_ + k->start, name, size) == 0) {
+            return JSONValue(v, j_, d_);
+        }
+        k = skipToken(v);
+    }
+    return JSONValue();
+}
+
 spark::JSONValue spark::JSONValue::parse(char *json, size_t size) {
     detail::JSONDataPtr d(new(std::nothrow) detail::JSONData);
     if (!d) {
@@ -269,7 +336,7 @@ spark::JSONValue spark::JSONValue::parse(char *json, size_t size) {
     if (!stringize(d->tokens, tokenCount, d->json)) {
         return JSONValue();
     }
-    return JSONValue(t, d);
+    return JSONValue(t, d->json, d);
 }
 
 spark::JSONValue spark::JSONValue::parseCopy(const char *json, size_t size) {
@@ -281,35 +348,76 @@ spark::JSONValue spark::JSONValue::parseCopy(const char *json, size_t size) {
     if (!tokenize(json, size, &d->tokens, &tokenCount)) {
         return JSONValue();
     }
-    d->json = new(std::nothrow) char[size + 1];
+    d->json = copyTokenData(d->tokens, tokenCount, json);
     if (!d->json) {
         return JSONValue();
     }
-    memcpy(d->json, json, size); // TODO: Copy only token data
     d->freeJson = true;
     if (!stringize(d->tokens, tokenCount, d->json)) {
         return JSONValue();
     }
-    return JSONValue(d->tokens, d);
+    return JSONValue(d->tokens, d->json, d);
+}
+
+spark::JSONValue spark::JSONValue::parse(char *json, size_t size, jsmntok_t *tokens, size_t maxTokens) {
+    jsmn_parser parser;
+    parser.size = sizeof(jsmn_parser);
+    jsmn_init(&parser, nullptr);
+    if (jsmn_parse(&parser, json, size, tokens, maxTokens, nullptr) < 0 || !parser.toknext) {
+        return JSONValue(); // Parsing error or not enough tokens
+    }
+    if (tokens->type == JSMN_PRIMITIVE && (size_t)tokens->end >= size) {
+        return JSONValue(); // No room for term. null character (see stringize() method)
+    }
+    if (!stringize(tokens, parser.toknext, json)) {
+        return JSONValue();
+    }
+    return JSONValue(tokens, json, detail::JSONDataPtr());
 }
 
 bool spark::JSONValue::tokenize(const char *json, size_t size, jsmntok_t **tokens, size_t *count) {
+    // Tokens are parsed in a single pass: the parser starts with a small arena on the stack and,
+    // if the document doesn't fit, continues where it stopped with a larger arena allocated on
+    // the heap. The resulting token array is then allocated at its exact size
+    jsmntok_t arena[TOKEN_ARENA_SIZE];
+    std::unique_ptr<jsmntok_t[]> heapArena;
+    jsmntok_t *t = arena;
+    size_t maxCount = TOKEN_ARENA_SIZE;
     jsmn_parser parser;
     parser.size = sizeof(jsmn_parser);
     jsmn_init(&parser, nullptr);
-    const int n = jsmn_parse(&parser, json, size, nullptr, 0, nullptr); // Get number of tokens
-    if (n <= 0) {
-        return false; // Parsing error
+    for (;;) {
+        const int ret = jsmn_parse(&parser, json, size, t, maxCount, nullptr);
+        if (ret != JSMN_ERROR_NOMEM) {
+            if (ret < 0) {
+                return false; // Parsing error
+            }
+            break;
+        }
+        const size_t newMaxCount = maxCount * 2;
+        std::unique_ptr<jsmntok_t[]> newArena(new(std::nothrow) jsmntok_t[newMaxCount]);
+        if (!newArena) {
+            return false;
+        }
+        memcpy(newArena.get(), t, parser.toknext * sizeof(jsmntok_t));
+        heapArena = std::move(newArena);
+        t = heapArena.get();
+        maxCount = newMaxCount;
     }
-    std::unique_ptr<jsmntok_t[]> t(new(std::nothrow) jsmntok_t[n]);
-    if (!t) {
-        return false;
+    const size_t n = parser.toknext; // Total number of tokens
+    if (!n) {
+        return false; // Empty document
     }
-    jsmn_init(&parser, nullptr); // Reset parser
-    if (jsmn_parse(&parser, json, size, t.get(), n, nullptr) <= 0) {
-        return false;
+    if (t == arena || maxCount > n) {
+        // Copy the tokens out of the stack arena, or out of a heap arena with unused room
+        std::unique_ptr<jsmntok_t[]> exact(new(std::nothrow) jsmntok_t[n]);
+        if (!exact) {
+            return false;
+        }
+        memcpy(exact.get(), t, n * sizeof(jsmntok_t));
+        heapArena = std::move(exact);
     }
-    *tokens = t.release();
+    *tokens = heapArena.release();
     *count = n;
     return true;
 }
@@ -392,12 +500,16 @@ bool spark::JSONValue::unescape(jsmntok_t *t, char *json) {
                 s1 = s; // Skip escaped sequence
             }
         } else {
-            ++s;
+            // Skip to the next escaped sequence, memchr() compares a word at a time
+            const char *e = (const char*)memchr(s, '\\', end - s);
+            s = e ? e : end;
         }
     }
     if (s != s1) {
         const size_t n = s - s1;
-        memmove(str, s1, n); // Shift remaining characters
+        if (str != s1) {
+            memmove(str, s1, n); // Shift remaining characters
+        }
         str += n;
     }
     t->end = str - json; // Update string length
@@ -405,14 +517,14 @@ bool spark::JSONValue::unescape(jsmntok_t *t, char *json) {
 }
 
 // spark::JSONString
-spark::JSONString::JSONString(const jsmntok_t *t, detail::JSONDataPtr d) :
+spark::JSONString::JSONString(const jsmntok_t *t, const char *json, detail::JSONDataPtr d) :
         JSONString() {
     if (t && (t->type == JSMN_STRING || t->type == JSMN_PRIMITIVE)) {
-        if (t->type != JSMN_PRIMITIVE || d->json[t->start] != 'n') { // Nulls are treated as empty strings
-            s_ = d->json + t->start;
+        if (t->type != JSMN_PRIMITIVE || json[t->start] != 'n') { // Nulls are treated as empty strings
+            s_ = json + t->start;
             n_ = t->end - t->start;
         }
-        d_ = d;
+        d_ = std::move(d);
     }
 }
 
@@ -425,17 +537,20 @@ bool spark::JSONString::operator==(const JSONString &str) const {
 }
 
 // spark::JSONObjectIterator
-spark::JSONObjectIterator::JSONObjectIterator(const jsmntok_t *t, detail::JSONDataPtr d) :
+spark::JSONObjectIterator::JSONObjectIterator(const jsmntok_t *t, const char *json, detail::JSONDataPtr d) :
         JSONObjectIterator() {
     if (t && t->type == JSMN_OBJECT) {
         t_ = t + 1; // First property's name
+        end_ = skipToken(t);
         n_ = t->size; // Number of properties
-        d_ = d;
+        j_ = json;
+        d_ = std::move(d);
     }
 }
 
 bool spark::JSONObjectIterator::next() {
-    if (!n_) {
+    if (!n_ || t_ + 1 >= end_) { // Malformed documents may have fewer tokens than properties
+        n_ = 0;
         return false;
     }
     k_ = t_; // Name
@@ -449,17 +564,20 @@ bool spark::JSONObjectIterator::next() {
 }
 
 // spark::JSONArrayIterator
-spark::JSONArrayIterator::JSONArrayIterator(const jsmntok_t *t, detail::JSONDataPtr d) :
+spark::JSONArrayIterator::JSONArrayIterator(const jsmntok_t *t, const char *json, detail::JSONDataPtr d) :
         JSONArrayIterator() {
     if (t && t->type == JSMN_ARRAY) {
         t_ = t + 1; // First element
+        end_ = skipToken(t);
         n_ = t->size; // Number of elements
-        d_ = d;
+        j_ = json;
+        d_ = std::move(d);
     }
 }
 
 bool spark::JSONArrayIterator::next() {
-    if (!n_) {
+    if (!n_ || t_ >= end_) {
+        n_ = 0;
         return false;
     }
     v_ = t_;
@@ -470,6 +588,379 @@ bool spark::JSONArrayIterator::next() {
     return true;
 }
 
+// spark::JSONStreamParser
+size_t spark::JSONStreamParser::write(const uint8_t *data, size_t size) {
+    const char* const s = (const char*)data;
+    size_t i = 0;
+    while (i < size) {
+        if (state_ == STRING && !surrogate_) {
+            // Characters that need no processing are appended in bulk
+            const size_t end = jsmn_scan_string(s, i, size);
+            if (end != i) {
+                if (!append(s + i, end - i)) {
+                    return i;
+                }
+                i = end;
+                continue;
+            }
+        }
+        if (!parse(s[i])) {
+            return i;
+        }
+        ++i;
+    }
+    return size;
+}
+
+bool spark::JSONStreamParser::end() {
+    if (state_ == PRIMITIVE && depth_ == 0) {
+        endPrimitive(); // Document consists of a single primitive value
+    }
+    if (state_ != DONE) {
+        state_ = ERROR;
+        return false;
+    }
+    return true;
+}
+
+void spark::JSONStreamParser::reset() {
+    n_ = 0;
+    objects_ = 0;
+    codePoint_ = 0;
+    skipDepth_ = 0;
+    surrogate_ = 0;
+    depth_ = 0;
+    hexDigits_ = 0;
+    // The buffer needs room for at least one character and the term. null character
+    state_ = (bufSize_ < 2) ? ERROR : VALUE;
+    isName_ = false;
+    isNumberPart_ = false;
+}
+
+bool spark::JSONStreamParser::parse(char c) {
+    switch (state_) {
+    case STRING:
+        if (c == '"') {
+            return endString();
+        } else if (c == '\\') {
+            state_ = ESCAPE;
+            return true;
+        } else if ((unsigned char)c < 0x20) {
+            break; // Control characters must be escaped
+        } else if (surrogate_ && !appendPendingSurrogate()) {
+            break;
+        }
+        return append(c);
+    case ESCAPE: {
+        char e = 0;
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            e = c;
+            break;
+        case 'b': // Backspace
+            e = 0x08;
+            break;
+        case 't': // Tab
+            e = 0x09;
+            break;
+        case 'n': // Line feed
+            e = 0x0a;
+            break;
+        case 'f': // Form feed
+            e = 0x0c;
+            break;
+        case 'r': // Carriage return
+            e = 0x0d;
+            break;
+        case 'u': // Arbitrary character, e.g. "\u001f"
+            codePoint_ = 0;
+            hexDigits_ = 0;
+            state_ = UNICODE;
+            return true;
+        default:
+            break; // Invalid escaped sequence
+        }
+        if (!e || (surrogate_ && !appendPendingSurrogate())) {
+            break;
+        }
+        state_ = STRING;
+        return append(e);
+    }
+    case UNICODE: {
+        uint32_t d = 0;
+        if (!hexToInt(&c, 1, &d)) {
+            break; // Invalid escaped sequence
+        }
+        codePoint_ = (codePoint_ << 4) | d;
+        if (++hexDigits_ < 4) {
+            return true;
+        }
+        state_ = STRING;
+        if (codePoint_ >= 0xdc00 && codePoint_ <= 0xdfff && surrogate_) {
+            // Low surrogate of a surrogate pair
+            const uint32_t cp = 0x10000 + ((uint32_t)(surrogate_ - 0xd800) << 10) + (codePoint_ - 0xdc00);
+            surrogate_ = 0;
+            return appendCodePoint(cp);
+        }
+        if (surrogate_ && !appendPendingSurrogate()) {
+            break;
+        }
+        if (codePoint_ >= 0xd800 && codePoint_ <= 0xdbff) {
+            surrogate_ = codePoint_; // High surrogate, expecting low surrogate next
+            return true;
+        }
+        if (codePoint_ >= 0xdc00 && codePoint_ <= 0xdfff) {
+            return appendCodePoint(0xfffd); // Unpaired low surrogate
+        }
+        return appendCodePoint(codePoint_);
+    }
+    case PRIMITIVE:
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+                c == '-' || c == '+' || c == '.') {
+            if (n_ + 1 >= bufSize_) {
+                // Numbers are passed in parts like strings, literal names always fit
+                const char first = buf_[0];
+                if (!isNumberPart_ && first != '-' && (first < '0' || first > '9')) {
+                    break;
+                }
+                if (!flushPart()) {
+                    return false;
+                }
+                isNumberPart_ = true;
+            }
+            buf_[n_++] = c;
+            return true;
+        }
+        if (!endPrimitive()) {
+            break;
+        }
+        return parse(c); // Process the character that terminated the value
+    case SKIP:
+        if (c == '"') {
+            state_ = SKIP_STRING;
+        } else if (c == '{' || c == '[') {
+            ++skipDepth_;
+        } else if ((c == '}' || c == ']') && --skipDepth_ == 0) {
+            valueParsed();
+        }
+        return true;
+    case SKIP_STRING:
+        if (c == '"') {
+            state_ = SKIP;
+        } else if (c == '\\') {
+            state_ = SKIP_ESCAPE;
+        }
+        return true;
+    case SKIP_ESCAPE:
+        state_ = SKIP_STRING;
+        return true;
+    case ERROR:
+        return false;
+    default:
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            return true; // Skip whitespace
+        }
+        switch (state_) {
+        case FIRST_VALUE:
+            if (c == ']') {
+                return endCompound(false);
+            }
+            // Fall through
+        case VALUE:
+            if (parseValue(c)) {
+                return true;
+            }
+            break;
+        case FIRST_NAME:
+            if (c == '}') {
+                return endCompound(true);
+            }
+            // Fall through
+        case NAME:
+            if (c == '"') {
+                n_ = 0;
+                isName_ = true;
+                state_ = STRING;
+                return true;
+            }
+            break;
+        case COLON:
+            if (c == ':') {
+                state_ = VALUE;
+                return true;
+            }
+            break;
+        case NEXT: {
+            const bool object = objects_ & (1u << (depth_ - 1));
+            if (c == ',') {
+                state_ = object ? NAME : VALUE;
+                return true;
+            } else if (c == (object ? '}' : ']')) {
+                return endCompound(object);
+            }
+            break;
+        }
+        default: // DONE
+            break;
+        }
+        break;
+    }
+    state_ = ERROR;
+    return false;
+}
+
+bool spark::JSONStreamParser::parseValue(char c) {
+    if (c == '{' || c == '[') {
+        return beginCompound(c == '{');
+    }
+    if (c == '"') {
+        n_ = 0;
+        isName_ = false;
+        state_ = STRING;
+        return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        buf_[0] = c;
+        n_ = 1;
+        isName_ = false;
+        isNumberPart_ = false;
+        state_ = PRIMITIVE;
+        return true;
+    }
+    return false;
+}
+
+bool spark::JSONStreamParser::beginCompound(bool object) {
+    if (depth_ == MAX_DEPTH) {
+        skipDepth_ = 1;
+        state_ = SKIP;
+        return h_.value(object ? JSON_TYPE_OBJECT : JSON_TYPE_ARRAY, "", 0);
+    }
+    if (object) {
+        objects_ |= (1u << depth_);
+        state_ = FIRST_NAME;
+    } else {
+        objects_ &= ~(1u << depth_);
+        state_ = FIRST_VALUE;
+    }
+    ++depth_;
+    return object ? h_.beginObject() : h_.beginArray();
+}
+
+bool spark::JSONStreamParser::endCompound(bool object) {
+    --depth_;
+    valueParsed();
+    if (!(object ? h_.endObject() : h_.endArray())) {
+        state_ = ERROR;
+        return false;
+    }
+    return true;
+}
+
+bool spark::JSONStreamParser::endString() {
+    if (surrogate_ && !appendPendingSurrogate()) {
+        state_ = ERROR;
+        return false;
+    }
+    buf_[n_] = '\0';
+    bool ok = false;
+    if (isName_) {
+        state_ = COLON;
+        ok = h_.name(buf_, n_);
+    } else {
+        valueParsed();
+        ok = h_.value(JSON_TYPE_STRING, buf_, n_);
+    }
+    if (!ok) {
+        state_ = ERROR;
+    }
+    return ok;
+}
+
+bool spark::JSONStreamParser::endPrimitive() {
+    buf_[n_] = '\0';
+    JSONType type = JSON_TYPE_INVALID;
+    const char c = buf_[0];
+    if (isNumberPart_ || c == '-' || (c >= '0' && c <= '9')) {
+        type = JSON_TYPE_NUMBER;
+    } else if (strcmp(buf_, "true") == 0 || strcmp(buf_, "false") == 0) {
+        type = JSON_TYPE_BOOL;
+    } else if (strcmp(buf_, "null") == 0) {
+        type = JSON_TYPE_NULL;
+    }
+    if (type == JSON_TYPE_INVALID) {
+        state_ = ERROR;
+        return false;
+    }
+    valueParsed();
+    if (!h_.value(type, buf_, n_)) {
+        state_ = ERROR;
+        return false;
+    }
+    return true;
+}
+
+bool spark::JSONStreamParser::append(char c) {
+    if (n_ + 1 >= bufSize_ && !flushPart()) { // Reserve space for term. null character
+        return false;
+    }
+    buf_[n_++] = c;
+    return true;
+}
+
+bool spark::JSONStreamParser::append(const char *data, size_t size) {
+    while (size) {
+        if (n_ + 1 >= bufSize_ && !flushPart()) {
+            return false;
+        }
+        const size_t n = std::min(size, bufSize_ - n_ - 1);
+        memcpy(buf_ + n_, data, n);
+        n_ += n;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool spark::JSONStreamParser::flushPart() {
+    buf_[n_] = '\0';
+    if (!(isName_ ? h_.namePart(buf_, n_) : h_.valuePart(buf_, n_))) {
+        state_ = ERROR;
+        return false;
+    }
+    n_ = 0;
+    return true;
+}
+
+bool spark::JSONStreamParser::appendCodePoint(uint32_t c) {
+    // Encode the code point in UTF-8
+    if (c < 0x80) {
+        return append((char)c);
+    } else if (c < 0x800) {
+        return append((char)(0xc0 | (c >> 6))) &&
+                append((char)(0x80 | (c & 0x3f)));
+    } else if (c < 0x10000) {
+        return append((char)(0xe0 | (c >> 12))) &&
+                append((char)(0x80 | ((c >> 6) & 0x3f))) &&
+                append((char)(0x80 | (c & 0x3f)));
+    }
+    return append((char)(0xf0 | (c >> 18))) &&
+            append((char)(0x80 | ((c >> 12) & 0x3f))) &&
+            append((char)(0x80 | ((c >> 6) & 0x3f))) &&
+            append((char)(0x80 | (c & 0x3f)));
+}
+
+bool spark::JSONStreamParser::appendPendingSurrogate() {
+    surrogate_ = 0;
+    return appendCodePoint(0xfffd); // Unpaired surrogate is replaced with U+FFFD
+}
+
+void spark::JSONStreamParser::valueParsed() {
+    state_ = depth_ ? NEXT : DONE;
+}
+
 // spark::JSONWriter
 spark::JSONWriter& spark::JSONWriter::beginArray() {
     writeSeparator();
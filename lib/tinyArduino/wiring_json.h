@@ -49,6 +49,9 @@ class JSONString;
 class JSONArrayIterator;
 class JSONObjectIterator;
 
+template<size_t N>
+class StaticJSONDocument;
+
 // Immutable JSON value
 class JSONValue {
 public:
@@ -73,15 +76,27 @@ public:
 
     bool isValid() const;
 
+    // Returns the value of the object's property with the given name, or an invalid value
+    // if there's no such property or this value is not an object
+    JSONValue get(const char *name) const;
+    JSONValue get(const char *name, size_t size) const;
+
     static JSONValue parse(char *json, size_t size);
+    // Parses a copy of JSON data. Only contents of strings and primitives are copied, so the
+    // original data can be released right after parsing
     static JSONValue parseCopy(const char *json, size_t size);
     static JSONValue parseCopy(const char *json);
 
+    // Parses JSON data in place, storing tokens in the provided array. No memory is allocated,
+    // the returned value is only valid as long as both the data and the token array are
+    static JSONValue parse(char *json, size_t size, jsmntok_t *tokens, size_t maxTokens);
+
 private:
-    detail::JSONDataPtr d_;
+    detail::JSONDataPtr d_; // Owner of the parsed data, empty if the data is borrowed
+    const char *j_; // JSON data
     const jsmntok_t *t_; // Token representing this value
 
-    JSONValue(const jsmntok_t *token, detail::JSONDataPtr data);
+    JSONValue(const jsmntok_t *token, const char *json, detail::JSONDataPtr data);
 
     static bool tokenize(const char *json, size_t size, jsmntok_t **tokens, size_t *count);
     static bool stringize(jsmntok_t *tokens, size_t count, char *json);
@@ -117,7 +132,7 @@ private:
     const char *s_;
     size_t n_;
 
-    JSONString(const jsmntok_t *token, detail::JSONDataPtr data);
+    JSONString(const jsmntok_t *token, const char *json, detail::JSONDataPtr data);
 
     friend class JSONValue;
     friend class JSONObjectIterator;
@@ -136,10 +151,11 @@ public:
 
 private:
     detail::JSONDataPtr d_;
-    const jsmntok_t *t_, *v_;
+    const char *j_;
+    const jsmntok_t *t_, *v_, *end_;
     size_t n_;
 
-    JSONArrayIterator(const jsmntok_t *token, detail::JSONDataPtr data);
+    JSONArrayIterator(const jsmntok_t *token, const char *json, detail::JSONDataPtr data);
 };
 
 class JSONObjectIterator {
@@ -156,10 +172,132 @@ public:
 
 private:
     detail::JSONDataPtr d_;
-    const jsmntok_t *t_, *k_, *v_;
+    const char *j_;
+    const jsmntok_t *t_, *k_, *v_, *end_;
     size_t n_;
 
-    JSONObjectIterator(const jsmntok_t *token, detail::JSONDataPtr data);
+    JSONObjectIterator(const jsmntok_t *token, const char *json, detail::JSONDataPtr data);
+};
+
+// JSON document with a fixed token budget. Tokens are stored inline and parsed values borrow
+// the document's lifetime instead of sharing ownership of it, so parsing a document doesn't
+// allocate any memory. The document and the data it was parsed from must outlive all values,
+// strings and iterators obtained from it
+template<size_t N>
+class StaticJSONDocument {
+public:
+    StaticJSONDocument();
+
+    StaticJSONDocument(const StaticJSONDocument&) = delete;
+    StaticJSONDocument& operator=(const StaticJSONDocument&) = delete;
+
+    // Parses JSON data in place. A document consisting of a single primitive value needs to be
+    // followed by at least one character, e.g. whitespace, where the parser can store the
+    // terminating null character
+    bool parse(char *json, size_t size);
+
+    JSONValue value() const; // Returns root value
+
+private:
+    jsmntok_t tokens_[N];
+    JSONValue v_;
+};
+
+// Receiver of events produced by JSONStreamParser. Returning false from any of the methods
+// stops parsing
+class JSONStreamHandler {
+public:
+    virtual ~JSONStreamHandler() = default;
+
+    virtual bool beginArray();
+    virtual bool endArray();
+    virtual bool beginObject();
+    virtual bool endObject();
+    virtual bool name(const char *name, size_t size); // Name of an object's property
+    virtual bool value(JSONType type, const char *val, size_t size);
+    // Leading part of a string or number value that doesn't fit into the parser's buffer.
+    // Remaining data is passed to subsequent calls to this method and, finally, to value().
+    // Note that a part may end in the middle of a multibyte UTF-8 character
+    virtual bool valuePart(const char *data, size_t size);
+    // Leading part of a name that doesn't fit into the parser's buffer, passed the same way as
+    // parts of values. By default, such names stop the parsing
+    virtual bool namePart(const char *data, size_t size);
+};
+
+// Event-driven JSON parser. Data can be written to the parser in chunks of arbitrary size
+// or read from a stream. The parser uses the provided buffer to accumulate property names
+// and values, and otherwise keeps a fixed amount of state, so documents of any size can be
+// processed. Names and values are passed to the handler as null-terminated strings, in parts
+// if they don't fit into the buffer. Compound values nested deeper than MAX_DEPTH levels are
+// passed to value() as an empty object or array, and their contents are skipped, only checking
+// that brackets are balanced and strings are terminated. A buffer smaller than 2 bytes can't
+// hold any data, and the parser fails all input
+class JSONStreamParser: public Print {
+public:
+    static const unsigned MAX_DEPTH = 32;
+
+    JSONStreamParser(JSONStreamHandler &handler, char *buf, size_t size);
+
+    virtual size_t write(uint8_t c) override;
+    virtual size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+
+    // Reads and parses all data currently available in the stream
+    template<typename StreamT>
+    size_t readFrom(StreamT &stream);
+
+    // Signals the end of input. Returns true if a complete document has been parsed
+    bool end();
+
+    void reset();
+
+    bool isDone() const;
+    bool hasError() const;
+
+private:
+    enum State {
+        VALUE, // Expecting a value
+        FIRST_VALUE, // Expecting first element of an array or end of the array
+        NAME, // Expecting name of an object's property
+        FIRST_NAME, // Expecting name of first property or end of an object
+        COLON, // Expecting name separator
+        NEXT, // Expecting value separator or end of a compound value
+        STRING, // Inside a string
+        ESCAPE, // Escaped character in a string
+        UNICODE, // Escaped code point in a string, e.g. "\u001f"
+        PRIMITIVE, // Inside a number or a literal name
+        SKIP, // Inside a compound value that is nested too deeply
+        SKIP_STRING, // Inside a string within a skipped value
+        SKIP_ESCAPE, // Escaped character in a string within a skipped value
+        DONE, // Complete document has been parsed
+        ERROR
+    };
+
+    JSONStreamHandler &h_;
+    char *buf_;
+    size_t bufSize_, n_;
+    uint32_t objects_; // Type of each open compound value, 1 stands for an object
+    uint32_t codePoint_; // Escaped code point
+    uint32_t skipDepth_; // Nesting level within a skipped value
+    uint16_t surrogate_; // High surrogate of an escaped UTF-16 surrogate pair
+    uint8_t depth_;
+    uint8_t hexDigits_;
+    State state_;
+    bool isName_;
+    bool isNumberPart_; // Part of the current number has been passed to the handler
+
+    bool parse(char c);
+    bool parseValue(char c);
+    bool beginCompound(bool object);
+    bool endCompound(bool object);
+    bool endString();
+    bool endPrimitive();
+    bool append(char c);
+    bool append(const char *data, size_t size);
+    bool appendCodePoint(uint32_t c);
+    bool appendPendingSurrogate();
+    bool flushPart();
+    void valueParsed();
 };
 
 // Abstract JSON document writer
@@ -255,11 +393,12 @@ using namespace spark;
 
 // spark::JSONValue
 inline spark::JSONValue::JSONValue() :
+        j_(nullptr),
         t_(nullptr) {
 }
 
 inline spark::JSONString spark::JSONValue::toString() const {
-    return JSONString(t_, d_);
+    return JSONString(t_, j_, d_);
 }
 
 inline bool spark::JSONValue::isNull() const {
@@ -301,7 +440,7 @@ inline spark::JSONString::JSONString() :
 }
 
 inline spark::JSONString::JSONString(const JSONValue &value) :
-        JSONString(value.t_, value.d_) {
+        JSONString(value.t_, value.j_, value.d_) {
 }
 
 inline const char* spark::JSONString::data() const {
@@ -342,17 +481,19 @@ inline spark::JSONString::operator String() const {
 
 // spark::JSONArrayIterator
 inline spark::JSONArrayIterator::JSONArrayIterator() :
+        j_(nullptr),
         t_(nullptr),
         v_(nullptr),
+        end_(nullptr),
         n_(0) {
 }
 
 inline spark::JSONArrayIterator::JSONArrayIterator(const JSONValue &value) :
-        JSONArrayIterator(value.t_, value.d_) {
+        JSONArrayIterator(value.t_, value.j_, value.d_) {
 }
 
 inline spark::JSONValue spark::JSONArrayIterator::value() const {
-    return JSONValue(v_, d_);
+    return JSONValue(v_, j_, d_);
 }
 
 inline size_t spark::JSONArrayIterator::count() const {
@@ -361,28 +502,112 @@ inline size_t spark::JSONArrayIterator::count() const {
 
 // spark::JSONObjectIterator
 inline spark::JSONObjectIterator::JSONObjectIterator() :
+        j_(nullptr),
         t_(nullptr),
         k_(nullptr),
         v_(nullptr),
+        end_(nullptr),
         n_(0) {
 }
 
 inline spark::JSONObjectIterator::JSONObjectIterator(const JSONValue &value) :
-        JSONObjectIterator(value.t_, value.d_) {
+        JSONObjectIterator(value.t_, value.j_, value.d_) {
 }
 
 inline spark::JSONString spark::JSONObjectIterator::name() const {
-    return JSONString(k_, d_);
+    return JSONString(k_, j_, d_);
 }
 
 inline spark::JSONValue spark::JSONObjectIterator::value() const {
-    return JSONValue(v_, d_);
+    return JSONValue(v_, j_, d_);
 }
 
 inline size_t spark::JSONObjectIterator::count() const {
     return n_;
 }
 
+// spark::StaticJSONDocument
+template<size_t N>
+inline spark::StaticJSONDocument<N>::StaticJSONDocument() {
+}
+
+template<size_t N>
+inline bool spark::StaticJSONDocument<N>::parse(char *json, size_t size) {
+    v_ = JSONValue::parse(json, size, tokens_, N);
+    return v_.isValid();
+}
+
+template<size_t N>
+inline spark::JSONValue spark::StaticJSONDocument<N>::value() const {
+    return v_;
+}
+
+// spark::JSONStreamHandler
+inline bool spark::JSONStreamHandler::beginArray() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::endArray() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::beginObject() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::endObject() {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::name(const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::value(JSONType, const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::valuePart(const char*, size_t) {
+    return true;
+}
+
+inline bool spark::JSONStreamHandler::namePart(const char*, size_t) {
+    return false;
+}
+
+// spark::JSONStreamParser
+inline spark::JSONStreamParser::JSONStreamParser(JSONStreamHandler &handler, char *buf, size_t size) :
+        h_(handler),
+        buf_(buf),
+        bufSize_(size) {
+    reset();
+}
+
+inline size_t spark::JSONStreamParser::write(uint8_t c) {
+    return parse((char)c) ? 1 : 0;
+}
+
+template<typename StreamT>
+inline size_t spark::JSONStreamParser::readFrom(StreamT &stream) {
+    size_t n = 0;
+    while (state_ != ERROR && stream.available() > 0) {
+        const int c = stream.read();
+        if (c < 0 || !parse((char)c)) {
+            break;
+        }
+        ++n;
+    }
+    return n;
+}
+
+inline bool spark::JSONStreamParser::isDone() const {
+    return state_ == DONE;
+}
+
+inline bool spark::JSONStreamParser::hasError() const {
+    return state_ == ERROR;
+}
+
 // spark::JSONWriter
 inline spark::JSONWriter::JSONWriter() :
         state_(BEGIN) {